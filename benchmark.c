@@ -0,0 +1,1806 @@
+/**
+ * @file benchmark.c
+ * @brief Contains throughput benchmarks for the modules.
+*/
+
+#include "binary.h"
+#include "executor.h"
+#include "journal.h"
+#include "numbers.h"
+#include "parser.h"
+#include "reader.h"
+#include "search.h"
+#include "server.h"
+#include "snapshot.h"
+#include "station_hash.h"
+#include "station_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <malloc.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define OLD_BUFFER_CAPACITY 8096
+#define READER_CAPACITY (1 << 16)
+
+double elapsed_seconds(const struct timespec * start, const struct timespec * end) {
+  return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void print_throughput(const char * name, long bytes, double seconds) {
+  printf("\t%-10s %10ld bytes in %8.4f s -> %9.2f MB/s\n", name, bytes, seconds, bytes / seconds / 1e6);
+}
+
+//-------------------------------------------------------------------------------------
+
+long ingest_fscanf(const char * path) {
+  FILE * input = fopen(path, "r");
+  if(input == NULL) {
+    return -1;
+  }
+
+  char buffer[OLD_BUFFER_CAPACITY + 1];
+  uint line_index = 0;
+  long bytes = 0;
+  char c = '\0';
+
+  while(fscanf(input, "%c", &c) != EOF) {
+    ++bytes;
+
+    if(c == '\n') {
+      buffer[line_index] = '\0';
+      delete_instruction(parse_instruction(buffer));
+      line_index = 0;
+    }
+    else if(line_index < OLD_BUFFER_CAPACITY) {
+      buffer[line_index++] = c;
+    }
+  }
+
+  fclose(input);
+  return bytes;
+}
+
+long ingest_reader(const char * path, uint mapped) {
+  int fd = open(path, O_RDONLY);
+  if(fd < 0) {
+    return -1;
+  }
+
+  reader * input_reader = NULL;
+  if(mapped) {
+    input_reader = create_mapped_reader(fd);
+  }
+  else {
+    input_reader = create_reader(fd, READER_CAPACITY);
+  }
+  if(input_reader == NULL) {
+    close(fd);
+    return -1;
+  }
+
+  long bytes = 0;
+  line command;
+
+  while(next_line(input_reader, &command) == line_read) {
+    bytes += command.length + 1;
+    delete_instruction(parse_line(command.text, command.length));
+  }
+
+  delete_reader(input_reader);
+  close(fd);
+  return bytes;
+}
+
+void benchmark_reader(const char * path) {
+  struct timespec start, end;
+
+  printf("Ingestion of %s (read + parse)\n", path);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  long bytes = ingest_fscanf(path);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  if(bytes < 0) {
+    printf("\tUnable to open %s\n", path);
+    return;
+  }
+  print_throughput("fscanf", bytes, elapsed_seconds(&start, &end));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  bytes = ingest_reader(path, 0);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  print_throughput("reader", bytes, elapsed_seconds(&start, &end));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  bytes = ingest_reader(path, 1);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  print_throughput("mmap", bytes, elapsed_seconds(&start, &end));
+}
+
+//-------------------------------------------------------------------------------------
+
+/**
+ * @brief Parse every line of a mapped file, with an instruction allocated on heap for every line or with a parse arena.
+ * 
+ * @returns The number of heap allocations done to parse the lines, -1 on error.
+*/
+long parse_file(const char * path, uint use_arena, uint * lines) {
+  int fd = open(path, O_RDONLY);
+  reader * input = fd < 0 ? NULL : create_mapped_reader(fd);
+  parse_arena * arena = create_parse_arena(STD_ARENA_CAPACITY);
+  if(input == NULL || arena == NULL) {
+    delete_parse_arena(arena);
+    close(fd);
+    return -1;
+  }
+
+  unsigned long arena_allocations = arena->allocations;
+  long allocations = 0;
+  line command;
+  instruction parsed;
+
+  *lines = 0;
+  while(next_line(input, &command) == line_read) {
+    if(use_arena) {
+      parse_line_into(command.text, command.length, arena, &parsed);
+    }
+    else {
+      instruction * heap_parsed = parse_line(command.text, command.length);
+      allocations += 1 + (heap_parsed != NULL && heap_parsed->params != NULL);
+      delete_instruction(heap_parsed);
+    }
+    ++(*lines);
+  }
+
+  if(use_arena) {
+    allocations = arena->allocations - arena_allocations;
+  }
+
+  delete_parse_arena(arena);
+  delete_reader(input);
+  close(fd);
+  return allocations;
+}
+
+void benchmark_parse(const char * path) {
+  struct timespec start, end;
+  const char * names[] = {"heap", "arena"};
+
+  printf("Parsing of %s\n", path);
+
+  for(uint use_arena = 0; use_arena < 2; ++use_arena) {
+    uint lines = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long allocations = parse_file(path, use_arena, &lines);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if(allocations < 0) {
+      printf("\tUnable to open %s\n", path);
+      return;
+    }
+
+    double seconds = elapsed_seconds(&start, &end);
+    printf("\t%-10s %8d lines in %8.4f s -> %12.0f lines/s, %8ld heap allocations\n", names[use_arena], lines, 
+      seconds, lines / seconds, allocations);
+  }
+}
+
+//-------------------------------------------------------------------------------------
+
+/**
+ * @brief Build an aggiungi-stazione line with length cars whose fuel has from 1 to 10 digits.
+ * 
+ * @returns The line allocated on heap (not null terminated), NULL if there is not enough memory.
+*/
+char * create_station_line(uint length, uint * line_length) {
+  char * line = (char *) malloc(32 + (size_t) length * 11);
+  if(line == NULL) {
+    return NULL;
+  }
+
+  uint n = sprintf(line, "aggiungi-stazione 1 %u", length);
+  srand(length);
+  for(uint i = 0; i < length; ++i) {
+    uint digits = 1 + rand() % 10;
+    uint fuel = ((uint) rand() * 2654435761u) % 2147483647u;
+    while(digits < 10 && fuel >= 10) {
+      fuel /= 10;
+      ++digits;
+    }
+    n += sprintf(line + n, " %u", fuel);
+  }
+
+  *line_length = n;
+  return line;
+}
+
+/**
+ * @brief Parse a line copying every token and converting it with atoi, as the parser used to.
+*/
+uint parse_with_atoi(const char * line, uint length, uint * values) {
+  char token[16];
+  uint n = 0;
+  uint start = 0;
+
+  while(start <= length) {
+    const char * found = (const char *) memchr(line + start, ' ', length - start);
+    uint end = found != NULL ? found - line : length;
+    uint token_length = end - start < 15 ? end - start : 15;
+
+    memcpy(token, line + start, token_length);
+    token[token_length] = '\0';
+    int value = atoi(token);
+    values[n++] = value < 0 ? 0 : value;
+
+    start = end + 1;
+  }
+
+  return n;
+}
+
+void benchmark_numbers() {
+  struct timespec start, end;
+  const char * names[] = {"scalar", "sse4.1", "avx2"};
+  const uint length = 1 << 20;
+  const uint rounds = 10;
+
+  uint line_length = 0;
+  char * line = create_station_line(length, &line_length);
+  uint * values = (uint *) malloc(sizeof(uint) * (length + 3));
+  parse_arena * arena = create_parse_arena(length + 3);
+  if(line == NULL || values == NULL || arena == NULL) {
+    printf("\tNot enough memory\n");
+    free(line);
+    free(values);
+    delete_parse_arena(arena);
+    return;
+  }
+
+  printf("Decoding of an aggiungi-stazione line of %d cars (%d bytes), %d rounds\n", length, line_length, rounds);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(uint r = 0; r < rounds; ++r) {
+    parse_with_atoi(line + 18, line_length - 18, values);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  print_throughput("atoi", (long) line_length * rounds, elapsed_seconds(&start, &end));
+
+  number_decoder best = detect_number_decoder();
+  for(uint decoder = scalar_decoder; decoder <= best; ++decoder) {
+    select_number_decoder(decoder);
+
+    instruction parsed;
+    uint same = 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(uint r = 0; r < rounds; ++r) {
+      parse_line_into(line, line_length, arena, &parsed);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    same = parsed.params_length == length + 2 && memcmp(parsed.params, values, sizeof(uint) * (length + 2)) == 0;
+
+    char name[32];
+    sprintf(name, "%s%s", names[decoder], same ? "" : " (DIFFERENT)");
+    print_throughput(name, (long) line_length * rounds, elapsed_seconds(&start, &end));
+  }
+
+  select_number_decoder(best);
+
+  delete_parse_arena(arena);
+  free(values);
+  free(line);
+}
+
+//-------------------------------------------------------------------------------------
+
+/**
+ * @brief Convert a text command file in a temporary binary command file.
+ * 
+ * @returns The file descriptor of the binary file (already unlinked), -1 on error.
+*/
+int encode_file(const char * path) {
+  char binary_path[] = "/tmp/benchmark_XXXXXX";
+
+  int input = open(path, O_RDONLY);
+  int output = mkstemp(binary_path);
+  if(input < 0 || output < 0) {
+    close(input);
+    close(output);
+    return -1;
+  }
+  unlink(binary_path);
+
+  reader * text = create_mapped_reader(input);
+  writer * binary = create_writer(output, READER_CAPACITY);
+  unsigned char * record = NULL;
+  uint record_capacity = 0;
+
+  write_text(binary, BINARY_MAGIC, BINARY_MAGIC_LENGTH);
+
+  line command;
+  while(text != NULL && next_line(text, &command) == line_read) {
+    instruction * instruction = parse_line(command.text, command.length);
+
+    if(record_max_length(instruction) > record_capacity) {
+      record_capacity = record_max_length(instruction) * 2;
+      free(record);
+      record = (unsigned char *) malloc(record_capacity);
+    }
+
+    write_text(binary, (char *) record, encode_instruction(instruction, record));
+    delete_instruction(instruction);
+  }
+
+  free(record);
+  delete_writer(binary);
+  delete_reader(text);
+  close(input);
+
+  return output;
+}
+
+/**
+ * @brief Execute every command of a file on an empty highway, discarding the replies.
+ * 
+ * @param instructions 1 to decode every text command into an instruction, 0 to use the fused executor.
+ * 
+ * @returns The number of commands executed.
+*/
+uint execute_file(int fd, uint instructions) {
+  int null_output = open("/dev/null", O_WRONLY);
+  lseek(fd, 0, SEEK_SET);
+
+  reader * input = create_mapped_reader(fd);
+  executor executor = {.highway = create_highway(256), .output = create_writer(null_output, READER_CAPACITY), 
+                       .replies = text_format, .snapshot_path = NULL, .journal = NULL, .instructions = instructions};
+  uint commands = 0;
+
+  execute_stream(&executor, input, detect_format(input), &commands);
+
+  delete_highway(executor.highway);
+  delete_writer(executor.output);
+  delete_reader(input);
+  close(null_output);
+
+  return commands;
+}
+
+void benchmark_encoding(const char * path) {
+  struct timespec start, end;
+
+  printf("End-to-end execution of %s\n", path);
+
+  int text = open(path, O_RDONLY);
+  int binary = encode_file(path);
+  if(text < 0 || binary < 0) {
+    printf("\tUnable to open %s\n", path);
+    close(text);
+    close(binary);
+    return;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  uint commands = execute_file(text, 0);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double seconds = elapsed_seconds(&start, &end);
+  printf("\t%-10s %10ld bytes, %8d commands in %8.4f s -> %12.0f commands/s\n", "text", 
+    (long) lseek(text, 0, SEEK_END), commands, seconds, commands / seconds);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  commands = execute_file(binary, 0);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  seconds = elapsed_seconds(&start, &end);
+  printf("\t%-10s %10ld bytes, %8d commands in %8.4f s -> %12.0f commands/s\n", "binary", 
+    (long) lseek(binary, 0, SEEK_END), commands, seconds, commands / seconds);
+
+  close(text);
+  close(binary);
+}
+
+void benchmark_executor(const char * path) {
+  struct timespec start, end;
+  const char * names[] = {"fused", "instructions"};
+
+  printf("Execution of %s\n", path);
+
+  int text = open(path, O_RDONLY);
+  if(text < 0) {
+    printf("\tUnable to open %s\n", path);
+    return;
+  }
+
+  for(uint instructions = 0; instructions < 2; ++instructions) {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint commands = execute_file(text, instructions);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = elapsed_seconds(&start, &end);
+    printf("\t%-12s %8d commands in %8.4f s -> %12.0f commands/s\n", names[instructions], commands, seconds, 
+      commands / seconds);
+  }
+
+  close(text);
+}
+
+//-------------------------------------------------------------------------------------
+
+int compare_doubles(const void * a, const void * b) {
+  double x = *(const double *) a, y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+void print_latencies(const char * name, double * latencies, uint length) {
+  if(length == 0) {
+    return;
+  }
+
+  double total = 0;
+  for(uint i = 0; i < length; ++i) {
+    total += latencies[i];
+  }
+  qsort(latencies, length, sizeof(double), compare_doubles);
+
+  printf("\t%-10s %8d commands: mean %8.2f us, p50 %8.2f us, p99 %8.2f us, max %8.2f us\n", name, length,
+    total / length * 1e6, latencies[length / 2] * 1e6, latencies[(length * 99) / 100] * 1e6, latencies[length - 1] * 1e6);
+}
+
+/**
+ * @brief Start a server on an empty highway in a child process.
+ * 
+ * @returns The pid of the child, -1 on error.
+*/
+pid_t start_server(const char * socket_path) {
+  fflush(stdout);
+
+  pid_t server = fork();
+  if(server != 0) {
+    return server;
+  }
+
+  int null_output = open("/dev/null", O_WRONLY);
+  executor executor = {.highway = create_highway(256), .output = create_writer(null_output, READER_CAPACITY), 
+                       .replies = text_format, .snapshot_path = NULL, .journal = NULL, .instructions = 0};
+
+  uint result = run_server(&executor, socket_path);
+
+  delete_highway(executor.highway);
+  delete_writer(executor.output);
+  exit(result ? 0 : 1);
+}
+
+/**
+ * @brief Connect to a Unix domain socket, retrying while the server starts.
+ * 
+ * @returns The socket, -1 on error.
+*/
+int connect_server(const char * socket_path) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, socket_path);
+
+  for(uint attempt = 0; attempt < 100; ++attempt) {
+    int client = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(client >= 0 && connect(client, (struct sockaddr *) &address, sizeof(address)) == 0) {
+      return client;
+    }
+
+    close(client);
+    usleep(10000);
+  }
+
+  return -1;
+}
+
+void benchmark_server(const char * path) {
+  char socket_path[64];
+  sprintf(socket_path, "/tmp/benchmark_%d.sock", getpid());
+
+  printf("Round trip latency of %s through a server\n", path);
+
+  int fd = open(path, O_RDONLY);
+  reader * commands = fd < 0 ? NULL : create_mapped_reader(fd);
+  if(commands == NULL) {
+    printf("\tUnable to open %s\n", path);
+    close(fd);
+    return;
+  }
+
+  pid_t server = start_server(socket_path);
+  int client = server < 0 ? -1 : connect_server(socket_path);
+  if(client < 0) {
+    printf("\tUnable to start the server on %s\n", socket_path);
+    delete_reader(commands);
+    close(fd);
+    return;
+  }
+
+  reader * replies = create_reader(client, READER_CAPACITY);
+  writer * requests = create_writer(client, READER_CAPACITY);
+
+  uint capacity = 1024, plans = 0, others = 0;
+  double * plan_latencies = (double *) malloc(sizeof(double) * capacity);
+  double * other_latencies = (double *) malloc(sizeof(double) * capacity);
+
+  struct timespec start, end;
+  line command, reply;
+
+  while(next_line(commands, &command) == line_read) {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    write_text(requests, command.text, command.length);
+    write_char(requests, '\n');
+    flush_writer(requests);
+    if(next_line(replies, &reply) != line_read) {
+      printf("\tServer closed the connection\n");
+      break;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if(plans == capacity || others == capacity) {
+      capacity *= 2;
+      plan_latencies = (double *) realloc(plan_latencies, sizeof(double) * capacity);
+      other_latencies = (double *) realloc(other_latencies, sizeof(double) * capacity);
+    }
+
+    if(command.length > 0 && command.text[0] == 'p') {
+      plan_latencies[plans++] = elapsed_seconds(&start, &end);
+    }
+    else {
+      other_latencies[others++] = elapsed_seconds(&start, &end);
+    }
+  }
+
+  print_latencies("plan", plan_latencies, plans);
+  print_latencies("other", other_latencies, others);
+
+  free(plan_latencies);
+  free(other_latencies);
+  delete_writer(requests);
+  delete_reader(replies);
+  close(client);
+  delete_reader(commands);
+  close(fd);
+
+  kill(server, SIGTERM);
+  waitpid(server, NULL, 0);
+}
+
+//-------------------------------------------------------------------------------------
+
+void benchmark_snapshot(const char * path) {
+  struct timespec start, end;
+  char snapshot_path[] = "/tmp/benchmark_XXXXXX";
+
+  printf("Snapshot of the highway built by %s\n", path);
+
+  int fd = open(path, O_RDONLY);
+  int snapshot = mkstemp(snapshot_path);
+  reader * input = fd < 0 ? NULL : create_mapped_reader(fd);
+  if(input == NULL || snapshot < 0) {
+    printf("\tUnable to open %s\n", path);
+    close(fd);
+    close(snapshot);
+    return;
+  }
+  close(snapshot);
+
+  int null_output = open("/dev/null", O_WRONLY);
+  executor executor = {.highway = create_highway(256), .output = create_writer(null_output, READER_CAPACITY), 
+                       .replies = text_format, .snapshot_path = NULL, .journal = NULL, .instructions = 0};
+  uint commands = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  execute_stream(&executor, input, text_format, &commands);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("\t%-10s %8d commands in %8.4f s\n", "replay", commands, elapsed_seconds(&start, &end));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  snapshot_result result = save_snapshot(executor.highway, snapshot_path, 0);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("\t%-10s %8d stations in %8.4f s (result %d)\n", "save", executor.highway->length, 
+    elapsed_seconds(&start, &end), result);
+
+  highway * restored = NULL;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  result = load_snapshot(snapshot_path, &restored, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("\t%-10s %8d stations in %8.4f s (result %d)\n", "restore", restored != NULL ? restored->length : 0, 
+    elapsed_seconds(&start, &end), result);
+
+  delete_highway(restored);
+  delete_highway(executor.highway);
+  delete_writer(executor.output);
+  delete_reader(input);
+  unlink(snapshot_path);
+  close(null_output);
+  close(fd);
+}
+
+//-------------------------------------------------------------------------------------
+
+/**
+ * @brief Execute every command of a file on an empty highway with a journal in a temporary file.
+ * 
+ * @returns The number of mutations journaled.
+*/
+uint execute_journaled(const char * path, uint records_per_sync, uint sync_interval, uint * commands) {
+  char journal_path[] = "/tmp/benchmark_XXXXXX";
+  close(mkstemp(journal_path));
+  unlink(journal_path);
+
+  int fd = open(path, O_RDONLY);
+  int null_output = open("/dev/null", O_WRONLY);
+
+  reader * input = create_mapped_reader(fd);
+  journal * mutations = create_journal(journal_path, records_per_sync, sync_interval);
+  executor executor = {.highway = create_highway(256), .output = create_writer(null_output, READER_CAPACITY), 
+                       .replies = text_format, .snapshot_path = NULL, .journal = mutations, .instructions = 0};
+
+  *commands = 0;
+  execute_stream(&executor, input, text_format, commands);
+
+  uint records = mutations->records;
+
+  delete_journal(mutations);
+  delete_highway(executor.highway);
+  delete_writer(executor.output);
+  delete_reader(input);
+  unlink(journal_path);
+  close(null_output);
+  close(fd);
+
+  return records;
+}
+
+void benchmark_journal(const char * path) {
+  struct timespec start, end;
+  const char * names[] = {"no sync", "every 1", "every 16", "every 256", "1 ms", "10 ms"};
+  uint records_per_sync[] = {0, 1, 16, 256, 0, 0};
+  uint sync_interval[] = {0, 0, 0, 0, 1, 10};
+
+  printf("Journaled execution of %s\n", path);
+
+  if(access(path, R_OK) != 0) {
+    printf("\tUnable to open %s\n", path);
+    return;
+  }
+
+  for(uint i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+    uint commands = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint mutations = execute_journaled(path, records_per_sync[i], sync_interval[i], &commands);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = elapsed_seconds(&start, &end);
+    printf("\t%-10s %8d commands, %8d mutations in %8.4f s -> %12.0f mutations/s\n", names[i], commands, 
+      mutations, seconds, mutations / seconds);
+  }
+}
+
+//-------------------------------------------------------------------------------------
+
+void benchmark_batch(const char * path) {
+  struct timespec start, end;
+
+  printf("Plans of %s on the final highway\n", path);
+
+  int fd = open(path, O_RDONLY);
+  reader * input = fd < 0 ? NULL : create_mapped_reader(fd);
+  if(input == NULL) {
+    printf("\tUnable to open %s\n", path);
+    close(fd);
+    return;
+  }
+
+  int null_output = open("/dev/null", O_WRONLY);
+  executor executor = {.highway = create_highway(256), .output = create_writer(null_output, READER_CAPACITY), 
+                       .replies = text_format, .snapshot_path = NULL, .journal = NULL, .instructions = 0};
+  instruction * instruction = NULL;
+  path_query * queries = NULL;
+  matrix_size n_queries = 0, capacity = 0;
+
+  // Every mutation is executed first, so both the strategies plan on the same highway
+  while(next_instruction(input, text_format, &instruction) == line_read) {
+    if(instruction == NULL) {
+      continue;
+    }
+
+    if(instruction->command == plan_path_command) {
+      if(n_queries == capacity) {
+        capacity = capacity > 0 ? capacity * 2 : 256;
+        queries = (path_query *) realloc(queries, sizeof(path_query) * capacity);
+      }
+      queries[n_queries].start = instruction->params[0];
+      queries[n_queries].end = instruction->params[1];
+      ++n_queries;
+    }
+    else {
+      execute_command(&executor, instruction);
+    }
+
+    delete_instruction(instruction);
+  }
+
+  // plan_path requires both the stations in the highway, so the plans on demolished stations are dropped
+  matrix_size kept = 0;
+  for(matrix_size q = 0; q < n_queries; ++q) {
+    if(find_station(executor.highway, queries[q].start) != NULL && find_station(executor.highway, queries[q].end) != NULL) {
+      queries[kept++] = queries[q];
+    }
+  }
+  n_queries = kept;
+
+  path_result * results = (path_result *) malloc(sizeof(path_result) * (n_queries + 1));
+  long single_stops = 0, batch_stops = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(matrix_size q = 0; q < n_queries; ++q) {
+    matrix_size * solution = NULL;
+    direction dir = queries[q].start > queries[q].end ? backward : forward;
+    int stops = plan_path(executor.highway, queries[q].start, queries[q].end, dir, &solution);
+
+    single_stops += stops;
+    free(solution);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("\t%-10s %8d plans in %8.4f s\n", "single", n_queries, elapsed_seconds(&start, &end));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  plan_path_batch(executor.highway, queries, n_queries, results);
+  for(matrix_size q = 0; q < n_queries; ++q) {
+    batch_stops += results[q].stops;
+    free(results[q].solution);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("\t%-10s %8d plans in %8.4f s (%s)\n", "batch", n_queries, elapsed_seconds(&start, &end), 
+    single_stops == batch_stops ? "same stops" : "DIFFERENT stops");
+
+  free(results);
+  free(queries);
+  delete_highway(executor.highway);
+  delete_writer(executor.output);
+  delete_reader(input);
+  close(null_output);
+  close(fd);
+}
+
+//-------------------------------------------------------------------------------------
+
+#define CHURN_OPERATIONS 4000
+#define CHURN_RANGE 64
+
+/**
+ * @brief Run a mixed workload on an highway of n stations at the even distances from 0.
+ *
+ * Every 8 operations a station is added and one is removed in the first percent of the highway, where the churn is, 4
+ * stations are searched and 2 ranges of CHURN_RANGE stations are extracted after it.
+ *
+ * @returns The sum of the results of the operations.
+*/
+long execute_station_workload(matrix_size n, double * build_seconds, double * workload_seconds) {
+  struct timespec start, end;
+  matrix_size churn = n / 100 + 1;
+  long checksum = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  highway * highway = create_highway(n);
+  for(matrix_size i = 0; i < n; ++i) {
+    station * new_station = create_station(2 * i, 1);
+    add_car(new_station, 3);
+    add_station(highway, new_station);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  *build_seconds = elapsed_seconds(&start, &end);
+
+  srand(n);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(uint i = 0; i < CHURN_OPERATIONS; ++i) {
+    matrix_size k = rand() % churn;
+
+    switch(i % 8) {
+      case 0: {
+        station * new_station = create_station(2 * k + 1, 1);
+        matrix_size added = add_station(highway, new_station);
+        if(!added) {
+          delete_station(new_station);
+        }
+        checksum += added;
+      }
+      break;
+
+      case 1: {
+        matrix_size distance = 2 * k + rand() % 2;
+        checksum += remove_station(highway, distance);
+      }
+      break;
+
+      case 6: case 7: {
+        matrix_size first = 2 * (churn + rand() % (n - churn - CHURN_RANGE));
+        matrix_size * stations = NULL, * cars = NULL;
+        checksum += extract_stations(highway, first, first + 2 * CHURN_RANGE, &stations, &cars);
+        free(stations);
+        free(cars);
+      }
+      break;
+
+      default: {
+        matrix_size distance = rand() % (2 * n);
+        checksum += find_station(highway, distance) != NULL;
+      }
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  *workload_seconds = elapsed_seconds(&start, &end);
+
+  delete_highway(highway);
+
+  return checksum;
+}
+
+void benchmark_churn(uint n) {
+  printf("Mixed workload on %d stations\n", n);
+
+  if(n < 2 * CHURN_RANGE + 200) {
+    printf("\tAt least %d stations are needed\n", 2 * CHURN_RANGE + 200);
+    return;
+  }
+
+  double build_seconds = 0, workload_seconds = 0;
+  long checksum = execute_station_workload(n, &build_seconds, &workload_seconds);
+
+  printf("\t%-10s built in %8.4f s, %6d operations in %8.4f s -> %12.0f operations/s (checksum %ld)\n", 
+    "highway", build_seconds, CHURN_OPERATIONS, workload_seconds, CHURN_OPERATIONS / workload_seconds, checksum);
+}
+
+//-------------------------------------------------------------------------------------
+
+#define LAYOUT_SEARCHES 1000000
+#define LAYOUT_EXTRACTIONS 2000
+#define LAYOUT_RANGE 1024
+
+/**
+ * @brief Open a counter of the cache misses of this process in user space.
+ *
+ * @returns The file descriptor of the counter, -1 if performance counters are not available.
+*/
+int open_cache_miss_counter() {
+  struct perf_event_attr attributes;
+  memset(&attributes, 0, sizeof(attributes));
+  attributes.size = sizeof(attributes);
+  attributes.type = PERF_TYPE_HARDWARE;
+  attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+  attributes.disabled = 1;
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+
+  return syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+
+void start_counter(int counter) {
+  if(counter >= 0) {
+    ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+    ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+/**
+ * @returns The events counted from start_counter, -1 if the counter is not available.
+*/
+long stop_counter(int counter) {
+  long long count = 0;
+
+  if(counter < 0) {
+    return -1;
+  }
+
+  ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+  if(read(counter, &count, sizeof(count)) != sizeof(count)) {
+    return -1;
+  }
+
+  return count;
+}
+
+/**
+ * @brief Binary search of a distance reading it from the stations, as the highway did before the distances were
+ * stored in a contiguous array.
+*/
+station * find_station_by_pointers(const highway * highway, matrix_size distance) {
+  int a = 0, b = highway->length - 1;
+
+  while(a <= b) {
+    int m = a + (b - a) / 2;
+    matrix_size current = highway->stations[m]->distance;
+
+    if(current == distance) {
+      return highway->stations[m];
+    }
+    if(current < distance) {
+      a = m + 1;
+    }
+    else {
+      b = m - 1;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Copy the distances and the max fuels of length stations from first reading them from the stations.
+*/
+void extract_by_pointers(const highway * highway, matrix_size first, matrix_size length, matrix_size * stations,
+                          matrix_size * cars) {
+  for(matrix_size i = 0; i < length; ++i) {
+    stations[i] = highway->stations[first + i]->distance;
+    cars[i] = highway->stations[first + i]->car_max_fuel;
+  }
+}
+
+void print_layout(const char * name, uint operations, double seconds, long misses, long checksum) {
+  printf("\t%-20s %8d in %8.4f s -> %12.0f /s, ", name, operations, seconds, operations / seconds);
+  if(misses < 0) {
+    printf("cache misses unavailable");
+  }
+  else {
+    printf("%8.2f cache misses each", (double) misses / operations);
+  }
+  printf(" (checksum %ld)\n", checksum);
+}
+
+void benchmark_layout(uint n) {
+  struct timespec start, end;
+
+  printf("Searches and extractions on %d stations\n", n);
+
+  if(n < LAYOUT_RANGE) {
+    printf("\tAt least %d stations are needed\n", LAYOUT_RANGE);
+    return;
+  }
+
+  highway * highway = create_highway(n);
+  station ** created = (station **) malloc(n * sizeof(station *));
+  matrix_size * order = (matrix_size *) malloc(n * sizeof(matrix_size));
+  matrix_size * stations = (matrix_size *) malloc(LAYOUT_RANGE * sizeof(matrix_size));
+  matrix_size * cars = (matrix_size *) malloc(LAYOUT_RANGE * sizeof(matrix_size));
+  matrix_size * queries = (matrix_size *) malloc(LAYOUT_SEARCHES * sizeof(matrix_size));
+
+  if(highway == NULL || created == NULL || order == NULL || stations == NULL || cars == NULL || queries == NULL) {
+    printf("\tNot enough memory\n");
+    delete_highway(highway);
+    free(created);
+    free(order);
+    free(stations);
+    free(cars);
+    free(queries);
+    return;
+  }
+
+  // The stations are allocated in random order, so that their addresses do not follow their distances
+  srand(n);
+  for(matrix_size i = 0; i < n; ++i) {
+    order[i] = i;
+  }
+  for(matrix_size i = n - 1; i > 0; --i) {
+    matrix_size j = rand() % (i + 1), swap = order[i];
+    order[i] = order[j];
+    order[j] = swap;
+  }
+  for(matrix_size i = 0; i < n; ++i) {
+    created[order[i]] = create_station(2 * order[i], 1);
+    add_car(created[order[i]], order[i] % 100);
+  }
+  for(matrix_size i = 0; i < n; ++i) {
+    add_station(highway, created[i]);
+  }
+  free(created);
+  for(uint i = 0; i < LAYOUT_SEARCHES; ++i) {
+    queries[i] = rand() % (2 * n);
+  }
+
+  int counter = open_cache_miss_counter();
+  const char * names[] = {"search (pointers)", "search (arrays)", "extract (pointers)", "extract (arrays)"};
+
+  for(uint use_arrays = 0; use_arrays < 2; ++use_arrays) {
+    long checksum = 0;
+
+    start_counter(counter);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(uint i = 0; i < LAYOUT_SEARCHES; ++i) {
+      checksum += (use_arrays ? find_station(highway, queries[i]) : 
+                                find_station_by_pointers(highway, queries[i])) != NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long misses = stop_counter(counter);
+
+    print_layout(names[use_arrays], LAYOUT_SEARCHES, elapsed_seconds(&start, &end), misses, checksum);
+  }
+
+  for(uint use_arrays = 0; use_arrays < 2; ++use_arrays) {
+    long checksum = 0;
+
+    start_counter(counter);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(uint i = 0; i < LAYOUT_EXTRACTIONS; ++i) {
+      matrix_size first = queries[i] % (n - LAYOUT_RANGE + 1);
+      if(use_arrays) {
+        memcpy(stations, highway->distance + first, LAYOUT_RANGE * sizeof(matrix_size));
+        memcpy(cars, highway->max_fuel + first, LAYOUT_RANGE * sizeof(matrix_size));
+      }
+      else {
+        extract_by_pointers(highway, first, LAYOUT_RANGE, stations, cars);
+      }
+      checksum += stations[LAYOUT_RANGE - 1] + cars[LAYOUT_RANGE - 1];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long misses = stop_counter(counter);
+
+    print_layout(names[2 + use_arrays], LAYOUT_EXTRACTIONS, elapsed_seconds(&start, &end), misses, checksum);
+  }
+
+  if(counter >= 0) {
+    close(counter);
+  }
+  delete_highway(highway);
+  free(order);
+  free(stations);
+  free(cars);
+  free(queries);
+}
+
+//-------------------------------------------------------------------------------------
+
+#define PLAN_STATIONS 1000000
+#define PLAN_QUERIES 200
+
+/**
+ * Number of heap allocations of the process, counted by the definitions of malloc, calloc and realloc below, which
+ * take the place of the ones of the C library in run_benchmarks.
+*/
+unsigned long heap_allocations = 0;
+
+void * __libc_malloc(size_t size);
+void * __libc_calloc(size_t n, size_t size);
+void * __libc_realloc(void * pointer, size_t size);
+
+void * malloc(size_t size) {
+  ++heap_allocations;
+  return __libc_malloc(size);
+}
+
+void * calloc(size_t n, size_t size) {
+  ++heap_allocations;
+  return __libc_calloc(n, size);
+}
+
+void * realloc(void * pointer, size_t size) {
+  ++heap_allocations;
+  return __libc_realloc(pointer, size);
+}
+
+/**
+ * @brief Plan a path copying the stations from start to end, as plan_path did before solving on a view of the highway.
+*/
+int plan_path_copying(const highway * highway, matrix_size start, matrix_size end, direction dir,
+                      matrix_size ** solution) {
+  matrix_size * stations = NULL, * cars = NULL;
+  int n_stations = dir == forward ? extract_stations(highway, start, end, &stations, &cars) :
+                                    extract_stations(highway, end, start, &stations, &cars);
+  *solution = NULL;
+  if(n_stations < 0) {
+    return n_stations;
+  }
+
+  int stops = solve(stations, n_stations, cars, dir, solution);
+
+  free(stations);
+  free(cars);
+  return stops;
+}
+
+void benchmark_plan(uint length) {
+  struct timespec start, end;
+
+  printf("Plans of %d stations on %d stations\n", length, PLAN_STATIONS);
+
+  if(length < 2 || length > PLAN_STATIONS) {
+    printf("\tFrom 2 to %d stations are needed\n", PLAN_STATIONS);
+    return;
+  }
+
+  highway * highway = create_highway(PLAN_STATIONS);
+  double * latencies = (double *) malloc(sizeof(double) * PLAN_QUERIES);
+  if(highway == NULL || latencies == NULL) {
+    printf("\tNot enough memory\n");
+    delete_highway(highway);
+    free(latencies);
+    return;
+  }
+
+  srand(length);
+  for(matrix_size i = 0; i < PLAN_STATIONS; ++i) {
+    station * new_station = create_station(10 * i, 1);
+    add_car(new_station, 10 + rand() % 1000);
+    add_station(highway, new_station);
+  }
+
+  const char * names[] = {"copy", "view"};
+
+  for(uint d = 0; d < 2; ++d) {
+    direction dir = d == 0 ? forward : backward;
+
+    for(uint use_view = 0; use_view < 2; ++use_view) {
+      unsigned long allocations = 0;
+      long checksum = 0;
+
+      srand(length + d);
+      for(uint q = 0; q < PLAN_QUERIES; ++q) {
+        matrix_size first = 10 * (rand() % (PLAN_STATIONS - length + 1)), last = first + 10 * (length - 1);
+        matrix_size * solution = NULL;
+
+        unsigned long before = heap_allocations;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int stops = use_view ? plan_path(highway, dir == forward ? first : last, dir == forward ? last : first, dir, 
+                                          &solution) :
+                                plan_path_copying(highway, dir == forward ? first : last, 
+                                                  dir == forward ? last : first, dir, &solution);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        allocations += heap_allocations - before;
+
+        latencies[q] = elapsed_seconds(&start, &end);
+        checksum += stops;
+        free(solution);
+      }
+
+      double total = 0;
+      for(uint q = 0; q < PLAN_QUERIES; ++q) {
+        total += latencies[q];
+      }
+      qsort(latencies, PLAN_QUERIES, sizeof(double), compare_doubles);
+
+      printf("\t%-8s %-5s %8.2f allocations/plan, mean %10.2f us, p50 %10.2f us, p99 %10.2f us (checksum %ld)\n", 
+        dir == forward ? "forward" : "backward", names[use_view], (double) allocations / PLAN_QUERIES, 
+        total / PLAN_QUERIES * 1e6, latencies[PLAN_QUERIES / 2] * 1e6, latencies[(PLAN_QUERIES * 99) / 100] * 1e6, 
+        checksum);
+    }
+  }
+
+  delete_highway(highway);
+  free(latencies);
+}
+
+//-------------------------------------------------------------------------------------
+
+#define CAR_OPERATIONS 2000
+
+/**
+ * @brief Remove a car from an unordered array of fuels, as remove_car did before the runs: the car is searched by a 
+ * linear scan, and the max fuel is recomputed scanning every car when the removed car had it.
+ *
+ * @returns 1 if the car is removed, 0 otherwise.
+*/
+uint flat_remove_car(matrix_size * cars, matrix_size * length, matrix_size * max_fuel, matrix_size fuel) {
+  matrix_size i = 0;
+  while(i < *length && cars[i] != fuel) {
+    ++i;
+  }
+  if(i == *length) {
+    return 0;
+  }
+
+  cars[i] = cars[--(*length)];
+
+  if(fuel == *max_fuel) {
+    *max_fuel = 0;
+    for(i = 0; i < *length; ++i) {
+      if(cars[i] > *max_fuel) {
+        *max_fuel = cars[i];
+      }
+    }
+  }
+
+  return 1;
+}
+
+void benchmark_cars(uint n) {
+  struct timespec start, end;
+
+  printf("Scrapping of the car with the max fuel and insertion of a new car in a station of %d cars\n", n);
+
+  matrix_size * cars = (matrix_size *) malloc(sizeof(matrix_size) * (n + 1));
+  double * latencies = (double *) malloc(sizeof(double) * CAR_OPERATIONS);
+  station * multiset = create_station(0, 1);
+
+  if(n == 0 || cars == NULL || latencies == NULL || multiset == NULL) {
+    printf("\tUnable to build the station\n");
+    free(cars);
+    free(latencies);
+    delete_station(multiset);
+    return;
+  }
+
+  srand(n);
+  matrix_size length = n, max_fuel = 0;
+  for(matrix_size i = 0; i < n; ++i) {
+    cars[i] = rand() % (1 << 20);
+    if(cars[i] > max_fuel) {
+      max_fuel = cars[i];
+    }
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  add_cars(multiset, cars, n);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("\t%-10s built in %8.4f s (%d distinct fuels)\n", "runs", elapsed_seconds(&start, &end), multiset->n_runs);
+
+  const char * names[] = {"array", "runs"};
+
+  for(uint use_runs = 0; use_runs < 2; ++use_runs) {
+    long checksum = 0;
+
+    srand(n + 1);
+    for(uint i = 0; i < CAR_OPERATIONS; ++i) {
+      matrix_size fuel = rand() % (1 << 20);
+
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      if(use_runs) {
+        checksum += remove_car(multiset, multiset->car_max_fuel);
+        checksum += add_car(multiset, fuel);
+        checksum += multiset->car_max_fuel;
+      }
+      else {
+        checksum += flat_remove_car(cars, &length, &max_fuel, max_fuel);
+        cars[length++] = fuel;
+        if(fuel > max_fuel) {
+          max_fuel = fuel;
+        }
+        checksum += 1 + max_fuel;
+      }
+      clock_gettime(CLOCK_MONOTONIC, &end);
+
+      latencies[i] = elapsed_seconds(&start, &end);
+    }
+
+    double total = 0;
+    for(uint i = 0; i < CAR_OPERATIONS; ++i) {
+      total += latencies[i];
+    }
+    qsort(latencies, CAR_OPERATIONS, sizeof(double), compare_doubles);
+
+    printf("\t%-10s %6d operations: mean %10.2f us, p50 %10.2f us, p99 %10.2f us, max %10.2f us (checksum %ld)\n", 
+      names[use_runs], CAR_OPERATIONS, total / CAR_OPERATIONS * 1e6, latencies[CAR_OPERATIONS / 2] * 1e6, 
+      latencies[(CAR_OPERATIONS * 99) / 100] * 1e6, latencies[CAR_OPERATIONS - 1] * 1e6, checksum);
+  }
+
+  free(cars);
+  free(latencies);
+  delete_station(multiset);
+}
+
+//-------------------------------------------------------------------------------------
+
+/**
+ * Number of runs of the stations created by aggiungi-stazione before they were taken from the pool of the highway.
+*/
+#define LEGACY_STATION_CAPACITY 32
+
+/**
+ * @struct legacy_station
+ * @brief Station as it was before the inline runs: the struct and its runs are two separate allocations.
+*/
+typedef struct legacy_station {
+  matrix_size distance;
+  fuel_run * runs;
+  matrix_size capacity;
+  matrix_size n_runs;
+  matrix_size length;
+  matrix_size car_max_fuel;
+} legacy_station;
+
+/**
+ * @brief Bytes of heap in use by the process (allocated chunks, with their headers, and mapped blocks).
+*/
+size_t heap_in_use() {
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+}
+
+void benchmark_memory(uint n) {
+  struct timespec start, end;
+
+  printf("Memory of %d stations\n", n);
+
+  legacy_station ** legacy = (legacy_station **) malloc(sizeof(legacy_station *) * (n > 0 ? n : 1));
+  station ** stations = (station **) malloc(sizeof(station *) * (n > 0 ? n : 1));
+  if(legacy == NULL || stations == NULL) {
+    printf("\tNot enough memory\n");
+    free(legacy);
+    free(stations);
+    return;
+  }
+
+  const char * names[] = {"legacy", "heap", "pool"};
+  const matrix_size profiles[] = {1, STATION_INLINE_RUNS, 8};
+
+  for(uint p = 0; p < sizeof(profiles) / sizeof(profiles[0]); ++p) {
+    matrix_size fuels[8];
+    for(matrix_size k = 0; k < profiles[p]; ++k) {
+      fuels[k] = 10 * (k + 1);
+    }
+
+    for(uint layout = 0; layout < 3; ++layout) {
+      // Every layout gets a new highway, so the pool starts with no slab
+      highway * highway = create_highway(1);
+      size_t before = heap_in_use();
+      uint built = 1;
+
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for(matrix_size i = 0; i < n; ++i) {
+        if(layout == 0) {
+          legacy_station * s = (legacy_station *) malloc(sizeof(legacy_station));
+          built = built && s != NULL;
+          if(s != NULL) {
+            s->runs = (fuel_run *) malloc(sizeof(fuel_run) * LEGACY_STATION_CAPACITY);
+            s->distance = i;
+            s->capacity = LEGACY_STATION_CAPACITY;
+            s->n_runs = profiles[p];
+            s->length = profiles[p];
+            s->car_max_fuel = fuels[profiles[p] - 1];
+            for(matrix_size k = 0; s->runs != NULL && k < profiles[p]; ++k) {
+              s->runs[k].fuel = fuels[k];
+              s->runs[k].count = 1;
+            }
+            built = built && s->runs != NULL;
+          }
+          legacy[i] = s;
+        }
+        else {
+          stations[i] = layout == 1 || highway == NULL ? create_station(i, 0) : create_pooled_station(highway, i, 0);
+          built = built && stations[i] != NULL && add_cars(stations[i], fuels, profiles[p]);
+        }
+      }
+      clock_gettime(CLOCK_MONOTONIC, &end);
+
+      size_t bytes = heap_in_use() - before;
+
+      printf("\t%d runs %-8s %8.2f bytes/station, built in %8.4f s%s\n", profiles[p], names[layout], 
+        n > 0 ? (double) bytes / n : 0, elapsed_seconds(&start, &end), built ? "" : " (not enough memory)");
+
+      for(matrix_size i = 0; i < n; ++i) {
+        if(layout == 0) {
+          if(legacy[i] != NULL) {
+            free(legacy[i]->runs);
+          }
+          free(legacy[i]);
+        }
+        else {
+          delete_station(stations[i]);
+        }
+      }
+      delete_highway(highway);
+    }
+  }
+
+  free(legacy);
+  free(stations);
+}
+
+//-------------------------------------------------------------------------------------
+
+#define SEARCH_QUERIES 1000000
+
+/**
+ * @brief Search the element nearest to target by recursive binary search, as find_station did before lower_bound.
+*/
+int recursive_search(const matrix_size * distances, int a, int b, int target) {
+  if(a >= b) {
+    return b;
+  }
+
+  int m = (a + b) / 2;
+  if(distances[m] == target) {
+    return m;
+  }
+
+  return target < distances[m] ? recursive_search(distances, a, m - 1, target) : 
+                                  recursive_search(distances, m + 1, b, target);
+}
+
+void print_search(const char * name, double seconds, long checksum) {
+  printf("\t%-10s %8d searches in %8.4f s -> %8.2f ns/search (checksum %ld)\n", name, SEARCH_QUERIES, seconds, 
+    seconds / SEARCH_QUERIES * 1e9, checksum);
+}
+
+void benchmark_search(uint n) {
+  struct timespec start, end;
+
+  printf("Searches of stations among %d stations\n", n);
+
+  matrix_size * distances = (matrix_size *) malloc(sizeof(matrix_size) * (n > 0 ? n : 1));
+  matrix_size * targets = (matrix_size *) malloc(sizeof(matrix_size) * SEARCH_QUERIES);
+  if(n == 0 || distances == NULL || targets == NULL) {
+    printf("\tNot enough memory\n");
+    free(distances);
+    free(targets);
+    return;
+  }
+
+  srand(n);
+  for(matrix_size i = 0; i < n; ++i) {
+    distances[i] = (i > 0 ? distances[i - 1] : 0) + 1 + rand() % 16;
+  }
+  for(uint q = 0; q < SEARCH_QUERIES; ++q) {
+    targets[q] = distances[rand() % n];
+  }
+
+  long checksum = 0;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(uint q = 0; q < SEARCH_QUERIES; ++q) {
+    checksum += recursive_search(distances, 0, n - 1, targets[q]);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  print_search("recursive", elapsed_seconds(&start, &end), checksum);
+
+  checksum = 0;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(uint q = 0; q < SEARCH_QUERIES; ++q) {
+    checksum += lower_bound(distances, n, targets[q]);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  print_search("branchless", elapsed_seconds(&start, &end), checksum);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  eytzinger_index * index = create_eytzinger_index(distances, n);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  if(index == NULL) {
+    printf("\tNot enough memory for the Eytzinger index\n");
+  }
+  else {
+    printf("\t%-10s built in %8.4f s\n", "eytzinger", elapsed_seconds(&start, &end));
+
+    checksum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(uint q = 0; q < SEARCH_QUERIES; ++q) {
+      checksum += eytzinger_lower_bound(index, targets[q]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    print_search("eytzinger", elapsed_seconds(&start, &end), checksum);
+  }
+
+  delete_eytzinger_index(index);
+  free(distances);
+  free(targets);
+}
+
+//-------------------------------------------------------------------------------------
+
+#define LOOKUP_OPERATIONS 1000000
+
+/**
+ * @brief Add a car to the station at a given distance finding it by binary search, as add_car_by_distance did before 
+ * the hash table of the highway.
+*/
+matrix_size searched_add_car(highway * highway, matrix_size distance, matrix_size fuel) {
+  matrix_size index = lower_bound(highway->distance, highway->length, distance);
+  if(index == highway->length || highway->distance[index] != distance) {
+    return 0;
+  }
+
+  matrix_size result = add_car(highway->stations[index], fuel);
+  highway->max_fuel[index] = highway->stations[index]->car_max_fuel;
+  return result;
+}
+
+/**
+ * @brief Remove a car from the station at a given distance finding it by binary search (see searched_add_car).
+*/
+matrix_size searched_remove_car(highway * highway, matrix_size distance, matrix_size fuel) {
+  matrix_size index = lower_bound(highway->distance, highway->length, distance);
+  if(index == highway->length || highway->distance[index] != distance) {
+    return 0;
+  }
+
+  matrix_size result = remove_car(highway->stations[index], fuel);
+  highway->max_fuel[index] = highway->stations[index]->car_max_fuel;
+  return result;
+}
+
+void benchmark_lookup(uint n) {
+  struct timespec start, end;
+
+  printf("Additions and scrappings of cars on %d stations\n", n);
+
+  highway * highway = create_highway(n > 0 ? n : 1);
+  matrix_size * targets = (matrix_size *) malloc(sizeof(matrix_size) * LOOKUP_OPERATIONS);
+  if(n == 0 || highway == NULL || targets == NULL) {
+    printf("\tNot enough memory\n");
+    delete_highway(highway);
+    free(targets);
+    return;
+  }
+
+  srand(n);
+  uint built = 1;
+  for(matrix_size i = 0; built && i < n; ++i) {
+    station * new_station = create_pooled_station(highway, 10 * i, 0);
+    built = new_station != NULL && add_car(new_station, 100 + rand() % 1000) && add_station(highway, new_station);
+  }
+  for(uint q = 0; q < LOOKUP_OPERATIONS; ++q) {
+    // A tenth of the commands name a distance without station
+    targets[q] = 10 * (rand() % n) + (q % 10 == 0 ? 5 : 0);
+  }
+
+  if(!built) {
+    printf("\tUnable to build the highway\n");
+    delete_highway(highway);
+    free(targets);
+    return;
+  }
+
+  const char * names[] = {"search", "hash"};
+
+  for(uint use_hash = 0; use_hash < 2; ++use_hash) {
+    long checksum = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(uint q = 0; q < LOOKUP_OPERATIONS; ++q) {
+      matrix_size fuel = 1 + q % 50;
+
+      if(use_hash) {
+        checksum += add_car_by_distance(highway, targets[q], fuel);
+        checksum += remove_car_by_distance(highway, targets[q], fuel);
+      }
+      else {
+        checksum += searched_add_car(highway, targets[q], fuel);
+        checksum += searched_remove_car(highway, targets[q], fuel);
+      }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = elapsed_seconds(&start, &end);
+    printf("\t%-8s %8d commands in %8.4f s -> %8.2f ns/command (checksum %ld)\n", names[use_hash], 
+      2 * LOOKUP_OPERATIONS, seconds, seconds / (2 * LOOKUP_OPERATIONS) * 1e9, checksum);
+  }
+
+  delete_highway(highway);
+  free(targets);
+}
+
+//-------------------------------------------------------------------------------------
+
+#define DEMOLITIONS 10000
+
+/**
+ * @brief Remove the station at a given distance moving all the stations after it, as remove_station did before 
+ * tombstones.
+*/
+matrix_size shifted_remove_station(highway * highway, matrix_size distance) {
+  matrix_size index = lower_bound(highway->distance, highway->length, distance);
+  if(index == highway->length || highway->distance[index] != distance) {
+    return 0;
+  }
+
+  station * removed = highway->stations[index];
+
+  matrix_size moved = highway->length - index - 1;
+  memmove(highway->distance + index, highway->distance + index + 1, sizeof(matrix_size) * moved);
+  memmove(highway->max_fuel + index, highway->max_fuel + index + 1, sizeof(matrix_size) * moved);
+  memmove(highway->stations + index, highway->stations + index + 1, sizeof(station *) * moved);
+
+  highway->stations[--highway->length] = NULL;
+  hash_remove(highway->lookup, distance);
+  delete_station(removed);
+
+  return 1;
+}
+
+void benchmark_demolition(uint n) {
+  struct timespec start, end;
+
+  uint demolitions = n / 2 < DEMOLITIONS ? n / 2 : DEMOLITIONS;
+  printf("Latency of %d demolitions on %d stations\n", demolitions, n);
+
+  matrix_size * targets = (matrix_size *) malloc(sizeof(matrix_size) * (n > 0 ? n : 1));
+  double * latencies = (double *) malloc(sizeof(double) * (demolitions > 0 ? demolitions : 1));
+  if(demolitions == 0 || targets == NULL || latencies == NULL) {
+    printf("\tNot enough memory\n");
+    free(targets);
+    free(latencies);
+    return;
+  }
+
+  // The stations demolished are the first of a random permutation of the distances
+  srand(n);
+  for(uint i = 0; i < n; ++i) {
+    targets[i] = 10 * i;
+  }
+  for(uint i = 0; i < demolitions; ++i) {
+    uint j = i + (((uint) rand() << 16) ^ (uint) rand()) % (n - i);
+    matrix_size swap = targets[i];
+    targets[i] = targets[j];
+    targets[j] = swap;
+  }
+
+  const char * names[] = {"shift", "tombstone"};
+
+  for(uint tombstones = 0; tombstones < 2; ++tombstones) {
+    highway * highway = create_highway(n);
+    uint built = highway != NULL;
+    for(matrix_size i = 0; built && i < n; ++i) {
+      station * new_station = create_pooled_station(highway, 10 * i, 0);
+      built = new_station != NULL && add_car(new_station, 100 + i % 1000) && add_station(highway, new_station);
+    }
+
+    if(!built) {
+      printf("\tUnable to build the highway\n");
+      delete_highway(highway);
+      break;
+    }
+
+    uint removed = 0;
+    for(uint q = 0; q < demolitions; ++q) {
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      removed += tombstones ? remove_station(highway, targets[q]) : shifted_remove_station(highway, targets[q]);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+
+      latencies[q] = elapsed_seconds(&start, &end);
+    }
+
+    print_latencies(names[tombstones], latencies, demolitions);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    matrix_size compacted = compact_highway(highway);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("\t%-10s %8d removed, %8d tombstones compacted in %8.4f s\n", names[tombstones], removed, compacted, 
+      elapsed_seconds(&start, &end));
+
+    delete_highway(highway);
+  }
+
+  free(targets);
+  free(latencies);
+}
+
+//-------------------------------------------------------------------------------------
+
+/**
+ * Stations above which the highway is not populated one station at a time (which takes O(n^2)).
+*/
+#define LOAD_MAX_ONE_BY_ONE 200000
+
+void benchmark_load(uint n) {
+  struct timespec start, end;
+
+  printf("Population of an highway with %d stations in random order\n", n);
+
+  station ** stations = (station **) malloc(sizeof(station *) * (n > 0 ? n : 1));
+  matrix_size * added = (matrix_size *) malloc(sizeof(matrix_size) * (n > 0 ? n : 1));
+  if(n == 0 || stations == NULL || added == NULL) {
+    printf("\tNot enough memory\n");
+    free(stations);
+    free(added);
+    return;
+  }
+
+  const char * names[] = {"one by one", "bulk"};
+
+  for(uint bulk = n > LOAD_MAX_ONE_BY_ONE; bulk < 2; ++bulk) {
+    highway * highway = create_highway(1);
+    uint built = highway != NULL;
+
+    // The same random permutation of the distances for both the highways, with a car each
+    srand(n);
+    for(matrix_size i = 0; built && i < n; ++i) {
+      stations[i] = create_pooled_station(highway, 10 * i, 0);
+      built = stations[i] != NULL && add_car(stations[i], 100 + i % 1000);
+    }
+    for(matrix_size i = n - 1; built && i > 0; --i) {
+      matrix_size j = (((uint) rand() << 16) ^ (uint) rand()) % (i + 1);
+      station * swap = stations[i];
+      stations[i] = stations[j];
+      stations[j] = swap;
+    }
+
+    if(!built) {
+      printf("\tUnable to build the stations\n");
+      delete_highway(highway);
+      break;
+    }
+
+    long loaded = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(bulk) {
+      loaded = add_stations(highway, stations, n, added);
+    }
+    else {
+      for(matrix_size i = 0; i < n; ++i) {
+        loaded += add_station(highway, stations[i]);
+      }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = elapsed_seconds(&start, &end);
+    printf("\t%-10s %8ld stations in %8.4f s -> %10.0f stations/s\n", names[bulk], loaded, seconds, loaded / seconds);
+
+    delete_highway(highway);
+  }
+
+  free(stations);
+  free(added);
+}
+
+//-------------------------------------------------------------------------------------
+
+/**
+ * Stations above which the forward routes are not solved with min_stops (which takes O(n^2) on them).
+*/
+#define FORWARD_MAX_QUADRATIC 20000
+
+void benchmark_forward(uint n) {
+  struct timespec start, end;
+
+  printf("Forward route through %d stations with cars which reach the next 1 to 3 stations\n", n);
+
+  matrix_size * stations = (matrix_size *) malloc(sizeof(matrix_size) * (n > 0 ? n : 1));
+  matrix_size * cars = (matrix_size *) malloc(sizeof(matrix_size) * (n > 0 ? n : 1));
+  if(n == 0 || stations == NULL || cars == NULL) {
+    printf("\tNot enough memory\n");
+    free(stations);
+    free(cars);
+    return;
+  }
+
+  srand(n);
+  for(matrix_size i = 0; i < n; ++i) {
+    stations[i] = 10 * i;
+    cars[i] = 10 * (1 + rand() % 3);
+  }
+
+  const char * names[] = {"min_stops", "layers"};
+  matrix_size * solutions[2] = {NULL, NULL};
+  int stops[2] = {no_solution, no_solution};
+
+  for(uint layers = n > FORWARD_MAX_QUADRATIC; layers < 2; ++layers) {
+    unsigned long before = heap_allocations;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(layers) {
+      stops[layers] = min_stops_layers(stations, n, cars, &solutions[layers]);
+    }
+    else {
+      stops[layers] = min_stops(stations, n, cars, &solutions[layers]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("\t%-10s %8d stops in %10.6f s, %3lu heap allocations\n", names[layers], stops[layers], 
+      elapsed_seconds(&start, &end), heap_allocations - before);
+  }
+
+  if(n <= FORWARD_MAX_QUADRATIC) {
+    uint matching = stops[0] == stops[1];
+    for(int i = 0; matching && stops[0] >= 0 && i < stops[0] + 2; ++i) {
+      matching = solutions[0][i] == solutions[1][i];
+    }
+    printf("\tRoutes matching: %d\n", matching);
+  }
+
+  free(solutions[0]);
+  free(solutions[1]);
+  free(stations);
+  free(cars);
+}
@@ -0,0 +1,29 @@
+#ifndef _BENCHMARK_
+#define _BENCHMARK_
+
+/**
+ * @headerfile benchmark.h
+ * @brief Interface of benchmark.c
+*/
+
+void benchmark_reader(const char * path);
+void benchmark_parse(const char * path);
+void benchmark_numbers();
+void benchmark_encoding(const char * path);
+void benchmark_executor(const char * path);
+void benchmark_server(const char * path);
+void benchmark_snapshot(const char * path);
+void benchmark_journal(const char * path);
+void benchmark_batch(const char * path);
+void benchmark_churn(unsigned int stations);
+void benchmark_layout(unsigned int stations);
+void benchmark_plan(unsigned int length);
+void benchmark_cars(unsigned int cars);
+void benchmark_memory(unsigned int stations);
+void benchmark_search(unsigned int stations);
+void benchmark_lookup(unsigned int stations);
+void benchmark_demolition(unsigned int stations);
+void benchmark_load(unsigned int stations);
+void benchmark_forward(unsigned int stations);
+                    
+#endif
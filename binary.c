@@ -0,0 +1,186 @@
+/**
+ * @file binary.c
+ * @brief Contains functions to encode and decode commands in binary format.
+*/
+
+#include "binary.h"
+#include <stdlib.h>
+
+#define NDEBUG
+
+#ifndef NDEBUG
+#include <stdio.h>
+#endif
+
+uint encode_varint(uint value, unsigned char * out) {
+    uint n = 0;
+
+    while(value >= 0x80) {
+        out[n++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (unsigned char) value;
+
+    return n;
+}
+
+uint decode_varint(const unsigned char * data, uint length, uint * value) {
+    uint result = 0;
+
+    for(uint i = 0; i < length && i < VARINT_MAX_LENGTH; ++i) {
+        if(i == VARINT_MAX_LENGTH - 1 && data[i] > 0x0F) {
+            return 0;
+        }
+
+        result |= (uint) (data[i] & 0x7F) << (7 * i);
+
+        if((data[i] & 0x80) == 0) {
+            *value = result;
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+uint record_max_length(const instruction * instruction) {
+    return VARINT_MAX_LENGTH + 1 + VARINT_MAX_LENGTH * instruction->params_length;
+}
+
+uint encode_instruction(const instruction * instruction, unsigned char * out) {
+    return encode_command(instruction->command, instruction->params, instruction->params_length, out);
+}
+
+uint encode_command(command_type command, const uint * params, uint length, unsigned char * out) {
+    unsigned char prefix[VARINT_MAX_LENGTH];
+
+    uint payload_length = 1;
+    for(uint i = 0; i < length; ++i) {
+        payload_length += encode_varint(params[i], prefix);
+    }
+
+    uint n = encode_varint(payload_length, out);
+    out[n++] = (unsigned char) command;
+
+    for(uint i = 0; i < length; ++i) {
+        n += encode_varint(params[i], out + n);
+    }
+
+    return n;
+}
+
+/**
+ * @brief Count the parameters of a payload (the bytes which end a varint).
+*/
+uint count_parameters(const unsigned char * payload, uint length) {
+    uint num_params = 0;
+    for(uint i = 1; i < length; ++i) {
+        num_params += (payload[i] & 0x80) == 0;
+    }
+
+    return num_params;
+}
+
+/**
+ * @brief Decode the parameters of a payload in the array of an instruction.
+ * 
+ * @pre instr->params has room for count_parameters(payload, length) parameters.
+ * 
+ * @returns 1 if every parameter is decoded (the command is set), 0 if the payload is malformed.
+*/
+uint decode_parameters(const unsigned char * payload, uint length, instruction * instr) {
+    uint position = 1;
+    while(position < length) {
+        uint n = decode_varint(payload + position, length - position, &instr->params[instr->params_length]);
+        if(n == 0) {
+            #ifndef NDEBUG
+            printf("\tMalformed parameter at byte %d\n", position);
+            #endif
+
+            return 0;
+        }
+
+        position += n;
+        ++instr->params_length;
+    }
+
+    instr->command = (command_type) payload[0];
+
+    return 1;
+}
+
+instruction * decode_instruction(const unsigned char * payload, uint length) {
+    #ifndef NDEBUG
+    printf("Starting decode_instruction\n");
+    #endif
+
+    instruction * instr = (instruction *) malloc(sizeof(instruction));
+    if(instr == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough space to allocate instruction of size %ld\n", sizeof(instruction));
+        #endif
+
+        return NULL;
+    }
+
+    instr->command = no_command;
+    instr->params = NULL;
+    instr->params_length = 0;
+
+    if(length == 0 || payload[0] >= no_command) {
+        #ifndef NDEBUG
+        printf("\tCommand not codified\n");
+        #endif
+
+        return instr;
+    }
+
+    uint num_params = count_parameters(payload, length);
+
+    if(num_params > 0) {
+        instr->params = (uint *) malloc(sizeof(uint) * num_params);
+        if(instr->params == NULL) {
+            #ifndef NDEBUG
+            printf("\tNot enough space to allocate array of %ld bytes\n", sizeof(uint) * num_params);
+            #endif
+
+            delete_instruction(instr);
+            return NULL;
+        }
+    }
+
+    if(!decode_parameters(payload, length, instr)) {
+        free(instr->params);
+        instr->params = NULL;
+        instr->params_length = 0;
+    }
+
+    #ifndef NDEBUG
+    printf("Ending decode_instruction\n");
+    #endif
+
+    return instr;
+}
+
+uint decode_instruction_into(const unsigned char * payload, uint length, parse_arena * arena, instruction * instr) {
+    instr->command = no_command;
+    instr->params = NULL;
+    instr->params_length = 0;
+
+    if(length == 0 || payload[0] >= no_command) {
+        return 1;
+    }
+
+    uint num_params = count_parameters(payload, length);
+
+    if(num_params > 0 && (instr->params = arena_parameters(arena, num_params)) == NULL) {
+        return 0;
+    }
+
+    if(!decode_parameters(payload, length, instr)) {
+        instr->params = NULL;
+        instr->params_length = 0;
+    }
+
+    return 1;
+}
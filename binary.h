@@ -0,0 +1,116 @@
+#ifndef _BINARY_
+#define _BINARY_
+
+/**
+ * @headerfile binary.h
+ * @brief Interface of binary.c
+ * 
+ * A binary command stream starts with BINARY_MAGIC and is a sequence of records; every record is the varint length 
+ * of its payload followed by the payload, an opcode byte (the command_type) and the varint parameters, in the 
+ * same order of the text format.
+ * 
+ * A binary reply is a byte command * 2 + positive (for example add_station_command * 2 + 1 is "aggiunta"); the
+ * positive reply of a plan is followed by the varint number of stations and their varint distances. A syntax error
+ * is the byte SYNTAX_ERROR_REPLY.
+*/
+
+#include "parser.h"
+
+/**
+ * Bytes which start a binary command stream (a text stream cannot start with '\0').
+*/
+#define BINARY_MAGIC "\0HW1"
+#define BINARY_MAGIC_LENGTH 4
+
+/**
+ * Maximum number of bytes of a varint.
+*/
+#define VARINT_MAX_LENGTH 5
+
+/**
+ * Reply to a command which does not respect the syntax.
+*/
+#define SYNTAX_ERROR_REPLY (no_command * 2)
+
+/**
+ * @brief Encode an unsigned integer in LEB128 format (7 bits per byte, least significant first).
+ * 
+ * @param value The value to encode.
+ * @param out Pointer to the destination, at least VARINT_MAX_LENGTH bytes long.
+ * 
+ * @returns The number of bytes written.
+*/
+uint encode_varint(uint value, unsigned char * out);
+
+/**
+ * @brief Decode an unsigned integer in LEB128 format.
+ * 
+ * @param data Pointer to the encoded value.
+ * @param length Number of bytes avaible.
+ * @param value Address where the value will be put.
+ * 
+ * @returns The number of bytes read, 0 if the value is truncated or does not fit in an unsigned int.
+*/
+uint decode_varint(const unsigned char * data, uint length, uint * value);
+
+/**
+ * @brief Compute the length of the record of an instruction.
+ * 
+ * @param instruction Pointer to the instruction to encode.
+ * 
+ * @pre instruction != NULL
+ * 
+ * @returns An upper bound of the bytes of the record, length prefix included.
+*/
+uint record_max_length(const instruction * instruction);
+
+/**
+ * @brief Encode an instruction as a record.
+ * 
+ * @param instruction Pointer to the instruction to encode.
+ * @param out Pointer to the destination, at least record_max_length(instruction) bytes long.
+ * 
+ * @pre instruction != NULL
+ * 
+ * @returns The number of bytes written, length prefix included.
+*/
+uint encode_instruction(const instruction * instruction, unsigned char * out);
+
+/**
+ * @brief Encode a command and its parameters as a record, without an instruction.
+ * 
+ * @param command Code of the command.
+ * @param params Pointer to the parameters of the command.
+ * @param length Number of parameters.
+ * @param out Pointer to the destination, at least VARINT_MAX_LENGTH * (length + 1) + 1 bytes long.
+ * 
+ * @returns The number of bytes written, length prefix included.
+*/
+uint encode_command(command_type command, const uint * params, uint length, unsigned char * out);
+
+/**
+ * @brief Decode the payload of a record.
+ * 
+ * @param payload Pointer to the payload (the record without its length prefix).
+ * @param length Number of bytes of the payload.
+ * 
+ * @returns Pointer to the instruction allocated on heap (with command no_command if the payload is malformed), 
+ *          NULL if there is not enough memory.
+*/
+instruction * decode_instruction(const unsigned char * payload, uint length);
+
+/**
+ * @brief Decode the payload of a record into a caller owned instruction.
+ * 
+ * Same as decode_instruction, but the parameters are stored in the arena (see parse_line_into).
+ * 
+ * @param payload Pointer to the payload (the record without its length prefix).
+ * @param length Number of bytes of the payload.
+ * @param arena Pointer to the arena which stores the parameters.
+ * @param instr Pointer to the instruction to fill (with command no_command if the payload is malformed).
+ * 
+ * @returns 1 if the payload is decoded, 0 if there is not enough memory (the command is no_command).
+*/
+uint decode_instruction_into(const unsigned char * payload, uint length, parse_arena * arena, instruction * instr);
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * @file convert.c
+ * @brief Convert commands from text to binary format and replies from binary to text format.
+ *
+ * Usage: convert [-r] < input > output
+ *  - without options, text commands are converted to a binary command stream;
+ *  - with -r, binary replies are converted to text replies (to compare them with the expected outputs).
+*/
+
+#include "binary.h"
+#include "executor.h"
+#include "parser.h"
+#include "reader.h"
+#include "writer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BUFFER_CAPACITY (1 << 16)
+
+int convert_commands(reader * input, writer * output) {
+    unsigned char * record = NULL;
+    uint record_capacity = 0;
+
+    write_text(output, BINARY_MAGIC, BINARY_MAGIC_LENGTH);
+
+    parse_arena * arena = create_parse_arena(STD_ARENA_CAPACITY);
+    if(arena == NULL) {
+        fprintf(stderr, "Not enough memory to parse a command\n");
+
+        return 1;
+    }
+
+    instruction instruction;
+    read_result read = line_read;
+
+    while((read = next_instruction_into(input, text_format, arena, &instruction)) == line_read) {
+        if(record_max_length(&instruction) > record_capacity) {
+            record_capacity = record_max_length(&instruction) * 2;
+
+            free(record);
+            record = (unsigned char *) malloc(record_capacity);
+            if(record == NULL) {
+                fprintf(stderr, "Not enough memory to encode a command\n");
+                delete_parse_arena(arena);
+
+                return 1;
+            }
+        }
+
+        write_text(output, (char *) record, encode_instruction(&instruction, record));
+    }
+
+    delete_parse_arena(arena);
+    free(record);
+
+    if(read != end_of_input) {
+        fprintf(stderr, "Unable to read the commands (%d)\n", read);
+        return 1;
+    }
+
+    return 0;
+}
+
+uint next_varint(reader * input, uint * value) {
+    ensure_avaible(input, VARINT_MAX_LENGTH);
+
+    uint avaible = input->end - input->begin;
+    uint n = decode_varint((unsigned char *) input->buffer + input->begin, avaible < VARINT_MAX_LENGTH ? avaible : VARINT_MAX_LENGTH, value);
+    input->begin += n;
+
+    return n;
+}
+
+int convert_replies(reader * input, writer * output) {
+    while(ensure_avaible(input, 1) == line_read) {
+        unsigned char reply = input->buffer[input->begin++];
+        uint command = reply / 2, positive = reply % 2;
+
+        if(reply == SYNTAX_ERROR_REPLY) {
+            write_literal(output, "Command syntax error\n");
+        }
+        else if(command >= no_command) {
+            fprintf(stderr, "Malformed reply %d\n", reply);
+            return 1;
+        }
+        else if(command == plan_path_command && positive) {
+            uint length = 0, distance = 0;
+            if(next_varint(input, &length) == 0) {
+                fprintf(stderr, "Malformed path length\n");
+                return 1;
+            }
+
+            for(uint i = 0; i < length; ++i) {
+                if(next_varint(input, &distance) == 0) {
+                    fprintf(stderr, "Malformed path distance\n");
+                    return 1;
+                }
+
+                write_uint(output, distance);
+                write_char(output, i + 1 < length ? ' ' : '\n');
+            }
+        }
+        else if(positive) {
+            write_text(output, POSITIVE_REPLIES[command], strlen(POSITIVE_REPLIES[command]));
+        }
+        else {
+            write_text(output, NEGATIVE_REPLIES[command], strlen(NEGATIVE_REPLIES[command]));
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char * argv[]) {
+    uint replies = 0;
+    int option = 0;
+
+    while((option = getopt(argc, argv, "r")) != -1) {
+        switch(option) {
+            case 'r': replies = 1;
+            break;
+
+            default: fprintf(stderr, "Usage: %s [-r] < input > output\n", argv[0]);
+            return 1;
+        }
+    }
+
+    reader * input = create_mapped_reader(STDIN_FILENO);
+    if(input == NULL) {
+        input = create_reader(STDIN_FILENO, BUFFER_CAPACITY);
+    }
+
+    writer * output = create_writer(STDOUT_FILENO, BUFFER_CAPACITY);
+
+    if(input == NULL || output == NULL) {
+        fprintf(stderr, "Unable to allocate buffers\n");
+        delete_reader(input);
+        delete_writer(output);
+
+        return 1;
+    }
+
+    int return_code = 0;
+    if(replies) {
+        return_code = convert_replies(input, output);
+    }
+    else {
+        return_code = convert_commands(input, output);
+    }
+
+    delete_reader(input);
+    delete_writer(output);
+
+    return return_code;
+}
@@ -0,0 +1,837 @@
+/**
+ * @file executor.c
+ * @brief Execute parsed commands.
+ * 
+ * This module maps every instruction to the station_handler function which executes it and writes the reply, in text 
+ * or binary format, on a writer.
+*/
+
+#include "executor.h"
+#include "binary.h"
+#include "numbers.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define STD_STATION_CAPACITY 32
+
+/**
+ * Numbers decoded at once by the token stream of aggiungi-stazione.
+*/
+#define STREAM_CHUNK 256
+
+#define ADD_STATION_PREFIX "aggiungi-stazione "
+#define ADD_STATION_PREFIX_LENGTH 18
+
+#define LOAD_STATIONS_PREFIX "importa-stazioni "
+#define LOAD_STATIONS_PREFIX_LENGTH 17
+
+const instruction INVALID_INSTRUCTION = {no_command, NULL, 0};
+
+const char * POSITIVE_REPLIES[] = {
+    "aggiunta\n",
+    "demolita\n",
+    "aggiunta\n",
+    "rottamata\n",
+    "",
+    "salvato\n",
+    "aggiunta\n"
+};
+const char * NEGATIVE_REPLIES[] = {
+    "non aggiunta\n",
+    "non demolita\n",
+    "non aggiunta\n",
+    "non rottamata\n",
+    "nessun percorso\n",
+    "non salvato\n",
+    "non aggiunta\n"
+};
+
+uint execute_add_station(executor * executor, const instruction * instruction) {
+    station * station = create_pooled_station(executor->highway, instruction->params[0], 0);
+    if(station == NULL) {
+        return 0;
+    }
+
+    uint result = instruction->params_length <= 2 || 
+                    add_cars(station, instruction->params + 2, instruction->params_length - 2);
+
+    if(result == 1) {
+        result = add_station(executor->highway, station);
+    }
+
+    if(result == 0) {
+        delete_station(station);
+    }
+
+    return result;
+}
+
+uint execute_delete_station(executor * executor, const instruction * instruction) {
+    return remove_station(executor->highway, instruction->params[0]);
+}
+
+uint execute_add_car(executor * executor, const instruction * instruction) {
+    return add_car_by_distance(executor->highway, instruction->params[0], instruction->params[1]);
+}
+
+uint execute_remove_car(executor * executor, const instruction * instruction) {
+    return remove_car_by_distance(executor->highway, instruction->params[0], instruction->params[1]);
+}
+
+uint execute_save_state(executor * executor) {
+    if(executor->snapshot_path == NULL) {
+        return 0;
+    }
+
+    if(executor->journal != NULL) {
+        return compact_journal(executor->journal, executor->highway, executor->snapshot_path);
+    }
+
+    return save_snapshot(executor->highway, executor->snapshot_path, 0) == snapshot_done;
+}
+
+/**
+ * @brief Record a mutation in the journal of the executor (if any) when it is accepted.
+ * 
+ * @returns The result of the mutation.
+*/
+uint journal_mutation(executor * executor, const instruction * instruction, uint result) {
+    if(result && executor->journal != NULL) {
+        journal_append(executor->journal, instruction);
+    }
+
+    return result;
+}
+
+/**
+ * @brief Record a mutation given by its command and parameters in the journal of the executor (if any) when it is 
+ * accepted.
+ * 
+ * @returns The result of the mutation.
+*/
+uint journal_command(executor * executor, command_type command, const uint * params, uint length, uint result) {
+    if(result && executor->journal != NULL) {
+        journal_append_command(executor->journal, command, params, length);
+    }
+
+    return result;
+}
+
+void write_reply(executor * executor, command_type command, uint positive) {
+    if(executor->replies == binary_format) {
+        write_char(executor->output, (char) (command * 2 + (positive != 0)));
+    }
+    else if(positive) {
+        write_text(executor->output, POSITIVE_REPLIES[command], strlen(POSITIVE_REPLIES[command]));
+    }
+    else {
+        write_text(executor->output, NEGATIVE_REPLIES[command], strlen(NEGATIVE_REPLIES[command]));
+    }
+}
+
+void write_path(executor * executor, const matrix_size * solution, int stops) {
+    writer * output = executor->output;
+
+    if(executor->replies == binary_format) {
+        unsigned char varint[VARINT_MAX_LENGTH];
+
+        write_reply(executor, plan_path_command, 1);
+        write_text(output, (char *) varint, encode_varint(stops + 2, varint));
+        for(int i = 0; i < stops + 2; ++i) {
+            write_text(output, (char *) varint, encode_varint(solution[i], varint));
+        }
+
+        return;
+    }
+
+    for(int i = 0; i < stops + 1; ++i) {
+        write_uint(output, solution[i]);
+        write_char(output, ' ');
+    }
+    write_uint(output, solution[stops + 1]);
+    write_char(output, '\n');
+}
+
+/**
+ * @brief Plan the path between two stations and write it.
+*/
+void plan_and_reply(executor * executor, matrix_size start, matrix_size end) {
+    matrix_size * solution = NULL;
+    direction dir = forward;
+    if(start > end) {
+        dir = backward;
+    }
+
+    int stops = plan_path(executor->highway, start, end, dir, &solution);
+
+    if(stops >= 0) {
+        write_path(executor, solution, stops);
+    }
+    else {
+        write_reply(executor, plan_path_command, 0);
+    }
+
+    free(solution);
+}
+
+void execute_plan_path(executor * executor, const instruction * instruction) {
+    plan_and_reply(executor, instruction->params[0], instruction->params[1]);
+}
+
+void write_syntax_error(executor * executor) {
+    if(executor->replies == binary_format) {
+        write_char(executor->output, SYNTAX_ERROR_REPLY);
+    }
+    else {
+        write_literal(executor->output, "Command syntax error\n");
+    }
+}
+
+/**
+ * @brief Add the stations of an importa-stazioni instruction to the highway together (see add_stations), and write the 
+ * reply of aggiungi-stazione for each one, in the order of the instruction.
+ *
+ * @pre The instruction is valid.
+*/
+void execute_load_stations(executor * executor, const instruction * instruction) {
+    const uint * params = instruction->params;
+
+    uint n_stations = 0;
+    for(uint i = 0; i < instruction->params_length; i += params[i + 1] + 2) {
+        ++n_stations;
+    }
+
+    // The stations are built only if both arrays are allocated, and they are NULL until then
+    station ** stations = (station **) calloc(n_stations, sizeof(station *));
+    matrix_size * added = (matrix_size *) malloc(sizeof(matrix_size) * n_stations);
+    int result = mem_error;
+
+    if(stations != NULL && added != NULL) {
+        // A station which cannot be built is left NULL, and it is not added
+        for(uint i = 0, k = 0; k < n_stations; i += params[i + 1] + 2, ++k) {
+            stations[k] = create_pooled_station(executor->highway, params[i], 0);
+            if(stations[k] != NULL && !add_cars(stations[k], params + i + 2, params[i + 1])) {
+                delete_station(stations[k]);
+                stations[k] = NULL;
+            }
+        }
+
+        result = add_stations(executor->highway, stations, n_stations, added);
+    }
+
+    for(uint k = 0; k < n_stations; ++k) {
+        uint positive = result >= 0 && added[k];
+        write_reply(executor, add_station_command, positive);
+
+        if(stations != NULL && added != NULL && !positive) {
+            delete_station(stations[k]);
+        }
+    }
+
+    journal_mutation(executor, instruction, result > 0);
+
+    free(stations);
+    free(added);
+}
+
+void execute_command(executor * executor, const instruction * instruction) {
+    
+    if(validate_instruction(instruction)) {
+        switch(instruction->command) {
+            
+            case add_station_command: write_reply(executor, add_station_command, 
+                journal_mutation(executor, instruction, execute_add_station(executor, instruction)));
+            break;
+
+            case delete_station_command: write_reply(executor, delete_station_command, 
+                journal_mutation(executor, instruction, execute_delete_station(executor, instruction)));
+            break;
+
+            case add_car_command: write_reply(executor, add_car_command, 
+                journal_mutation(executor, instruction, execute_add_car(executor, instruction)));
+            break;
+            
+            case remove_car_command: write_reply(executor, remove_car_command, 
+                journal_mutation(executor, instruction, execute_remove_car(executor, instruction)));
+            break;
+            
+            case plan_path_command: execute_plan_path(executor, instruction);
+            break;
+
+            case save_state_command: write_reply(executor, save_state_command, execute_save_state(executor));
+            break;
+
+            case load_stations_command: execute_load_stations(executor, instruction);
+            break;
+
+            case no_command:
+            break;
+        }
+    }
+    else {
+        write_syntax_error(executor);
+    }
+}
+
+/**
+ * @struct station_builder
+ * @brief State of an aggiungi-stazione command whose parameters are decoded a view at a time.
+ * 
+ * @param decoded Number of parameters decoded.
+ * @param distance Distance of the station (the first parameter).
+ * @param station Pointer to the station, created from the pool of the highway by finish_station.
+ * @param result 1 while every car is added to the station, 0 otherwise.
+ * @param out_of_range Number of parameters out of range.
+ * @param cars Fuels of the cars decoded, added to the station together by finish_station.
+ * @param n_cars Number of cars decoded.
+ * @param capacity Capacity of cars.
+*/
+typedef struct station_builder {
+    uint decoded;
+    matrix_size distance;
+    station * station;
+    uint result;
+    uint out_of_range;
+    matrix_size * cars;
+    uint n_cars;
+    uint capacity;
+} station_builder;
+
+/**
+ * @brief Append the fuel of a car to the cars of a builder, doubling their capacity when they are full.
+ *
+ * @returns 1 if the car is appended, 0 if there is not enough memory.
+*/
+uint append_car(station_builder * builder, matrix_size fuel) {
+    if(builder->n_cars == builder->capacity) {
+        uint capacity = builder->capacity > 0 ? builder->capacity * 2 : STD_STATION_CAPACITY;
+        matrix_size * cars = (matrix_size *) realloc(builder->cars, sizeof(matrix_size) * capacity);
+        if(cars == NULL) {
+            return 0;
+        }
+
+        builder->cars = cars;
+        builder->capacity = capacity;
+    }
+
+    builder->cars[builder->n_cars++] = fuel;
+    return 1;
+}
+
+/**
+ * @brief Decode the parameters of a view and apply them to the station being built.
+ *
+ * The numbers are decoded together by decode_number_list in chunks of STREAM_CHUNK, and the fuel of every car is 
+ * appended to the cars of the builder, which are sorted into the runs of the station at once by finish_station.
+*/
+void build_station(station_builder * builder, const char * text, uint length) {
+    uint values[STREAM_CHUNK];
+
+    for(uint position = 0; position <= length; ) {
+        uint consumed = 0;
+        uint n = decode_number_list(text + position, length - position, ' ', values, STREAM_CHUNK, &consumed, 
+                    &builder->out_of_range);
+        position += consumed;
+
+        for(uint k = 0; k < n; ++k, ++builder->decoded) {
+            if(builder->decoded == 0) {
+                builder->distance = values[k];
+            }
+            else if(builder->decoded == 1) {
+                builder->capacity = values[k] > STD_STATION_CAPACITY ? values[k] : STD_STATION_CAPACITY;
+                builder->cars = (matrix_size *) malloc(sizeof(matrix_size) * builder->capacity);
+                builder->result = builder->cars != NULL;
+            }
+            else {
+                builder->result = builder->result && append_car(builder, values[k]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Add the station built to the highway and write the reply.
+ *
+ * @returns 1 if the parameters are valid (the reply is written), 0 otherwise (the station is deleted and nothing is 
+ *          written).
+*/
+uint finish_station(executor * executor, station_builder * builder) {
+    if(builder->decoded == 0 || builder->out_of_range > 0) {
+        free(builder->cars);
+        return 0;
+    }
+
+    builder->station = create_pooled_station(executor->highway, builder->distance, 0);
+    builder->result = builder->result && builder->station != NULL;
+
+    uint result = builder->result && add_cars(builder->station, builder->cars, builder->n_cars);
+    free(builder->cars);
+
+    if(result == 1) {
+        result = add_station(executor->highway, builder->station);
+    }
+
+    if(result == 0) {
+        delete_station(builder->station);
+    }
+    else if(executor->journal != NULL) {
+        journal_append_station(executor->journal, builder->station);
+    }
+
+    write_reply(executor, add_station_command, result);
+
+    return 1;
+}
+
+/**
+ * @brief Execute an aggiungi-stazione command whose name has already been consumed, reading its parameters a view of 
+ * tokens at a time (see next_tokens), so the length of the command is not limited by the buffer of the reader.
+ *
+ * @returns The result of the last request to the reader; the reply is written only if it is line_read.
+*/
+read_result execute_add_station_stream(executor * executor, reader * input) {
+    station_builder builder = {0, 0, NULL, 1, 0, NULL, 0, 0};
+    uint last = 0;
+    line tokens;
+
+    while(!last) {
+        read_result read = next_tokens(input, ' ', &tokens, &last);
+        if(read != line_read) {
+            free(builder.cars);
+            return read;
+        }
+
+        build_station(&builder, tokens.text, tokens.length);
+    }
+
+    if(!finish_station(executor, &builder)) {
+        write_syntax_error(executor);
+    }
+
+    return line_read;
+}
+
+/**
+ * @brief Decode the parameters of a text command whose name has already been consumed, reading them a view of tokens 
+ * at a time into an arena, so the length of the command is not limited by the buffer of the reader.
+ *
+ * The progress is kept in streamed, so if the reader has no more data for now (read_error with errno EAGAIN) the 
+ * command is resumed by the next call, with the same arena.
+ *
+ * @returns The result of the last request to the reader; instruction is set only if it is line_read (to 
+ *          INVALID_INSTRUCTION if a parameter is out of range or there is not enough memory).
+*/
+read_result next_streamed_instruction(reader * input, parse_arena * arena, streamed_command * streamed, 
+                    instruction * instruction) {
+    uint last = 0;
+    line tokens;
+
+    while(!last) {
+        read_result read = next_tokens(input, ' ', &tokens, &last);
+        if(read != line_read) {
+            if(read != read_error || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                streamed->command = no_command;
+            }
+
+            return read;
+        }
+
+        for(uint position = 0; streamed->memory && position <= tokens.length; ) {
+            uint n = streamed->length;
+            if(n == arena->capacity && arena_parameters(arena, n + 1) == NULL) {
+                streamed->memory = 0;
+                break;
+            }
+
+            uint consumed = 0;
+            streamed->length += decode_number_list(tokens.text + position, tokens.length - position, ' ', 
+                    arena->params + n, arena->capacity - n, &consumed, &streamed->out_of_range);
+            position += consumed;
+        }
+    }
+
+    if(streamed->memory && streamed->out_of_range == 0) {
+        instruction->command = streamed->command;
+        instruction->params = arena->params;
+        instruction->params_length = streamed->length;
+    }
+    else {
+        *instruction = INVALID_INSTRUCTION;
+    }
+    streamed->command = no_command;
+
+    return line_read;
+}
+
+/**
+ * @brief Decode a binary record which does not fit in the buffer of the reader, reading its varint parameters a view 
+ * of the buffer at a time into an arena.
+ *
+ * @pre The reader is at the start of the record, whose length prefix is avaible.
+ *
+ * @returns The result of the last request to the reader; instruction is set only if it is line_read (to 
+ *          INVALID_INSTRUCTION if the record is malformed or there is not enough memory).
+*/
+read_result next_streamed_record(reader * input, parse_arena * arena, instruction * instruction) {
+    size_t avaible = input->end - input->begin;
+    uint length = 0;
+    input->begin += decode_varint((unsigned char *) input->buffer + input->begin, 
+                        avaible < VARINT_MAX_LENGTH ? avaible : VARINT_MAX_LENGTH, &length);
+
+    read_result read = ensure_avaible(input, 1);
+    if(read != line_read) {
+        return read;
+    }
+
+    command_type command = (unsigned char) input->buffer[input->begin++];
+    input->scanned = input->begin;
+    uint n = 0, valid = command < no_command;
+    --length;
+
+    while(length > 0) {
+        read = ensure_avaible(input, length < VARINT_MAX_LENGTH ? length : VARINT_MAX_LENGTH);
+        if(read != line_read) {
+            return read;
+        }
+
+        avaible = input->end - input->begin;
+        if(avaible > length) {
+            avaible = length;
+        }
+
+        // Every varint complete in the view is decoded, a truncated one is decoded from the next view
+        const unsigned char * data = (unsigned char *) input->buffer + input->begin;
+        uint position = 0;
+        while(valid && position < avaible) {
+            uint rest = avaible - position, value = 0;
+            uint used = decode_varint(data + position, rest < VARINT_MAX_LENGTH ? rest : VARINT_MAX_LENGTH, &value);
+
+            if(used == 0 && rest < VARINT_MAX_LENGTH && rest < length - position) {
+                break;
+            }
+            if(used == 0 || (n == arena->capacity && arena_parameters(arena, n + 1) == NULL)) {
+                valid = 0;
+                break;
+            }
+
+            arena->params[n++] = value;
+            position += used;
+        }
+
+        // The rest of a malformed record is skipped
+        if(!valid) {
+            position = avaible;
+        }
+
+        input->begin += position;
+        input->scanned = input->begin;
+        length -= position;
+    }
+
+    if(valid) {
+        instruction->command = command;
+        instruction->params = arena->params;
+        instruction->params_length = n;
+    }
+    else {
+        *instruction = INVALID_INSTRUCTION;
+    }
+
+    return line_read;
+}
+
+/**
+ * @brief Execute an importa-stazioni command whose name has already been consumed (see next_streamed_instruction).
+ *
+ * @returns The result of the last request to the reader; the replies are written only if it is line_read.
+*/
+read_result execute_load_stations_stream(executor * executor, reader * input, parse_arena * arena) {
+    instruction instruction;
+    streamed_command streamed = {load_stations_command, 0, 0, 1};
+
+    read_result read = next_streamed_instruction(input, arena, &streamed, &instruction);
+    if(read == line_read) {
+        execute_command(executor, &instruction);
+    }
+
+    return read;
+}
+
+/**
+ * @brief Decode the parameters after the name of a text command, which must be exactly expected and in range.
+ *
+ * @pre values has room for expected + 1 parameters.
+ *
+ * @returns 1 if the parameters are valid, 0 otherwise.
+*/
+uint decode_exactly(const line * command, uint name_length, uint * values, uint expected) {
+    if(name_length == command->length) {
+        return expected == 0;
+    }
+
+    uint consumed = 0, out_of_range = 0;
+    uint n = decode_number_list(command->text + name_length + 1, command->length - name_length - 1, ' ', values, 
+                expected + 1, &consumed, &out_of_range);
+
+    return n == expected && out_of_range == 0 && consumed == command->length - name_length;
+}
+
+/**
+ * Handler of the fused executor: executes a text command from its line and writes the reply, returning 1 if the 
+ * parameters are valid, 0 otherwise (nothing is written).
+*/
+typedef uint (* fused_handler)(executor * executor, const line * command, uint name_length);
+
+uint fused_add_station(executor * executor, const line * command, uint name_length) {
+    if(name_length == command->length) {
+        return 0;
+    }
+
+    station_builder builder = {0, 0, NULL, 1, 0, NULL, 0, 0};
+    build_station(&builder, command->text + name_length + 1, command->length - name_length - 1);
+
+    return finish_station(executor, &builder);
+}
+
+uint fused_delete_station(executor * executor, const line * command, uint name_length) {
+    uint params[2];
+    if(!decode_exactly(command, name_length, params, 1)) {
+        return 0;
+    }
+
+    write_reply(executor, delete_station_command, journal_command(executor, delete_station_command, params, 1, 
+        remove_station(executor->highway, params[0])));
+
+    return 1;
+}
+
+uint fused_add_car(executor * executor, const line * command, uint name_length) {
+    uint params[3];
+    if(!decode_exactly(command, name_length, params, 2)) {
+        return 0;
+    }
+
+    write_reply(executor, add_car_command, journal_command(executor, add_car_command, params, 2, 
+        add_car_by_distance(executor->highway, params[0], params[1])));
+
+    return 1;
+}
+
+uint fused_remove_car(executor * executor, const line * command, uint name_length) {
+    uint params[3];
+    if(!decode_exactly(command, name_length, params, 2)) {
+        return 0;
+    }
+
+    write_reply(executor, remove_car_command, journal_command(executor, remove_car_command, params, 2, 
+        remove_car_by_distance(executor->highway, params[0], params[1])));
+
+    return 1;
+}
+
+uint fused_plan_path(executor * executor, const line * command, uint name_length) {
+    uint params[3];
+    if(!decode_exactly(command, name_length, params, 2)) {
+        return 0;
+    }
+
+    plan_and_reply(executor, params[0], params[1]);
+
+    return 1;
+}
+
+uint fused_save_state(executor * executor, const line * command, uint name_length) {
+    uint params[1];
+    if(!decode_exactly(command, name_length, params, 0)) {
+        return 0;
+    }
+
+    write_reply(executor, save_state_command, execute_save_state(executor));
+
+    return 1;
+}
+
+uint fused_load_stations(executor * executor, const line * command, uint name_length) {
+    if(name_length == command->length) {
+        return 0;
+    }
+
+    // Every parameter takes at least a digit and a separator; the stations are added together, so they are decoded first
+    uint length = command->length - name_length - 1, capacity = length / 2 + 1;
+    uint * params = (uint *) malloc(sizeof(uint) * capacity);
+    if(params == NULL) {
+        return 0;
+    }
+
+    uint consumed = 0, out_of_range = 0;
+    uint n = decode_number_list(command->text + name_length + 1, length, ' ', params, capacity, &consumed, 
+                &out_of_range);
+
+    instruction instruction = {load_stations_command, params, n};
+    uint result = out_of_range == 0 && consumed == length + 1 && validate_instruction(&instruction);
+    if(result) {
+        execute_load_stations(executor, &instruction);
+    }
+
+    free(params);
+
+    return result;
+}
+
+/**
+ * Handlers of the fused executor, indexed by command.
+*/
+const fused_handler FUSED_HANDLERS[] = {
+    fused_add_station,
+    fused_delete_station,
+    fused_add_car,
+    fused_remove_car,
+    fused_plan_path,
+    fused_save_state,
+    fused_load_stations
+};
+
+/**
+ * @brief Read a text command and execute it with the fused executor.
+ *
+ * @returns The result of the request to the reader; the reply is written only if it is line_read.
+*/
+read_result execute_line(executor * executor, reader * input) {
+    line command;
+
+    read_result read = next_line(input, &command);
+    if(read != line_read) {
+        return read;
+    }
+
+    const char * separator = (const char *) memchr(command.text, ' ', command.length);
+    uint name_length = separator != NULL ? separator - command.text : command.length;
+
+    command_type code = recognize_command(command.text, name_length);
+    if(code == no_command || !FUSED_HANDLERS[code](executor, &command, name_length)) {
+        write_syntax_error(executor);
+    }
+
+    return line_read;
+}
+
+stream_format detect_format(reader * input) {
+    if(consume_prefix(input, BINARY_MAGIC, BINARY_MAGIC_LENGTH)) {
+        return binary_format;
+    }
+
+    return text_format;
+}
+
+read_result next_instruction(reader * input, stream_format commands, instruction ** instruction) {
+    line command;
+    read_result read = line_read;
+
+    if(commands == binary_format) {
+        read = next_record(input, &command);
+        if(read == line_read) {
+            *instruction = decode_instruction((const unsigned char *) command.text, command.length);
+        }
+    }
+    else {
+        read = next_line(input, &command);
+        if(read == line_read) {
+            *instruction = parse_line(command.text, command.length);
+        }
+    }
+
+    return read;
+}
+
+/**
+ * @brief Start streaming a text command if the input starts with the name of a command whose parameters are streamed.
+ *
+ * @returns 1 if the name is consumed and streamed is set, 0 otherwise (nothing is consumed).
+*/
+uint start_streamed_command(reader * input, streamed_command * streamed) {
+    if(consume_prefix(input, ADD_STATION_PREFIX, ADD_STATION_PREFIX_LENGTH)) {
+        streamed->command = add_station_command;
+    }
+    else if(consume_prefix(input, LOAD_STATIONS_PREFIX, LOAD_STATIONS_PREFIX_LENGTH)) {
+        streamed->command = load_stations_command;
+    }
+    else {
+        return 0;
+    }
+
+    streamed->length = 0;
+    streamed->out_of_range = 0;
+    streamed->memory = 1;
+
+    return 1;
+}
+
+read_result next_text_instruction(reader * input, parse_arena * arena, streamed_command * streamed, 
+                    instruction * instruction) {
+    if(streamed->command != no_command || start_streamed_command(input, streamed)) {
+        return next_streamed_instruction(input, arena, streamed, instruction);
+    }
+
+    line command;
+    read_result read = next_line(input, &command);
+    if(read == line_read) {
+        parse_line_into(command.text, command.length, arena, instruction);
+    }
+
+    return read;
+}
+
+read_result next_instruction_into(reader * input, stream_format commands, parse_arena * arena, 
+                    instruction * instruction) {
+    if(commands == text_format) {
+        streamed_command streamed = {no_command, 0, 0, 1};
+        return next_text_instruction(input, arena, &streamed, instruction);
+    }
+
+    line command;
+    read_result read = next_record(input, &command);
+    if(read == line_read) {
+        decode_instruction_into((const unsigned char *) command.text, command.length, arena, instruction);
+    }
+    else if(read == line_too_long) {
+        read = next_streamed_record(input, arena, instruction);
+    }
+
+    return read;
+}
+
+read_result execute_stream(executor * executor, reader * input, stream_format commands, uint * line_number) {
+    parse_arena * arena = create_parse_arena(STD_ARENA_CAPACITY);
+    if(arena == NULL) {
+        return read_error;
+    }
+
+    instruction instruction;
+    read_result read = line_read;
+
+    while(read == line_read) {
+        if(commands == text_format && !executor->instructions) {
+            if(consume_prefix(input, ADD_STATION_PREFIX, ADD_STATION_PREFIX_LENGTH)) {
+                read = execute_add_station_stream(executor, input);
+            }
+            else if(consume_prefix(input, LOAD_STATIONS_PREFIX, LOAD_STATIONS_PREFIX_LENGTH)) {
+                read = execute_load_stations_stream(executor, input, arena);
+            }
+            else {
+                read = execute_line(executor, input);
+            }
+        }
+        else if((read = next_instruction_into(input, commands, arena, &instruction)) == line_read) {
+            execute_command(executor, &instruction);
+        }
+
+        if(read == line_read) {
+            ++(*line_number);
+        }
+    }
+
+    delete_parse_arena(arena);
+
+    return read;
+}
@@ -0,0 +1,181 @@
+#ifndef _EXECUTOR_
+#define _EXECUTOR_
+
+/**
+ * @headerfile executor.h
+ * @brief Interface of executor.c
+*/
+
+#include "journal.h"
+#include "parser.h"
+#include "reader.h"
+#include "snapshot.h"
+#include "station_handler.h"
+#include "writer.h"
+
+/**
+ * @enum stream_format
+ * @brief Codifies the encoding of commands and replies.
+*/
+typedef enum {
+    text_format = 0,
+    binary_format = 1
+} stream_format;
+
+/**
+ * @struct executor
+ * @brief Stores the state needed to execute commands.
+ * 
+ * @param highway Pointer to the highway on which commands are executed.
+ * @param output Pointer to the writer which receives the replies.
+ * @param replies Encoding of the replies.
+ * @param snapshot_path Path where salva-stato writes the snapshot of the highway (NULL if snapshots are disabled).
+ * @param journal Pointer to the journal of the accepted mutations (NULL if mutations are not journaled).
+ * @param instructions 1 to decode every text command into an instruction before executing it, 0 to execute text 
+ *                     commands with the fused executor (see execute_stream).
+*/
+typedef struct executor {
+    highway * highway;
+    writer * output;
+    stream_format replies;
+    const char * snapshot_path;
+    journal * journal;
+    uint instructions;
+} executor;
+
+/**
+ * @struct streamed_command
+ * @brief Progress of a text command whose parameters are decoded a view of tokens at a time.
+ * 
+ * @param command Command being decoded, no_command if no command is being decoded.
+ * @param length Number of parameters already decoded in the arena.
+ * @param out_of_range Number of parameters out of range.
+ * @param memory 0 if the arena could not grow, 1 otherwise.
+*/
+typedef struct streamed_command {
+    command_type command;
+    uint length;
+    uint out_of_range;
+    uint memory;
+} streamed_command;
+
+/**
+ * Instruction executed in place of a command which cannot be parsed (a syntax error is replied).
+*/
+extern const instruction INVALID_INSTRUCTION;
+
+/**
+ * Text replies of the commands when they succeed and when they fail, indexed by command_type (the reply of a found 
+ * path is the path itself, so its positive reply is empty).
+*/
+extern const char * POSITIVE_REPLIES[];
+extern const char * NEGATIVE_REPLIES[];
+
+/**
+ * @brief Execute an instruction and write its reply.
+ * 
+ * @param executor Pointer to the executor to use.
+ * @param instruction Pointer to the instruction to execute.
+ * 
+ * @pre executor != NULL
+ * @pre instruction != NULL
+ * 
+ * @note If the instruction is not valid, a syntax error is replied.
+*/
+void execute_command(executor * executor, const instruction * instruction);
+
+/**
+ * @brief Detect the encoding of a command stream.
+ * 
+ * @param input Pointer to the reader of the commands, before any command is requested.
+ * 
+ * @pre input != NULL
+ * 
+ * @returns binary_format if the stream starts with BINARY_MAGIC (which is consumed), text_format otherwise.
+*/
+stream_format detect_format(reader * input);
+
+/**
+ * @brief Read and decode the next command.
+ * 
+ * @param input Pointer to the reader of the commands.
+ * @param commands Encoding of the commands.
+ * @param instruction Address where the instruction allocated on heap will be put (NULL if there is not enough memory).
+ * 
+ * @pre input != NULL
+ * @pre instruction != NULL
+ * 
+ * @returns The result of the request to the reader; instruction is set only if it is line_read.
+*/
+read_result next_instruction(reader * input, stream_format commands, instruction ** instruction);
+
+/**
+ * @brief Read and decode the next command into a caller owned instruction.
+ * 
+ * @param input Pointer to the reader of the commands.
+ * @param commands Encoding of the commands.
+ * @param arena Pointer to the arena which stores the parameters (see parse_line_into).
+ * @param instruction Pointer to the instruction to fill (with command no_command if there is not enough memory).
+ * 
+ * @pre input != NULL
+ * @pre arena != NULL
+ * @pre instruction != NULL
+ * 
+ * @returns The result of the request to the reader; instruction is set only if it is line_read.
+ *
+ * @note In text format the parameters of aggiungi-stazione and importa-stazioni are decoded token by token, and in 
+ *       binary format a record longer than the buffer of the reader is decoded a view at a time, so the length of 
+ *       these commands is not limited by the buffer of the reader.
+*/
+read_result next_instruction_into(reader * input, stream_format commands, parse_arena * arena, 
+                    instruction * instruction);
+
+/**
+ * @brief Read and decode the next text command, keeping the progress of a streamed command between calls.
+ * 
+ * As next_instruction_into in text format, but if the reader has no more data in the middle of an aggiungi-stazione 
+ * or importa-stazioni command (read_error with errno EAGAIN, on a non blocking reader), the parameters decoded so far 
+ * stay in arena and streamed, and the next call resumes the command.
+ * 
+ * @param input Pointer to the reader of the commands.
+ * @param arena Pointer to the arena which stores the parameters (the same one until the command is decoded).
+ * @param streamed Pointer to the progress of the command (command no_command before the first call).
+ * @param instruction Pointer to the instruction to fill (with command no_command if there is not enough memory).
+ * 
+ * @pre input != NULL
+ * @pre arena != NULL
+ * @pre streamed != NULL
+ * @pre instruction != NULL
+ * 
+ * @returns The result of the request to the reader; instruction is set only if it is line_read.
+*/
+read_result next_text_instruction(reader * input, parse_arena * arena, streamed_command * streamed, 
+                    instruction * instruction);
+
+/**
+ * @brief Decode and execute every command of an input.
+ * 
+ * @param executor Pointer to the executor to use.
+ * @param input Pointer to the reader of the commands.
+ * @param commands Encoding of the commands.
+ * @param line_number Address of the counter of the commands executed.
+ * 
+ * @pre executor != NULL
+ * @pre input != NULL
+ * @pre line_number != NULL
+ * 
+ * @returns The result of the last request to the reader (end_of_input if every command is executed), read_error if 
+ *          there is not enough memory to start.
+ * 
+ * @note Unless executor->instructions is set, text commands are executed by the fused executor: the command of every 
+ *       line is dispatched to its handler as soon as its name is recognized, and the handler decodes the parameters 
+ *       and calls the station_handler operation directly, so no instruction is built. Binary commands are decoded 
+ *       with a single parse arena, which requests heap memory only for a command with more parameters than any 
+ *       before it.
+ * @note In text format aggiungi-stazione and importa-stazioni commands are decoded token by token, also when 
+ *       executor->instructions is set (see next_instruction_into), so their length is not limited by the buffer of 
+ *       the reader.
+*/
+read_result execute_stream(executor * executor, reader * input, stream_format commands, uint * line_number);
+
+#endif
@@ -0,0 +1,368 @@
+/**
+ * @file journal.c
+ * @brief Record the mutations of an highway in an append only file.
+*/
+
+#include "journal.h"
+#include "binary.h"
+#include "executor.h"
+#include "snapshot.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define NDEBUG
+
+#define JOURNAL_BUFFER_CAPACITY (1 << 16)
+
+/**
+ * @brief Write a journal header at the start of fd.
+ *
+ * @returns 1 if the header is written, 0 otherwise.
+*/
+uint write_journal_header(int fd, uint32_t generation) {
+    char header[JOURNAL_HEADER_LENGTH];
+    memcpy(header, JOURNAL_MAGIC, JOURNAL_MAGIC_LENGTH);
+    memcpy(header + JOURNAL_MAGIC_LENGTH, &generation, sizeof(generation));
+
+    return pwrite(fd, header, JOURNAL_HEADER_LENGTH, 0) == JOURNAL_HEADER_LENGTH;
+}
+
+/**
+ * @brief Open the journal file, creating it if it does not exist, and read its generation.
+ *
+ * @returns The file descriptor, -1 if the file cannot be opened or it is not a journal.
+*/
+int open_journal_file(const char * path, uint32_t * generation) {
+    int fd = open(path, O_RDWR | O_APPEND | O_CREAT, 0644);
+    if(fd < 0) {
+        return -1;
+    }
+
+    char header[JOURNAL_HEADER_LENGTH];
+    ssize_t n = pread(fd, header, JOURNAL_HEADER_LENGTH, 0);
+
+    if(n == 0) {
+        *generation = 0;
+        if(write_journal_header(fd, 0) && fsync(fd) == 0) {
+            return fd;
+        }
+    }
+    else if(n == JOURNAL_HEADER_LENGTH && memcmp(header, JOURNAL_MAGIC, JOURNAL_MAGIC_LENGTH) == 0) {
+        memcpy(generation, header + JOURNAL_MAGIC_LENGTH, sizeof(*generation));
+        return fd;
+    }
+
+    #ifndef NDEBUG
+    printf("\t%s is not a journal\n", path);
+    #endif
+
+    close(fd);
+    return -1;
+}
+
+journal * create_journal(const char * path, uint records_per_sync, uint sync_interval) {
+    #ifndef NDEBUG
+    printf("Starting journal creation\n");
+    #endif
+
+    journal * new_journal = (journal *) malloc(sizeof(journal));
+    if(new_journal == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough space to allocate journal of %ld bytes\n", sizeof(journal));
+        #endif
+
+        return NULL;
+    }
+
+    new_journal->path = strdup(path);
+    new_journal->fd = open_journal_file(path, &new_journal->generation);
+    new_journal->output = NULL;
+    new_journal->record = NULL;
+
+    if(new_journal->path == NULL || new_journal->fd < 0 ||
+        (new_journal->output = create_writer(new_journal->fd, JOURNAL_BUFFER_CAPACITY)) == NULL) {
+        #ifndef NDEBUG
+        printf("\tUnable to open journal %s\n", path);
+        #endif
+
+        if(new_journal->fd >= 0) {
+            close(new_journal->fd);
+        }
+        free(new_journal->path);
+        free(new_journal);
+
+        return NULL;
+    }
+
+    new_journal->records_per_sync = records_per_sync;
+    new_journal->sync_interval = sync_interval;
+    new_journal->pending = 0;
+    new_journal->records = 0;
+    new_journal->record_capacity = 0;
+    clock_gettime(CLOCK_MONOTONIC, &new_journal->last_sync);
+
+    #ifndef NDEBUG
+    printf("Ending journal creation (generation %d)\n", new_journal->generation);
+    #endif
+
+    return new_journal;
+}
+
+void delete_journal(journal * journal) {
+    if(journal != NULL) {
+        journal_sync(journal);
+
+        delete_writer(journal->output);
+        close(journal->fd);
+        free(journal->record);
+        free(journal->path);
+        free(journal);
+    }
+}
+
+/**
+ * @brief Milliseconds elapsed from the last synchronization.
+*/
+long elapsed_from_sync(const journal * journal) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - journal->last_sync.tv_sec) * 1000 + (now.tv_nsec - journal->last_sync.tv_nsec) / 1000000;
+}
+
+uint journal_sync(journal * journal) {
+    uint result = flush_writer(journal->output) && !journal->output->error;
+
+    if(journal->pending > 0) {
+        result = result && fdatasync(journal->fd) == 0;
+
+        #ifndef NDEBUG
+        printf("\tSynchronized %d records\n", journal->pending);
+        #endif
+    }
+
+    journal->pending = 0;
+    clock_gettime(CLOCK_MONOTONIC, &journal->last_sync);
+
+    return result;
+}
+
+int journal_tick(journal * journal) {
+    if(journal->pending == 0 || journal->sync_interval == 0) {
+        return -1;
+    }
+
+    long elapsed = elapsed_from_sync(journal);
+    if(elapsed < journal->sync_interval) {
+        return journal->sync_interval - elapsed;
+    }
+
+    journal_sync(journal);
+    return -1;
+}
+
+/**
+ * @brief Make the record buffer at least length bytes long.
+ *
+ * @returns 1 if the buffer is long enough, 0 if there is not enough memory.
+*/
+uint reserve_record(journal * journal, uint length) {
+    if(length <= journal->record_capacity) {
+        return 1;
+    }
+
+    unsigned char * record = (unsigned char *) malloc(length * 2);
+    if(record == NULL) {
+        return 0;
+    }
+
+    free(journal->record);
+    journal->record = record;
+    journal->record_capacity = length * 2;
+
+    return 1;
+}
+
+/**
+ * @brief Account a record written in the buffer and apply the synchronization triggers.
+*/
+uint commit_record(journal * journal) {
+    ++journal->pending;
+    ++journal->records;
+
+    if((journal->records_per_sync > 0 && journal->pending >= journal->records_per_sync) ||
+        (journal->sync_interval > 0 && elapsed_from_sync(journal) >= journal->sync_interval)) {
+        return journal_sync(journal);
+    }
+
+    return !journal->output->error;
+}
+
+uint journal_append(journal * journal, const instruction * instruction) {
+    return journal_append_command(journal, instruction->command, instruction->params, instruction->params_length);
+}
+
+uint journal_append_command(journal * journal, command_type command, const uint * params, uint length) {
+    if(!reserve_record(journal, VARINT_MAX_LENGTH * (length + 1) + 1)) {
+        return 0;
+    }
+
+    write_text(journal->output, (char *) journal->record, encode_command(command, params, length, journal->record));
+
+    return commit_record(journal);
+}
+
+uint journal_append_station(journal * journal, const station * station) {
+    if(!reserve_record(journal, VARINT_MAX_LENGTH * (station->length + 3) + 1)) {
+        return 0;
+    }
+
+    // The payload is encoded after the space of the longest prefix, which is then put right before it
+    unsigned char * payload = journal->record + VARINT_MAX_LENGTH;
+    uint length = 0;
+
+    payload[length++] = add_station_command;
+    length += encode_varint(station->distance, payload + length);
+    length += encode_varint(station->length, payload + length);
+    for(matrix_size i = 0; i < station->n_runs; ++i) {
+        for(matrix_size k = 0; k < station->runs[i].count; ++k) {
+            length += encode_varint(station->runs[i].fuel, payload + length);
+        }
+    }
+
+    unsigned char prefix[VARINT_MAX_LENGTH];
+    uint prefix_length = encode_varint(length, prefix);
+    memcpy(payload - prefix_length, prefix, prefix_length);
+
+    write_text(journal->output, (char *) payload - prefix_length, prefix_length + length);
+
+    return commit_record(journal);
+}
+
+/**
+ * @brief Replace the journal file with an empty journal of a generation.
+ *
+ * @returns 1 if the journal is replaced, 0 otherwise.
+*/
+uint reset_journal(journal * journal, uint32_t generation) {
+    if(!journal_sync(journal)) {
+        return 0;
+    }
+
+    char * temporary_path = (char *) malloc(strlen(journal->path) + 5);
+    if(temporary_path == NULL) {
+        return 0;
+    }
+    sprintf(temporary_path, "%s.tmp", journal->path);
+
+    int fd = open(temporary_path, O_RDWR | O_APPEND | O_CREAT | O_TRUNC, 0644);
+    uint result = fd >= 0 && write_journal_header(fd, generation) && fsync(fd) == 0 &&
+                    rename(temporary_path, journal->path) == 0;
+
+    free(temporary_path);
+
+    if(!result) {
+        if(fd >= 0) {
+            close(fd);
+        }
+        return 0;
+    }
+
+    close(journal->fd);
+    journal->fd = fd;
+    journal->output->fd = fd;
+    journal->generation = generation;
+
+    #ifndef NDEBUG
+    printf("\tJournal reset at generation %d\n", generation);
+    #endif
+
+    return 1;
+}
+
+int replay_journal(journal * journal, highway * highway, uint32_t snapshot_generation) {
+    #ifndef NDEBUG
+    printf("Starting replay of %s (generation %d, snapshot generation %d)\n", journal->path, journal->generation,
+        snapshot_generation);
+    #endif
+
+    if(journal->generation < snapshot_generation) {
+        return reset_journal(journal, snapshot_generation) ? 0 : -1;
+    }
+
+    // The records of the generations before the journal are only in a newer snapshot, which is not the one restored
+    if(journal->generation > snapshot_generation) {
+        #ifndef NDEBUG
+        printf("\tJournal newer than the snapshot\n");
+        #endif
+
+        return -1;
+    }
+
+    reader * input = create_mapped_reader(journal->fd);
+    int null_output = open("/dev/null", O_WRONLY);
+    writer * replies = null_output < 0 ? NULL : create_writer(null_output, JOURNAL_BUFFER_CAPACITY);
+
+    if(input == NULL || replies == NULL) {
+        delete_reader(input);
+        delete_writer(replies);
+        if(null_output >= 0) {
+            close(null_output);
+        }
+
+        return -1;
+    }
+
+    executor executor = {.highway = highway, .output = replies, .replies = binary_format, .snapshot_path = NULL, 
+                         .journal = NULL, .instructions = 0};
+    uint records = 0;
+
+    input->begin = JOURNAL_HEADER_LENGTH;
+    input->scanned = JOURNAL_HEADER_LENGTH;
+
+    read_result read = execute_stream(&executor, input, binary_format, &records);
+
+    size_t valid_length = input->begin;
+    size_t length = input->end;
+
+    delete_reader(input);
+    delete_writer(replies);
+    close(null_output);
+
+    if(read != end_of_input) {
+        return -1;
+    }
+
+    if(valid_length < length) {
+        #ifndef NDEBUG
+        printf("\tRemoving truncated record of %ld bytes\n", length - valid_length);
+        #endif
+
+        if(ftruncate(journal->fd, valid_length) != 0 || fsync(journal->fd) != 0) {
+            return -1;
+        }
+    }
+
+    #ifndef NDEBUG
+    printf("Ending replay (%d records)\n", records);
+    #endif
+
+    return records;
+}
+
+uint compact_journal(journal * journal, const highway * highway, const char * snapshot_path) {
+    #ifndef NDEBUG
+    printf("Starting compaction of %s in %s\n", journal->path, snapshot_path);
+    #endif
+
+    if(save_snapshot(highway, snapshot_path, journal->generation + 1) != snapshot_done) {
+        return 0;
+    }
+
+    return reset_journal(journal, journal->generation + 1);
+}
@@ -0,0 +1,184 @@
+#ifndef _JOURNAL_
+#define _JOURNAL_
+
+/**
+ * @headerfile journal.h
+ * @brief Interface of journal.c
+ *
+ * A journal starts with JOURNAL_MAGIC and its 32 bit generation, followed by the binary records (see binary.h) of
+ * the mutations accepted after the snapshot with the same journal generation.
+ *
+ * Compaction writes a snapshot for the next generation and only then replaces the journal with an empty one of that
+ * generation: if the process dies in between, the journal is older than the snapshot and it is not replayed.
+*/
+
+#include "parser.h"
+#include "station_handler.h"
+#include "writer.h"
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Bytes which start a journal.
+*/
+#define JOURNAL_MAGIC "HWJ\0"
+#define JOURNAL_MAGIC_LENGTH 4
+#define JOURNAL_HEADER_LENGTH (JOURNAL_MAGIC_LENGTH + 4)
+
+/**
+ * @struct journal
+ * @brief Append only log of the mutations of an highway.
+ *
+ * @param path Path of the journal.
+ * @param fd File descriptor of the journal, opened in append mode.
+ * @param output Pointer to the writer which buffers the records not written yet.
+ * @param generation Generation of the journal.
+ * @param records_per_sync Number of records after which the journal is synchronized (0 to disable).
+ * @param sync_interval Milliseconds after which pending records are synchronized (0 to disable).
+ * @param pending Number of records appended after the last synchronization.
+ * @param records Number of records appended since the journal has been opened.
+ * @param last_sync Time of the last synchronization.
+ * @param record Buffer used to encode a record.
+ * @param record_capacity Capacity of record.
+*/
+typedef struct journal {
+    char * path;
+    int fd;
+    writer * output;
+    uint32_t generation;
+    uint records_per_sync;
+    uint sync_interval;
+    uint pending;
+    uint records;
+    struct timespec last_sync;
+    unsigned char * record;
+    uint record_capacity;
+} journal;
+
+/**
+ * @brief Open a journal, creating an empty one of generation 0 if path does not exist.
+ *
+ * @param path Path of the journal.
+ * @param records_per_sync Number of records after which the journal is synchronized (0 to disable).
+ * @param sync_interval Milliseconds after which pending records are synchronized (0 to disable).
+ *
+ * @pre path != NULL
+ *
+ * @returns A pointer to the journal allocated on heap, NULL if the file cannot be opened or it is not a journal.
+ *
+ * @note With both the triggers disabled, the journal is synchronized only by journal_sync and delete_journal.
+*/
+journal * create_journal(const char * path, uint records_per_sync, uint sync_interval);
+
+/**
+ * @brief Close a journal.
+ *
+ * @param journal Pointer to the journal to delete.
+ *
+ * @post The pending records are synchronized and the journal is deallocated.
+*/
+void delete_journal(journal * journal);
+
+/**
+ * @brief Append the record of an accepted mutation.
+ *
+ * @param journal Pointer to the journal to use.
+ * @param instruction Pointer to the instruction of the mutation.
+ *
+ * @pre journal != NULL
+ * @pre instruction != NULL
+ *
+ * @returns 1 if the record is appended (and synchronized if a trigger fires), 0 otherwise.
+*/
+uint journal_append(journal * journal, const instruction * instruction);
+
+/**
+ * @brief Append the record of an accepted mutation given by its command and parameters.
+ *
+ * @param journal Pointer to the journal to use.
+ * @param command Code of the command of the mutation.
+ * @param params Pointer to the parameters of the command.
+ * @param length Number of parameters.
+ *
+ * @pre journal != NULL
+ *
+ * @returns 1 if the record is appended (and synchronized if a trigger fires), 0 otherwise.
+*/
+uint journal_append_command(journal * journal, command_type command, const uint * params, uint length);
+
+/**
+ * @brief Append the record of a station added to the highway.
+ *
+ * The record is the aggiungi-stazione command which creates the same station.
+ *
+ * @param journal Pointer to the journal to use.
+ * @param station Pointer to the station added.
+ *
+ * @pre journal != NULL
+ * @pre station != NULL
+ *
+ * @returns 1 if the record is appended (and synchronized if a trigger fires), 0 otherwise.
+*/
+uint journal_append_station(journal * journal, const station * station);
+
+/**
+ * @brief Write the pending records and wait until they are on disk (fdatasync(2)).
+ *
+ * @param journal Pointer to the journal to synchronize.
+ *
+ * @pre journal != NULL
+ *
+ * @returns 1 if the records are synchronized, 0 otherwise.
+*/
+uint journal_sync(journal * journal);
+
+/**
+ * @brief Synchronize the pending records if sync_interval milliseconds are elapsed from the last synchronization.
+ *
+ * @param journal Pointer to the journal to use.
+ *
+ * @pre journal != NULL
+ *
+ * @returns Milliseconds before the next synchronization is due, -1 if no record is pending or the time trigger is
+ *          disabled.
+*/
+int journal_tick(journal * journal);
+
+/**
+ * @brief Replay the records of a journal on an highway.
+ *
+ * Only a journal of the same generation of the snapshot of the highway is replayed; an older journal is replaced by
+ * an empty one of the generation of the snapshot, while a newer one is refused, since it misses the records already
+ * folded in a snapshot which is not the restored one. A truncated record at the end (left by a crash while appending)
+ * is removed.
+ *
+ * @param journal Pointer to the journal to replay.
+ * @param highway Pointer to the highway which receives the mutations.
+ * @param snapshot_generation Journal generation of the snapshot the highway was restored from (0 if none).
+ *
+ * @pre journal != NULL
+ * @pre highway != NULL
+ *
+ * @returns The number of records replayed, -1 if the journal cannot be read or it is newer than the snapshot.
+*/
+int replay_journal(journal * journal, highway * highway, uint32_t snapshot_generation);
+
+/**
+ * @brief Compact a journal into a snapshot.
+ *
+ * The snapshot of the highway is written for the next generation, then the journal is replaced by an empty journal
+ * of that generation.
+ *
+ * @param journal Pointer to the journal to compact.
+ * @param highway Pointer to the highway which contains every record of the journal.
+ * @param snapshot_path Path of the snapshot.
+ *
+ * @pre journal != NULL
+ * @pre highway != NULL
+ * @pre snapshot_path != NULL
+ *
+ * @returns 1 if both snapshot and journal are replaced, 0 otherwise.
+*/
+uint compact_journal(journal * journal, const highway * highway, const char * snapshot_path);
+
+#endif
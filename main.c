@@ -2,198 +2,210 @@
  * @file main.c
  * @brief Receive and execute commands.
  * 
- * This module receives commands from stdin; it uses module parser to parse and station_handler to execute the command; it reports the output on stdout.   
+ * This module receives commands from stdin (or from the file given as argument, optionally mapped in memory); it uses module executor to 
+ * parse and execute the commands; it reports the output on stdout. With -s, the highway stays in memory and serves the commands of 
+ * the clients of a Unix domain socket.
 */
 
+#include "executor.h"
+#include "journal.h"
 #include "parser.h"
+#include "pipeline.h"
+#include "reader.h"
+#include "server.h"
+#include "snapshot.h"
 #include "solver.h"
 #include "station_handler.h"
+#include "writer.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #define STD_HIGHWAY_CAPACITY 256
-#define STD_STATION_CAPACITY 32
 
-#define BUFFER_CAPACITY 8096
-
-void execute_add_station(highway ** highway, const instruction * instruction, FILE * output) {
-    station * station = NULL;
-    if(instruction->params[1] > STD_STATION_CAPACITY) {
-        station = create_station(instruction->params[0], instruction->params[1]);
-    }
-    else {
-        station = create_station(instruction->params[0], STD_STATION_CAPACITY);
-    }
-    
-    if(station != NULL) {
-        uint result = 1, i = 2;
-        while(result && i < instruction->params_length) {
-            result = result && add_car(station, instruction->params[i++]);
-        }
-
-        if(result == 1) {
-            result = add_station(highway, station);
-            if(result == 1) {
-                fprintf(output, "aggiunta\n");
-            }
-            else {
-                delete_station(station);
-                fprintf(output, "non aggiunta\n");
-            }        
-        }
-        else {
-            delete_station(station);
-            fprintf(output, "non aggiunta\n");
-        }
-    }
-    else {
-        fprintf(output, "non aggiunta\n");
-    }
-}
-
-void execute_delete_station(highway * highway, const instruction * instruction, FILE * output) {
-    if(remove_station(highway, instruction->params[0])) {
-        fprintf(output, "demolita\n");
-    }
-    else {
-        fprintf(output, "non demolita\n");
-    }
-}
-
-void execute_add_car(highway * highway, const instruction * instruction, FILE * output) {
-    if(add_car_by_distance(highway, instruction->params[0], instruction->params[1])) {
-        fprintf(output, "aggiunta\n");
-    }
-    else {
-        fprintf(output, "non aggiunta\n");
-    }
+#define BUFFER_CAPACITY (1 << 16)
+#define OUTPUT_CAPACITY (1 << 16)
+
+void print_usage(const char * name) {
+    fprintf(stderr, "Usage: %s [-m] [-p] [-i] [-b] [-s socket_path] [-S snapshot_path] [-J journal_path [-g records] [-t milliseconds]] [commands_path]\n", name);
+    fprintf(stderr, "\t-m\tmap the commands in memory if they are read from a regular file\n");
+    fprintf(stderr, "\t-p\tparse and execute the commands on two pipelined threads\n");
+    fprintf(stderr, "\t-i\tdecode every text command into an instruction before executing it\n");
+    fprintf(stderr, "\t-b\twrite the replies in binary format\n");
+    fprintf(stderr, "\t-s\tafter the commands of commands_path (if given), serve text commands on the socket socket_path\n");
+    fprintf(stderr, "\t-S\trestore the highway from snapshot_path (if it exists) and save it there on salva-stato\n");
+    fprintf(stderr, "\t-J\treplay journal_path on the restored highway and append there the accepted mutations\n");
+    fprintf(stderr, "\t-g\tsynchronize the journal every records mutations (default 1, 0 to disable)\n");
+    fprintf(stderr, "\t-t\tsynchronize the journal at most milliseconds after a mutation (default 0, disabled)\n");
+    fprintf(stderr, "Commands can be in text or binary format (detected automatically)\n");
+    fprintf(stderr, "Commands are read from stdin if commands_path is not given\n");
 }
 
-void execute_remove_car(highway * highway, const instruction * instruction, FILE * output) {
-    if(remove_car_by_distance(highway, instruction->params[0], instruction->params[1])) {
-        fprintf(output, "rottamata\n");
-    }
-    else {
-        fprintf(output, "non rottamata\n");
-    };
-}
+int main(int argc, char * argv[]) {
 
-void execute_plan_path(highway * highway, const instruction * instruction, FILE * output) {
-    matrix_size * solution = NULL;
-    direction dir = forward;
-    if(instruction->params[0] > instruction->params[1]) {
-        dir = backward;
-    }
+    uint map_input = 0, pipelined = 0, instructions = 0;
+    stream_format replies = text_format;
+    const char * socket_path = NULL, * snapshot_path = NULL, * journal_path = NULL;
+    uint records_per_sync = 1, sync_interval = 0;
+    int option = 0;
 
-    int stops = plan_path(highway, instruction->params[0], 
-                    instruction->params[1], dir, &solution);
+    while((option = getopt(argc, argv, "mpibs:S:J:g:t:")) != -1) {
+        switch(option) {
+            case 'm': map_input = 1;
+            break;
 
-    if(stops >= 0) {
-        for(int i = 0; i < stops + 1; ++i) {
-            fprintf(output, "%d ", solution[i]);
-        }
-        fprintf(output, "%d", solution[stops + 1]);
-        fprintf(output, "\n");
-    }
-    else {
-        fprintf(output, "nessun percorso\n");
-    }
+            case 'p': pipelined = 1;
+            break;
 
-    free(solution);
-}
+            case 'i': instructions = 1;
+            break;
 
-void execute_command(highway ** highway, const instruction * instruction, FILE * output) {
-    
-    if(validate_instruction(instruction)) {
-        switch(instruction->command) {
-            
-            case add_station_command: execute_add_station(highway, instruction, output);
+            case 'b': replies = binary_format;
             break;
 
-            case delete_station_command: execute_delete_station(*highway, instruction, output);
+            case 's': socket_path = optarg;
             break;
 
-            case add_car_command: execute_add_car(*highway, instruction, output);
+            case 'S': snapshot_path = optarg;
             break;
-            
-            case remove_car_command: execute_remove_car(*highway, instruction, output);
+
+            case 'J': journal_path = optarg;
             break;
-            
-            case plan_path_command: execute_plan_path(*highway, instruction, output);
+
+            case 'g': records_per_sync = parse_parameter(optarg, strlen(optarg));
             break;
 
-            case no_command:
+            case 't': sync_interval = parse_parameter(optarg, strlen(optarg));
             break;
+
+            default: print_usage(argv[0]);
+            return 1;
         }
     }
-    else {
-        fprintf(output, "Command syntax error\n");
+
+    highway * highway = NULL;
+    snapshot_result restore = snapshot_not_found;
+    uint32_t snapshot_generation = 0;
+
+    if(snapshot_path != NULL) {
+        restore = load_snapshot(snapshot_path, &highway, &snapshot_generation);
     }
-}
+    if(restore == snapshot_not_found) {
+        highway = create_highway(STD_HIGHWAY_CAPACITY);
+    }
+    else if(restore != snapshot_done) {
+        fprintf(stderr, "Unable to restore snapshot %s (%d)\n", snapshot_path, restore);
+
+        return 1;
+    }
+
+    journal * journal = NULL;
+
+    if(journal_path != NULL) {
+        journal = create_journal(journal_path, records_per_sync, sync_interval);
+        if(journal != NULL && journal->generation > snapshot_generation) {
+            fprintf(stderr, "Journal %s (generation %d) is newer than the snapshot (generation %d)\n", journal_path,
+                journal->generation, snapshot_generation);
+
+            return 1;
+        }
+        if(journal == NULL || replay_journal(journal, highway, snapshot_generation) < 0) {
+            fprintf(stderr, "Unable to replay journal %s\n", journal_path);
+
+            return 1;
+        }
+    }
+
+    int input = STDIN_FILENO;
 
-int main() {
+    if(socket_path != NULL && optind == argc) {
+        input = open("/dev/null", O_RDONLY);
+    }
+    else if(optind < argc) {
+        input = open(argv[optind], O_RDONLY);
+        if(input < 0) {
+            fprintf(stderr, "Input file not found\n");
+
+            return 1;
+        }
+    }
     
-    FILE * output = stdout;
+    writer * output = create_writer(STDOUT_FILENO, OUTPUT_CAPACITY);
 
     if(output == NULL) {
-        fprintf(stderr, "Output file not found\n");
+        fprintf(stderr, "Unable to allocate output buffer\n");
+        close(input);
 
         return 1;
     }
 
-    FILE * input = stdin;
+    reader * input_reader = NULL;
+    if(map_input) {
+        input_reader = create_mapped_reader(input);
+    }
+    if(input_reader == NULL) {
+        input_reader = create_reader(input, BUFFER_CAPACITY);
+    }
 
-    if(input == NULL) {
-        fprintf(stderr, "Input file not found\n");
-        fclose(output);
+    if(input_reader == NULL) {
+        fprintf(stderr, "Unable to allocate input buffer\n");
+        close(input);
+        delete_writer(output);
 
         return 1;
     }
 
-    uint line_index = 0, line = 0;     
-    char buffer[BUFFER_CAPACITY];
-
-    highway * highway = create_highway(STD_HIGHWAY_CAPACITY);
+    uint line_number = 0;
 
-    char c = '\0';
-    int n = 0;
+    executor executor = {highway, output, replies, snapshot_path, journal, instructions};
+    stream_format commands = detect_format(input_reader);
 
-    while(1) {
-        n = fscanf(input, "%c", &c);
-        if(n == EOF) {
-            break;
-        }
-
-        if(c == '\n') {
-            buffer[line_index] = '\0';
+    read_result read = line_read;
+    if(pipelined) {
+        read = execute_stream_pipelined(&executor, input_reader, commands, &line_number);
+    }
+    else {
+        read = execute_stream(&executor, input_reader, commands, &line_number);
+    }
 
-            instruction * instruction = parse_instruction(buffer);
-            execute_command(&highway, instruction, output);
-            delete_instruction(instruction);
+    int return_code = 0;
 
-            line_index = 0;
-            ++line;
-        }
-        else {
-            buffer[line_index++] = c;
-        }    
+    if(read == line_too_long) {
+        fprintf(stderr, "%d-th command length > buffer capacity = %d\n", line_number + 1, BUFFER_CAPACITY);
+        return_code = 1;
+    }
+    else if(read == read_error) {
+        fprintf(stderr, "Unable to read %d-th command\n", line_number + 1);
+        return_code = 1;
+    }
 
-        if(line_index > BUFFER_CAPACITY) {
-            fprintf(stderr, "%d-th command length > buffer capacity = %d\n", line + 1, BUFFER_CAPACITY);
+    delete_reader(input_reader);
+    close(input);
 
-            delete_highway(highway);
-            fclose(input);
-            fclose(output);
+    if(socket_path != NULL && return_code == 0) {
+        flush_writer(output);
 
-            return 1;
+        if(run_server(&executor, socket_path) == 0) {
+            fprintf(stderr, "Unable to serve on %s\n", socket_path);
+            return_code = 1;
         }
-    }    
+    }
+
+    if(journal != NULL && (journal_sync(journal) == 0 || journal->output->error)) {
+        fprintf(stderr, "Unable to write journal %s\n", journal_path);
+        return_code = 1;
+    }
+    delete_journal(journal);
+    delete_highway(executor.highway);
 
-    delete_highway(highway);
-    fclose(input);
-    fclose(output);
+    if(flush_writer(output) == 0 || output->error) {
+        fprintf(stderr, "Unable to write output\n");
+        return_code = 1;
+    }
+    delete_writer(output);
     
-    return 0;
+    return return_code;
 }
\ No newline at end of file
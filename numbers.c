@@ -0,0 +1,269 @@
+/**
+ * @file numbers.c
+ * @brief Contains functions to decode decimal numbers and lists of them.
+*/
+
+#include "numbers.h"
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <ctype.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_DECODERS
+#include <immintrin.h>
+#endif
+
+#define NDEBUG
+
+#ifndef NDEBUG
+#include <stdio.h>
+#endif
+
+/**
+ * Longest token converted in parallel.
+*/
+#define SIMD_DIGITS 16
+
+typedef uint (* list_decoder)(const char *, uint, char, uint *, uint, uint *, uint *);
+
+uint decode_number(const char * token, uint length, uint * value) {
+    uint i = 0;
+    while(i < length && isspace((unsigned char) token[i])) {
+        ++i;
+    }
+
+    uint negative = 0;
+    if(i < length && (token[i] == '-' || token[i] == '+')) {
+        negative = token[i] == '-';
+        ++i;
+    }
+
+    uint64_t result = 0;
+    uint overflow = 0;
+    while(i < length && token[i] >= '0' && token[i] <= '9') {
+        result = result * 10 + (token[i] - '0');
+        if(result > INT_MAX) {
+            overflow = 1;
+            result = 0;
+        }
+        ++i;
+    }
+
+    if(overflow || (negative && result > 0)) {
+        #ifndef NDEBUG
+        printf("\tNumber out of range: %.*s\n", length, token);
+        #endif
+
+        *value = 0;
+        return 0;
+    }
+
+    *value = (uint) result;
+    return 1;
+}
+
+/**
+ * @brief Decode a list one character at a time.
+*/
+uint decode_list_scalar(const char * text, uint length, char separator, uint * values, uint capacity,
+                    uint * consumed, uint * out_of_range) {
+    uint n = 0;
+    uint start = 0;
+
+    while(n < capacity && start <= length) {
+        const char * found = (const char *) memchr(text + start, separator, length - start);
+        uint end = found != NULL ? found - text : length;
+
+        *out_of_range += !decode_number(text + start, end - start, &values[n++]);
+        start = end + 1;
+    }
+
+    *consumed = start;
+    return n;
+}
+
+#ifdef SIMD_DECODERS
+
+/**
+ * @brief Convert the token text[start, end) with SSE4.1 if it is made of 1 to SIMD_DIGITS digits, with decode_number
+ * otherwise.
+ *
+ * The 16 characters ending with the token are loaded at once: the characters before the token are zeroed, then pairs,
+ * quadruples and octets of digits are combined by multiply-add instructions.
+*/
+__attribute__((target("sse4.1")))
+uint convert_token_sse41(const char * text, uint start, uint end, uint * value) {
+    uint length = end - start;
+
+    if(length == 0 || length > SIMD_DIGITS || end < SIMD_DIGITS) {
+        return decode_number(text + start, length, value);
+    }
+
+    __m128i chunk = _mm_loadu_si128((const __m128i *) (text + end - SIMD_DIGITS));
+    __m128i digits = _mm_sub_epi8(chunk, _mm_set1_epi8('0'));
+
+    // A character is a digit if its distance from '0' is at most 9 (the subtraction wraps the smaller ones)
+    uint is_digit = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(digits, _mm_set1_epi8(9)), _mm_setzero_si128()));
+    uint inside = (0xFFFF << (SIMD_DIGITS - length)) & 0xFFFF;
+    if((is_digit & inside) != inside) {
+        return decode_number(text + start, length, value);
+    }
+
+    __m128i position = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    digits = _mm_and_si128(digits, _mm_cmpgt_epi8(position, _mm_set1_epi8(SIMD_DIGITS - 1 - length)));
+
+    __m128i pairs = _mm_maddubs_epi16(digits, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+    __m128i quadruples = _mm_madd_epi16(pairs, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+    quadruples = _mm_packus_epi32(quadruples, quadruples);
+    __m128i octets = _mm_madd_epi16(quadruples, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+    uint64_t result = (uint64_t) (uint) _mm_cvtsi128_si32(octets) * 100000000 + (uint) _mm_extract_epi32(octets, 1);
+
+    if(result > INT_MAX) {
+        *value = 0;
+        return 0;
+    }
+
+    *value = (uint) result;
+    return 1;
+}
+
+/**
+ * @brief Decode a list locating the separators of 16 characters at once.
+ *
+ * mask holds the separators of the block starting at block which have not been used yet; the characters after the
+ * last whole block are scanned one at a time.
+*/
+__attribute__((target("sse4.1")))
+uint decode_list_sse41(const char * text, uint length, char separator, uint * values, uint capacity,
+                    uint * consumed, uint * out_of_range) {
+    __m128i separators = _mm_set1_epi8(separator);
+    uint n = 0;
+    uint start = 0;
+    uint block = 0, loaded = 0;
+    uint mask = 0;
+
+    while(n < capacity && start <= length) {
+        uint end = length;
+
+        while(1) {
+            if(mask != 0) {
+                end = block + __builtin_ctz(mask);
+                mask &= mask - 1;
+                break;
+            }
+
+            uint next = loaded ? block + 16 : start;
+            if(next + 16 > length) {
+                const char * found = (const char *) memchr(text + start, separator, length - start);
+                end = found != NULL ? found - text : length;
+                break;
+            }
+
+            block = next;
+            loaded = 1;
+            mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (text + block)), separators));
+        }
+
+        *out_of_range += !convert_token_sse41(text, start, end, &values[n++]);
+        start = end + 1;
+    }
+
+    *consumed = start;
+    return n;
+}
+
+/**
+ * @brief Decode a list locating the separators of 32 characters at once (see decode_list_sse41).
+*/
+__attribute__((target("avx2")))
+uint decode_list_avx2(const char * text, uint length, char separator, uint * values, uint capacity,
+                    uint * consumed, uint * out_of_range) {
+    __m256i separators = _mm256_set1_epi8(separator);
+    uint n = 0;
+    uint start = 0;
+    uint block = 0, loaded = 0;
+    uint mask = 0;
+
+    while(n < capacity && start <= length) {
+        uint end = length;
+
+        while(1) {
+            if(mask != 0) {
+                end = block + __builtin_ctz(mask);
+                mask &= mask - 1;
+                break;
+            }
+
+            uint next = loaded ? block + 32 : start;
+            if(next + 32 > length) {
+                const char * found = (const char *) memchr(text + start, separator, length - start);
+                end = found != NULL ? found - text : length;
+                break;
+            }
+
+            block = next;
+            loaded = 1;
+            mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (text + block)),
+                                                        separators));
+        }
+
+        *out_of_range += !convert_token_sse41(text, start, end, &values[n++]);
+        start = end + 1;
+    }
+
+    *consumed = start;
+    return n;
+}
+
+#endif
+
+list_decoder DECODERS[] = {
+    decode_list_scalar,
+    #ifdef SIMD_DECODERS
+    decode_list_sse41,
+    decode_list_avx2
+    #endif
+};
+
+/**
+ * Decoder used by decode_number_list (-1 until it is detected).
+*/
+int current_decoder = -1;
+
+number_decoder detect_number_decoder() {
+    #ifdef SIMD_DECODERS
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2")) {
+        return avx2_decoder;
+    }
+    if(__builtin_cpu_supports("sse4.1")) {
+        return sse41_decoder;
+    }
+    #endif
+
+    return scalar_decoder;
+}
+
+number_decoder select_number_decoder(number_decoder decoder) {
+    number_decoder best = detect_number_decoder();
+
+    current_decoder = decoder <= best ? decoder : best;
+
+    #ifndef NDEBUG
+    printf("Number decoder %d selected (%d requested)\n", current_decoder, decoder);
+    #endif
+
+    return current_decoder;
+}
+
+uint decode_number_list(const char * text, uint length, char separator, uint * values, uint capacity,
+                    uint * consumed, uint * out_of_range) {
+    if(current_decoder < 0) {
+        current_decoder = detect_number_decoder();
+    }
+
+    return DECODERS[current_decoder](text, length, separator, values, capacity, consumed, out_of_range);
+}
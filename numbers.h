@@ -0,0 +1,87 @@
+#ifndef _NUMBERS_
+#define _NUMBERS_
+
+/**
+ * @headerfile numbers.h
+ * @brief Interface of numbers.c
+ *
+ * Numbers are decoded with the semantics of atoi (leading spaces are skipped, an optional sign is accepted, the digits
+ * are read until the first non digit character), but a number which is negative or greater than INT_MAX is reported
+ * as out of range instead of being silently clamped.
+ *
+ * Lists of numbers are decoded by the best decoder supported by the processor, detected at runtime with cpuid: the
+ * separators of 16 (SSE4.1) or 32 (AVX2) characters are located at once, and a token of up to 16 digits is converted
+ * in parallel; any other token is converted by the scalar decoder.
+*/
+
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+/**
+ * @enum number_decoder
+ * @brief Codifies the implementations of the list decoder.
+*/
+typedef enum {
+    scalar_decoder = 0,
+    sse41_decoder = 1,
+    avx2_decoder = 2
+} number_decoder;
+
+/**
+ * @brief Decode a number.
+ *
+ * @param token Pointer to the first character of the number.
+ * @param length Number of characters of the number.
+ * @param value Address where the value is put (0 if it is out of range).
+ *
+ * @pre value != NULL
+ *
+ * @returns 1 if the number is in range, 0 otherwise.
+*/
+uint decode_number(const char * token, uint length, uint * value);
+
+/**
+ * @brief Decode a list of numbers separated by a character.
+ *
+ * Every token of text is a number, also if it is empty (so a list of n separators has n + 1 numbers); the last token
+ * ends at the end of text.
+ *
+ * @param text Pointer to the first character of the list.
+ * @param length Number of characters of the list.
+ * @param separator Character which separates the numbers.
+ * @param values Array where the numbers are put.
+ * @param capacity Maximum number of numbers to decode.
+ * @param consumed Address where the number of characters decoded (with their separators) is put: it is length + 1
+ *                 when the last number has been decoded, as if the end of text were a separator too.
+ * @param out_of_range Address where the number of numbers out of range (decoded as 0) is added.
+ *
+ * @pre text != NULL || length == 0
+ * @pre values != NULL
+ * @pre consumed != NULL
+ * @pre out_of_range != NULL
+ *
+ * @returns The number of numbers decoded.
+*/
+uint decode_number_list(const char * text, uint length, char separator, uint * values, uint capacity,
+                    uint * consumed, uint * out_of_range);
+
+/**
+ * @brief Detect the best list decoder supported by the processor.
+ *
+ * @returns The decoder detected.
+*/
+number_decoder detect_number_decoder();
+
+/**
+ * @brief Choose the list decoder used by decode_number_list.
+ *
+ * @param decoder Decoder requested.
+ *
+ * @returns The decoder chosen: the one requested if the processor supports it, the best supported one otherwise.
+ *
+ * @note Without a call to this function, the decoder returned by detect_number_decoder is used.
+*/
+number_decoder select_number_decoder(number_decoder decoder);
+
+#endif
@@ -4,8 +4,10 @@
 */
 
 #include "parser.h"
+#include "numbers.h"
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 #define NDEBUG
 
@@ -13,246 +15,282 @@
 #include <stdio.h>
 #endif
 
-const uint N_COMMANDS = 5;
+const uint N_COMMANDS = 7;
 const char COMMANDS[][20] = {
     "aggiungi-stazione",
     "demolisci-stazione",
     "aggiungi-auto",
     "rottama-auto",
-    "pianifica-percorso"
+    "pianifica-percorso",
+    "salva-stato",
+    "importa-stazioni"
 };
 command_type COMMANDS_CODING[] = {
     add_station_command,
     delete_station_command,
     add_car_command,
     remove_car_command,
-    plan_path_command
+    plan_path_command,
+    save_state_command,
+    load_stations_command
 };
+const uint COMMANDS_LENGTH[] = {17, 18, 13, 12, 18, 11, 16};
 
+/**
+ * Perfect hash of the commands: the slot (length ^ first character) & (COMMANDS_HASH_SIZE - 1) of every command holds 
+ * its index in COMMANDS, the other slots hold N_COMMANDS.
+*/
+#define COMMANDS_HASH_SIZE 16
+const unsigned char COMMANDS_HASH[COMMANDS_HASH_SIZE] = {
+    0, 7, 4, 7, 7, 7, 1, 7, 5, 6, 7, 7, 2, 7, 3, 7
+};
 
-instruction * parse_instruction_separator(const char * command, char separator) {
-    #ifndef NDEBUG
-    printf("Starting parse_instruction\n");
-    #endif
+/**
+ * Bounds of the number of parameters of a valid instruction of every command.
+*/
+const uint MIN_PARAMS[] = {1, 1, 2, 2, 2, 0, 2};
+const uint MAX_PARAMS[] = {UINT_MAX, 1, 2, 2, 2, 0, UINT_MAX};
 
-    if(command == NULL) {
-        #ifndef NDEBUG
-        printf("\tNULL command\n");
-        #endif
 
-        return NULL;
+uint parse_parameter(const char * token, uint length) {
+    uint value = 0;
+    decode_number(token, length, &value);
+
+    return value;
+}
+
+command_type recognize_command(const char * command, uint name_length) {
+    if(name_length == 0) {
+        return no_command;
     }
 
-    uint length = strlen(command);
+    uint index = COMMANDS_HASH[(name_length ^ (unsigned char) command[0]) & (COMMANDS_HASH_SIZE - 1)];
 
-    instruction * instr = (instruction *) malloc(sizeof(instruction));
-    if(instr == NULL) {
+    if(index < N_COMMANDS && COMMANDS_LENGTH[index] == name_length && memcmp(command, COMMANDS[index], name_length) == 0) {
         #ifndef NDEBUG
-        printf("\tNot enough space to allocate instruction of size %ld\n", sizeof(instruction));
+        printf("\tCommand = %s, command_code = %d\n", COMMANDS[index], COMMANDS_CODING[index]);
         #endif
 
-        return NULL;
+        return COMMANDS_CODING[index];
     }
 
+    #ifndef NDEBUG
+    printf("\tCommand not codified\n");
+    #endif
+
+    return no_command;
+}
+
+/**
+ * @brief Parse a line in a single forward scan.
+ * 
+ * The name of the command ends at the first separator (or at the end of the line); the parameters are then decoded by 
+ * decode_number_list directly in the arena, which grows whenever it is full.
+ * 
+ * @returns 1 if the instruction is valid, 0 if it is not valid, -1 if there is not enough memory (the command is 
+ *          no_command).
+ * 
+ * @note An instruction with a parameter out of range is not valid, and its command is no_command.
+*/
+int scan_line(const char * command, uint length, char separator, parse_arena * arena, instruction * instr) {
     instr->command = no_command;
     instr->params = NULL;
     instr->params_length = 0;
 
-    uint num_params = 1;
-    uint sep_index = 0;
+    uint i = 0;
+    while(i < length && command[i] != separator) {
+        ++i;
+    }
 
-    char tmp[length];
+    command_type code = recognize_command(command, i);
+    if(code == no_command) {
+        return 0;
+    }
 
-    #ifndef NDEBUG
-    printf("\tStarting separator search\n");
-    #endif
+    uint n = 0, out_of_range = 0;
+
+    // command[i] is the separator before the parameters, position the first character not decoded yet
+    for(uint position = i + 1; position <= length; ) {
+        if(n == arena->capacity && arena_parameters(arena, n + 1) == NULL) {
+            #ifndef NDEBUG
+            printf("\tNot enough space to store parameter %d\n", n);
+            #endif
 
-    for(uint i = 0; i < length; ++i) {
-        if(command[i] == separator) {
-            if(num_params == 1) {
-                
-                #ifndef NDEBUG
-                printf("\tFirst separator found at index %d\n", i);
-                #endif
-
-                sep_index = i;
-
-                #ifndef NDEBUG
-                printf("\tCopying command -> ");
-                #endif
-                for(int j = 0; j < i; ++j) {
-                    tmp[j] = command[j];
-                    #ifndef NDEBUG
-                    printf("%c", command[j]);
-                    #endif
-                }
-                tmp[i] = '\0';
-                #ifndef NDEBUG
-                printf("\n");
-                #endif
-
-                for(uint j = 0; j < N_COMMANDS; ++j) {
-                    if(strcmp(tmp, COMMANDS[j]) == 0) {
-                    #ifndef NDEBUG
-                    printf("\tCommand = %s, command_code = %d\n", tmp, COMMANDS_CODING[j]);
-                    #endif
-
-                    instr->command = COMMANDS_CODING[j];
-                    }
-                }
-            }
-           
-           ++num_params;
+            return -1;
         }
+
+        uint consumed = 0;
+        n += decode_number_list(command + position, length - position, separator, arena->params + n, 
+                arena->capacity - n, &consumed, &out_of_range);
+        position += consumed;
     }
 
-    if(instr->command == no_command) {
+    if(out_of_range > 0) {
         #ifndef NDEBUG
-        printf("\tCommand not codified\n");
+        printf("\t%d parameters out of range\n", out_of_range);
         #endif
 
-        return instr;
+        return 0;
     }
 
-    instr->params_length = num_params - 1;
+    instr->command = code;
+    instr->params = n > 0 ? arena->params : NULL;
+    instr->params_length = n;
+
+    return validate_instruction(instr);
+}
+
+instruction * parse_instruction_separator(const char * command, uint length, char separator) {
+    #ifndef NDEBUG
+    printf("Starting parse_instruction\n");
+    #endif
 
-    if(num_params == 1) {
+    if(command == NULL) {
         #ifndef NDEBUG
-        printf("\tNo parameters found\n");
+        printf("\tNULL command\n");
         #endif
 
-        return instr;
+        return NULL;
     }
 
-    uint * params = (uint *) malloc(sizeof(uint) * (num_params - 1));
-    if(params == NULL) {
+    instruction * instr = (instruction *) malloc(sizeof(instruction));
+    if(instr == NULL) {
         #ifndef NDEBUG
-        printf("\tNot enough space to allocate array of %ld bytes\n", sizeof(uint) * (num_params - 1));
+        printf("\tNot enough space to allocate instruction of size %ld\n", sizeof(instruction));
         #endif
 
-        delete_instruction(instr);
         return NULL;
     }
 
-    #ifndef NDEBUG
-    printf("\tAllocated array of %ld bytes\n", sizeof(uint) * (num_params - 1));
-    printf("\tExtracting %d parameters\n", num_params - 1);
-    #endif
+    // The parameters are collected in an arena whose array is then handed to the instruction
+    parse_arena params = {NULL, 0, 0};
 
-    uint j = 0;
-    int conv = 0;
-    
-    for(uint i = sep_index + 1; i < length; ++i) {
-        if(command[i] == separator) {
-            #ifndef NDEBUG
-            printf("\tSpace found at index %d, last_space=%d\n", i, sep_index);
-            #endif
+    if(scan_line(command, length, separator, &params, instr) < 0) {
+        free(params.params);
+        free(instr);
 
-            #ifndef NDEBUG
-            printf("\tCopying parameter -> ");
-            #endif
-            for(int k = sep_index + 1; k < i; ++k) {
-                tmp[k - sep_index - 1] = command[k];
-                #ifndef NDEBUG
-                printf("%c", command[k]);
-                #endif
-            }
-            tmp[i - sep_index - 1] = '\0';
-            
-            #ifndef NDEBUG
-            printf("\n\tParameter found: %s\n", tmp);
-            #endif
+        return NULL;
+    }
 
-            conv = atoi(tmp);
-            if(conv < 0) {
-                params[j++] = 0;
-            }
-            else {
-                params[j++] = conv;
-            } 
+    if(instr->params == NULL) {
+        free(params.params);
+    }
 
-            #ifndef NDEBUG
-            printf("\tParameter converted: %d\n", params[j - 1]);
-            #endif
+    #ifndef NDEBUG
+    printf("Ending parse_instruction\n");
+    #endif
 
-            sep_index = i;
-        }    
+    return instr;
+}
+
+instruction * parse_instruction(const char * command) {
+    if(command == NULL) {
+        return NULL;
     }
 
+    return parse_instruction_separator(command, strlen(command), ' ');
+}
+
+instruction * parse_line(const char * line, uint length) {
+    return parse_instruction_separator(line, length, ' ');
+}
+
+parse_arena * create_parse_arena(uint capacity) {
     #ifndef NDEBUG
-    printf("\tCopying last parameter -> ");
+    printf("Starting parse arena creation\n");
     #endif
-    for(uint k = sep_index + 1; k < length; ++k) {
-        tmp[k - sep_index - 1] = command[k];
+
+    parse_arena * new_arena = (parse_arena *) malloc(sizeof(parse_arena));
+    if(new_arena == NULL) {
         #ifndef NDEBUG
-        printf("%c", command[k]);
+        printf("\tNot enough space to allocate parse arena of %ld bytes\n", sizeof(parse_arena));
         #endif
+
+        return NULL;
     }
-    tmp[length - sep_index - 1] = '\0';
-    
-    #ifndef NDEBUG
-    printf("\n\tLast parameter found: %s\n", tmp);
-    #endif
 
-    conv = atoi(tmp);
-    if(conv < 0) {
-        params[j] = 0;
+    new_arena->params = capacity > 0 ? (uint *) malloc(sizeof(uint) * capacity) : NULL;
+    if(capacity > 0 && new_arena->params == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough space to allocate array of %ld bytes\n", sizeof(uint) * capacity);
+        #endif
+
+        free(new_arena);
+        return NULL;
     }
-    else {
-        params[j] = conv;
-    } 
+
+    new_arena->capacity = capacity;
+    new_arena->allocations = capacity > 0 ? 2 : 1;
 
     #ifndef NDEBUG
-    printf("\tLast parameter converted: %d\n", params[j - 1]);
+    printf("Ending parse arena creation\n");
     #endif
 
-    instr->params = params;
+    return new_arena;
+}
 
-    #ifndef NDEBUG
-    printf("\tList of all parameters found: ");
-    for(int i = 0; i < instr->params_length; ++i) {
-        printf("%d ", instr->params[i]);
+void delete_parse_arena(parse_arena * arena) {
+    if(arena != NULL) {
+        free(arena->params);
+        free(arena);
+    }
+}
+
+uint * arena_parameters(parse_arena * arena, uint length) {
+    if(length <= arena->capacity) {
+        return arena->params;
+    }
+
+    uint capacity = arena->capacity > 0 ? arena->capacity : STD_ARENA_CAPACITY;
+    while(capacity < length) {
+        capacity *= 2;
     }
-    printf("\n");
-    #endif
 
     #ifndef NDEBUG
-    printf("Ending parse_instruction\n");
+    printf("\tGrowing parse arena from %d to %d parameters\n", arena->capacity, capacity);
     #endif
 
-    return instr;
+    uint * params = (uint *) malloc(sizeof(uint) * capacity);
+    if(params == NULL) {
+        return NULL;
+    }
+
+    if(arena->capacity > 0) {
+        memcpy(params, arena->params, sizeof(uint) * arena->capacity);
+    }
+    free(arena->params);
+    arena->params = params;
+    arena->capacity = capacity;
+    ++arena->allocations;
+
+    return params;
 }
 
-instruction * parse_instruction(const char * command) {
-    return parse_instruction_separator(command, ' ');
-    
+int parse_line_into(const char * line, uint length, parse_arena * arena, instruction * instruction) {
+    return scan_line(line, length, ' ', arena, instruction);
 }
 
 uint validate_instruction(const instruction * instruction) {
+    if(instruction->command >= no_command) {
+        return 0;
+    }
 
-    uint validation = 0;
-
-    switch (instruction->command) {
-    case add_station_command: validation = instruction->params_length > 0;
-        break;
-    
-    case delete_station_command: validation = instruction->params_length == 1;
-        break;
-
-    case add_car_command: validation = instruction->params_length == 2;
-        break;
-
-    case remove_car_command: validation = instruction->params_length == 2;
-        break;
+    if(instruction->params_length < MIN_PARAMS[instruction->command] || 
+        instruction->params_length > MAX_PARAMS[instruction->command]) {
+        return 0;
+    }
 
-    case plan_path_command: validation = instruction->params_length == 2;
-        break;
+    // The stations of importa-stazioni are delimited by their numbers of cars, which must cover all the parameters
+    if(instruction->command == load_stations_command) {
+        uint i = 0;
+        while(instruction->params_length - i >= 2 && instruction->params[i + 1] <= instruction->params_length - i - 2) {
+            i += instruction->params[i + 1] + 2;
+        }
 
-    case no_command: validation = 0;
-        break;
+        return i == instruction->params_length;
     }
 
-    return validation;
+    return 1;
 }
 
 void delete_instruction(instruction * instruction) {
@@ -18,7 +18,9 @@ typedef enum c_type{
     add_car_command = 2,
     remove_car_command = 3,
     plan_path_command = 4,
-    no_command = 5,
+    save_state_command = 5,
+    load_stations_command = 6,
+    no_command = 7,
 } command_type;
 
 /**
@@ -35,6 +37,43 @@ typedef struct instruction {
     uint params_length;
 } instruction;
 
+/**
+ * Number of parameters of a new parse arena whose capacity is not given.
+*/
+#define STD_ARENA_CAPACITY 16
+
+/**
+ * @struct parse_arena
+ * @brief Reusable storage for the parameters of the instruction of one line at a time.
+ * 
+ * Parsing a line reuses the storage of the previous one, which grows only when a line has more parameters than any 
+ * line before it: once the longest line has been seen, no heap memory is requested.
+ * 
+ * @param params Array of the parameters of the last line parsed.
+ * @param capacity Length of the params array.
+ * @param allocations Number of heap allocations done by the arena since its creation (itself included).
+*/
+typedef struct parse_arena {
+    uint * params;
+    uint capacity;
+    unsigned long allocations;
+} parse_arena;
+
+/**
+ * @brief Recognize the command whose name is at the start of a line.
+ * 
+ * The command is found by a perfect hash of the length of the name and of its first character, and confirmed by 
+ * comparing the name.
+ * 
+ * @param command Pointer to the first character of the line.
+ * @param name_length Number of characters of the name (the line up to the first separator).
+ * 
+ * @pre command != NULL || name_length == 0
+ * 
+ * @returns The code of the command, no_command if the name is not a command.
+*/
+command_type recognize_command(const char * command, uint name_length);
+
 /**
  * @brief Parse a command.
  * 
@@ -50,6 +89,93 @@ typedef struct instruction {
 */
 instruction * parse_instruction(const char * command);
 
+/**
+ * @brief Parse a command which is not null terminated.
+ * 
+ *  Parse a command from a view of length characters to an instruction struct, without copying the command first.
+ * 
+ * @param line Pointer to the first character of the command.
+ * @param length Number of characters of the command.
+ * 
+ * @pre line != NULL
+ * 
+ * @returns Pointer to the instruction if the command respects the syntax, NULL otherwise.
+*/
+instruction * parse_line(const char * line, uint length);
+
+/**
+ * @brief Create a parse arena.
+ * 
+ * @param capacity Number of parameters of the arena before its first growth (0 to allocate them at the first use).
+ * 
+ * @returns Pointer to the arena allocated on heap, NULL if there is not enough memory.
+*/
+parse_arena * create_parse_arena(uint capacity);
+
+/**
+ * @brief Delete a parse arena.
+ * 
+ * @param arena Pointer to the arena to delete.
+ * 
+ * @post The arena is deallocated, so the instructions parsed with it can no longer be used.
+*/
+void delete_parse_arena(parse_arena * arena);
+
+/**
+ * @brief Get the storage of the parameters of a line.
+ * 
+ * @param arena Pointer to the arena to use.
+ * @param length Number of parameters of the line.
+ * 
+ * @pre arena != NULL
+ * 
+ * @returns Pointer to an array of at least length parameters, NULL if there is not enough memory.
+ * 
+ * @note The parameters already stored are kept, so the array can grow while a line is parsed.
+*/
+uint * arena_parameters(parse_arena * arena, uint length);
+
+/**
+ * @brief Parse a command which is not null terminated into a caller owned instruction.
+ * 
+ *  Same as parse_line, but the parameters are stored in the arena, so no heap memory is requested unless the line is 
+ *  longer than any line parsed before with the same arena.
+ * 
+ *  The line is scanned once: the command is recognized by the length of its name and a perfect hash of its first 
+ *  character, the parameters are decoded by decode_number_list, and the validity of the instruction is known at the 
+ *  end of the scan.
+ * 
+ * @param line Pointer to the first character of the command.
+ * @param length Number of characters of the command.
+ * @param arena Pointer to the arena which stores the parameters.
+ * @param instruction Pointer to the instruction to fill.
+ * 
+ * @pre line != NULL
+ * @pre arena != NULL
+ * @pre instruction != NULL
+ * 
+ * @returns 1 if the instruction is valid (see validate_instruction), 0 if it is not valid, -1 if there is not enough 
+ *          memory (the command is no_command).
+ * 
+ * @note A parameter out of range (negative or greater than INT_MAX) makes the command no_command.
+ * 
+ * @note The instruction is valid until the next line is parsed with the same arena.
+*/
+int parse_line_into(const char * line, uint length, parse_arena * arena, instruction * instruction);
+
+/**
+ * @brief Convert a parameter of a command.
+ * 
+ * The conversion follows atoi: leading spaces are skipped, the digits are read until the first non digit character 
+ * (see decode_number).
+ * 
+ * @param token Pointer to the first character of the parameter.
+ * @param length Number of characters of the parameter.
+ * 
+ * @returns The value of the parameter, 0 if it is out of range (negative or greater than INT_MAX).
+*/
+uint parse_parameter(const char * token, uint length);
+
 /**
  * @brief Validate semantically an instruction.
  * 
@@ -58,6 +184,9 @@ instruction * parse_instruction(const char * command);
  * @pre instruction != NULL
  * 
  * @returns 1 if the instruction is semantically valid, 0 otherwise.
+ * 
+ * @note The parameters of importa-stazioni are a sequence of stations, each one a distance, a number of cars and the 
+ *       fuels of the cars: the numbers of cars must delimit the stations up to the last parameter.
 */
 uint validate_instruction(const instruction * instruction);
 
@@ -0,0 +1,183 @@
+/**
+ * @file pipeline.c
+ * @brief Overlap parsing and execution of the commands.
+ *
+ * The parser thread is the only producer and the executor thread the only consumer of a ring of instruction slots:
+ * head is written only by the producer, tail only by the consumer, so no lock is needed.
+*/
+
+#include "pipeline.h"
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define NDEBUG
+
+#ifndef NDEBUG
+#include <stdio.h>
+#endif
+
+#define CACHE_LINE 64
+#define SPIN_LIMIT 64
+
+/**
+ * @struct ring
+ * @brief Single producer single consumer ring of instructions.
+ *
+ * @param slots Pre-allocated instruction slots.
+ * @param arenas Parse arena of every slot, created the first time the slot is filled.
+ * @param head Number of instructions published by the producer.
+ * @param tail Number of instructions consumed by the consumer.
+ * @param done 1 when the producer has published every instruction, 0 otherwise.
+ * @param result Result of the last request of the producer to the reader.
+ * @param input Reader used by the producer.
+ * @param commands Encoding of the commands read by the producer.
+ *
+ * @note head, tail and done are on separate cache lines to avoid false sharing.
+*/
+typedef struct ring {
+    instruction slots[RING_CAPACITY];
+    parse_arena * arenas[RING_CAPACITY];
+    _Alignas(CACHE_LINE) atomic_size_t head;
+    _Alignas(CACHE_LINE) atomic_size_t tail;
+    _Alignas(CACHE_LINE) atomic_uint done;
+    read_result result;
+    reader * input;
+    stream_format commands;
+} ring;
+
+/**
+ * @brief Wait for the other thread, spinning first and then yielding the processor.
+*/
+void wait_turn(uint * spins) {
+    if(*spins < SPIN_LIMIT) {
+        ++(*spins);
+    }
+    else {
+        sched_yield();
+    }
+}
+
+void * produce_instructions(void * argument) {
+    ring * my_ring = (ring *) argument;
+
+    size_t head = atomic_load_explicit(&my_ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&my_ring->tail, memory_order_acquire);
+
+    read_result read = line_read;
+
+    while(read == line_read) {
+        uint spins = 0;
+        while(head - tail == RING_CAPACITY) {
+            wait_turn(&spins);
+            tail = atomic_load_explicit(&my_ring->tail, memory_order_acquire);
+        }
+
+        // The slot is free, so the command is parsed directly in it, with the parameters in the arena of the slot
+        instruction * slot = &my_ring->slots[head & (RING_CAPACITY - 1)];
+        parse_arena ** arena = &my_ring->arenas[head & (RING_CAPACITY - 1)];
+        if(*arena == NULL && (*arena = create_parse_arena(STD_ARENA_CAPACITY)) == NULL) {
+            read = read_error;
+            break;
+        }
+
+        if((read = next_instruction_into(my_ring->input, my_ring->commands, *arena, slot)) != line_read) {
+            break;
+        }
+
+        ++head;
+        atomic_store_explicit(&my_ring->head, head, memory_order_release);
+    }
+
+    #ifndef NDEBUG
+    printf("\tParser thread published %ld instructions\n", head);
+    #endif
+
+    my_ring->result = read;
+    atomic_store_explicit(&my_ring->done, 1, memory_order_release);
+
+    return NULL;
+}
+
+read_result execute_stream_pipelined(executor * executor, reader * input, stream_format commands, uint * line_number) {
+    #ifndef NDEBUG
+    printf("Starting pipelined execution\n");
+    #endif
+
+    ring * my_ring = (ring *) aligned_alloc(CACHE_LINE, sizeof(ring));
+    if(my_ring == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough space to allocate ring of %ld bytes\n", sizeof(ring));
+        #endif
+
+        return read_error;
+    }
+
+    atomic_init(&my_ring->head, 0);
+    atomic_init(&my_ring->tail, 0);
+    atomic_init(&my_ring->done, 0);
+    my_ring->result = line_read;
+    my_ring->input = input;
+    my_ring->commands = commands;
+    for(uint i = 0; i < RING_CAPACITY; ++i) {
+        my_ring->arenas[i] = NULL;
+    }
+
+    pthread_t parser;
+    if(pthread_create(&parser, NULL, produce_instructions, my_ring) != 0) {
+        #ifndef NDEBUG
+        printf("\tUnable to start parser thread\n");
+        #endif
+
+        free(my_ring);
+        return read_error;
+    }
+
+    size_t tail = 0;
+    size_t head = 0;
+
+    while(1) {
+        uint spins = 0;
+        while(tail == head) {
+            head = atomic_load_explicit(&my_ring->head, memory_order_acquire);
+            if(tail < head) {
+                break;
+            }
+
+            if(atomic_load_explicit(&my_ring->done, memory_order_acquire)) {
+                head = atomic_load_explicit(&my_ring->head, memory_order_acquire);
+                break;
+            }
+
+            wait_turn(&spins);
+        }
+
+        if(tail == head) {
+            break;
+        }
+
+        while(tail < head) {
+            instruction * slot = &my_ring->slots[tail & (RING_CAPACITY - 1)];
+            execute_command(executor, slot);
+
+            ++tail;
+            ++(*line_number);
+            atomic_store_explicit(&my_ring->tail, tail, memory_order_release);
+        }
+    }
+
+    pthread_join(parser, NULL);
+
+    read_result result = my_ring->result;
+    for(uint i = 0; i < RING_CAPACITY; ++i) {
+        delete_parse_arena(my_ring->arenas[i]);
+    }
+    free(my_ring);
+
+    #ifndef NDEBUG
+    printf("Ending pipelined execution\n");
+    #endif
+
+    return result;
+}
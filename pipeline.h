@@ -0,0 +1,37 @@
+#ifndef _PIPELINE_
+#define _PIPELINE_
+
+/**
+ * @headerfile pipeline.h
+ * @brief Interface of pipeline.c
+*/
+
+#include "executor.h"
+
+/**
+ * Number of slots of the instruction ring (must be a power of 2).
+*/
+#define RING_CAPACITY 1024
+
+/**
+ * @brief Parse and execute every command of an input with two threads.
+ * 
+ * A parser thread reads and parses the commands into the slots of a single producer single consumer lock-free ring;
+ * the calling thread executes them in order, so the replies are the same of execute_stream. When the ring is full the 
+ * parser waits for the executor (and viceversa when it is empty).
+ * 
+ * @param executor Pointer to the executor to use.
+ * @param input Pointer to the reader of the commands.
+ * @param commands Encoding of the commands.
+ * @param line_number Address of the counter of the commands executed.
+ * 
+ * @pre executor != NULL
+ * @pre input != NULL
+ * @pre line_number != NULL
+ * 
+ * @returns The result of the last request to the reader (end_of_input if every command is executed), 
+ *          read_error also if the parser thread cannot be started.
+*/
+read_result execute_stream_pipelined(executor * executor, reader * input, stream_format commands, uint * line_number);
+
+#endif
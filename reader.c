@@ -0,0 +1,367 @@
+/**
+ * @file reader.c
+ * @brief Contains functions to read lines from a file descriptor in blocks.
+*/
+
+#include "reader.h"
+#include "binary.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define NDEBUG
+
+#ifndef NDEBUG
+#include <stdio.h>
+#endif
+
+reader * create_reader(int fd, uint capacity) {
+    #ifndef NDEBUG
+    printf("Starting reader creation\n");
+    #endif
+
+    if(capacity == 0) {
+        #ifndef NDEBUG
+        printf("\tThe capacity of the reader must be greater than 0\n");
+        #endif
+
+        return NULL;
+    }
+
+    reader * new_reader = (reader *) malloc(sizeof(reader));
+    if(new_reader == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough space to allocate reader of %ld bytes\n", sizeof(reader));
+        #endif
+
+        return NULL;
+    }
+
+    new_reader->buffer = (char *) malloc(sizeof(char) * capacity);
+    if(new_reader->buffer == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough space to allocate buffer of %ld bytes\n", sizeof(char) * capacity);
+        #endif
+
+        free(new_reader);
+        return NULL;
+    }
+
+    new_reader->fd = fd;
+    new_reader->capacity = capacity;
+    new_reader->begin = 0;
+    new_reader->scanned = 0;
+    new_reader->end = 0;
+    new_reader->eof = 0;
+    new_reader->mapped = 0;
+
+    #ifndef NDEBUG
+    printf("Ending reader creation\n");
+    #endif
+
+    return new_reader;
+}
+
+reader * create_mapped_reader(int fd) {
+    #ifndef NDEBUG
+    printf("Starting mapped reader creation\n");
+    #endif
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+        #ifndef NDEBUG
+        printf("\tFile descriptor %d is not a non empty regular file\n", fd);
+        #endif
+
+        return NULL;
+    }
+
+    char * mapping = (char *) mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(mapping == MAP_FAILED) {
+        #ifndef NDEBUG
+        printf("\tUnable to map file of %ld bytes\n", (long) info.st_size);
+        #endif
+
+        return NULL;
+    }
+
+    madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+
+    reader * new_reader = (reader *) malloc(sizeof(reader));
+    if(new_reader == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough space to allocate reader of %ld bytes\n", sizeof(reader));
+        #endif
+
+        munmap(mapping, info.st_size);
+        return NULL;
+    }
+
+    new_reader->fd = fd;
+    new_reader->buffer = mapping;
+    new_reader->capacity = info.st_size;
+    new_reader->begin = 0;
+    new_reader->scanned = 0;
+    new_reader->end = info.st_size;
+    new_reader->eof = 1;
+    new_reader->mapped = 1;
+
+    #ifndef NDEBUG
+    printf("Ending mapped reader creation\n");
+    #endif
+
+    return new_reader;
+}
+
+void delete_reader(reader * reader) {
+    if(reader != NULL) {
+        if(reader->mapped) {
+            munmap(reader->buffer, reader->capacity);
+        }
+        else {
+            free(reader->buffer);
+        }
+        free(reader);
+    }
+}
+
+/**
+ * @brief Move the characters not returned yet at the start of the buffer and fill the rest with a read(2).
+ *
+ * @returns The number of bytes read, 0 at the end of the file, -1 on error.
+*/
+int fill_buffer(reader * reader) {
+    if(reader->begin > 0) {
+        memmove(reader->buffer, reader->buffer + reader->begin, reader->end - reader->begin);
+
+        reader->end -= reader->begin;
+        reader->scanned -= reader->begin;
+        reader->begin = 0;
+    }
+
+    ssize_t n = 0;
+    do {
+        n = read(reader->fd, reader->buffer + reader->end, reader->capacity - reader->end);
+    } while(n < 0 && errno == EINTR);
+
+    #ifndef NDEBUG
+    printf("\tRead block of %ld bytes\n", n);
+    #endif
+
+    if(n > 0) {
+        reader->end += n;
+    }
+
+    return n;
+}
+
+read_result next_line(reader * reader, line * line) {
+    while(1) {
+        char * newline = (char *) memchr(reader->buffer + reader->scanned, '\n', reader->end - reader->scanned);
+
+        if(newline != NULL) {
+            size_t index = newline - reader->buffer;
+
+            line->text = reader->buffer + reader->begin;
+            line->length = index - reader->begin;
+
+            reader->begin = index + 1;
+            reader->scanned = index + 1;
+
+            return line_read;
+        }
+
+        reader->scanned = reader->end;
+
+        if(reader->eof) {
+            return end_of_input;
+        }
+
+        if(reader->begin == 0 && reader->end == reader->capacity) {
+            #ifndef NDEBUG
+            printf("\tLine longer than buffer capacity = %ld\n", reader->capacity);
+            #endif
+
+            return line_too_long;
+        }
+
+        int n = fill_buffer(reader);
+        if(n < 0) {
+            return read_error;
+        }
+        if(n == 0) {
+            reader->eof = 1;
+        }
+    }
+}
+
+read_result next_token(reader * reader, char separator, line * token, uint * last) {
+    while(1) {
+        size_t i = reader->scanned;
+        while(i < reader->end && reader->buffer[i] != separator && reader->buffer[i] != '\n') {
+            ++i;
+        }
+
+        if(i < reader->end) {
+            token->text = reader->buffer + reader->begin;
+            token->length = i - reader->begin;
+            *last = reader->buffer[i] == '\n';
+
+            reader->begin = i + 1;
+            reader->scanned = i + 1;
+
+            return line_read;
+        }
+
+        reader->scanned = reader->end;
+
+        if(reader->eof) {
+            return end_of_input;
+        }
+
+        if(reader->begin == 0 && reader->end == reader->capacity) {
+            #ifndef NDEBUG
+            printf("\tToken longer than buffer capacity = %ld\n", reader->capacity);
+            #endif
+
+            return line_too_long;
+        }
+
+        int n = fill_buffer(reader);
+        if(n < 0) {
+            return read_error;
+        }
+        if(n == 0) {
+            reader->eof = 1;
+        }
+    }
+}
+
+read_result next_tokens(reader * reader, char separator, line * tokens, uint * last) {
+    while(1) {
+        const char * newline = (const char *) memchr(reader->buffer + reader->scanned, '\n', 
+                                    reader->end - reader->scanned);
+        if(newline != NULL) {
+            size_t i = newline - reader->buffer;
+
+            tokens->text = reader->buffer + reader->begin;
+            tokens->length = i - reader->begin;
+            *last = 1;
+
+            reader->begin = i + 1;
+            reader->scanned = i + 1;
+
+            return line_read;
+        }
+
+        // No newline is buffered: the whole tokens are the ones before the last separator
+        size_t i = reader->end;
+        while(i > reader->begin && reader->buffer[i - 1] != separator) {
+            --i;
+        }
+
+        reader->scanned = reader->end;
+
+        if(i > reader->begin) {
+            tokens->text = reader->buffer + reader->begin;
+            tokens->length = i - 1 - reader->begin;
+            *last = 0;
+
+            reader->begin = i;
+
+            return line_read;
+        }
+
+        if(reader->eof) {
+            return end_of_input;
+        }
+
+        if(reader->begin == 0 && reader->end == reader->capacity) {
+            #ifndef NDEBUG
+            printf("\tToken longer than buffer capacity = %ld\n", reader->capacity);
+            #endif
+
+            return line_too_long;
+        }
+
+        int n = fill_buffer(reader);
+        if(n < 0) {
+            return read_error;
+        }
+        if(n == 0) {
+            reader->eof = 1;
+        }
+    }
+}
+
+read_result ensure_avaible(reader * reader, size_t length) {
+    while(reader->end - reader->begin < length) {
+        if(reader->eof) {
+            return end_of_input;
+        }
+
+        if(length > reader->capacity) {
+            return line_too_long;
+        }
+
+        int n = fill_buffer(reader);
+        if(n < 0) {
+            return read_error;
+        }
+        if(n == 0) {
+            reader->eof = 1;
+        }
+    }
+
+    return line_read;
+}
+
+read_result next_record(reader * reader, line * record) {
+    uint length = 0, prefix = 0;
+
+    read_result result = ensure_avaible(reader, 1);
+    while(result == line_read) {
+        size_t avaible = reader->end - reader->begin;
+        prefix = decode_varint((unsigned char *) reader->buffer + reader->begin, 
+                    avaible < VARINT_MAX_LENGTH ? avaible : VARINT_MAX_LENGTH, &length);
+
+        if(prefix > 0) {
+            break;
+        }
+        if(avaible >= VARINT_MAX_LENGTH) {
+            return read_error;
+        }
+
+        result = ensure_avaible(reader, avaible + 1);
+    }
+
+    if(result == line_read) {
+        result = ensure_avaible(reader, (size_t) prefix + length);
+    }
+
+    if(result != line_read) {
+        return result;
+    }
+
+    record->text = reader->buffer + reader->begin + prefix;
+    record->length = length;
+
+    reader->begin += prefix + length;
+    reader->scanned = reader->begin;
+
+    return line_read;
+}
+
+uint consume_prefix(reader * reader, const char * prefix, uint length) {
+    if(ensure_avaible(reader, length) != line_read || memcmp(reader->buffer + reader->begin, prefix, length) != 0) {
+        return 0;
+    }
+
+    reader->begin += length;
+    reader->scanned = reader->begin;
+
+    return 1;
+}
@@ -0,0 +1,196 @@
+#ifndef _READER_
+#define _READER_
+
+/**
+ * @headerfile reader.h
+ * @brief Interface of reader.c.
+*/
+
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+/**
+ * @enum read_result
+ * @brief Codifies the outcome of a line request.
+*/
+typedef enum {
+    line_read = 1,
+    end_of_input = 0,
+    read_error = -1,
+    line_too_long = -2
+} read_result;
+
+/**
+ * @struct line
+ * @brief View of a line stored in the buffer of a reader.
+ *
+ * @param text Pointer to the first character of the line (not null terminated).
+ * @param length Number of characters of the line, newline excluded.
+ *
+ * @note The view is valid only until the next request to the same reader.
+*/
+typedef struct line {
+    const char * text;
+    uint length;
+} line;
+
+/**
+ * @struct reader
+ * @brief Block buffered reader of a file descriptor.
+ *
+ * @param fd File descriptor to read from.
+ * @param buffer Buffer which stores the blocks read.
+ * @param capacity Capacity of the buffer (and maximum length of a line).
+ * @param begin Index of the first character not returned yet.
+ * @param scanned Index of the first character not scanned for a newline yet.
+ * @param end Index of the first free position of the buffer.
+ * @param eof 1 if the end of the file has been reached, 0 otherwise.
+ * @param mapped 1 if the buffer is a memory mapping of the whole file, 0 otherwise.
+*/
+typedef struct reader {
+    int fd;
+    char * buffer;
+    size_t capacity;
+    size_t begin;
+    size_t scanned;
+    size_t end;
+    uint eof;
+    uint mapped;
+} reader;
+
+/**
+ * @brief Create a reader on a file descriptor.
+ *
+ * @param fd File descriptor to read from.
+ * @param capacity Capacity of the buffer of the reader.
+ *
+ * @returns A pointer to the reader allocated on heap, NULL if capacity is 0 or there is not enough memory.
+*/
+reader * create_reader(int fd, uint capacity);
+
+/**
+ * @brief Create a reader which maps the whole file in memory.
+ *
+ * The file is mapped read only with mmap(2) and advised as sequentially accessed; lines are returned directly from 
+ * the mapping, so no copy is performed and their length is not limited.
+ *
+ * @param fd File descriptor of a regular file.
+ *
+ * @returns A pointer to the reader allocated on heap, NULL if fd is not a non empty regular file or the mapping fails.
+*/
+reader * create_mapped_reader(int fd);
+
+/**
+ * @brief Delete a reader.
+ *
+ * @param reader Pointer to the reader to delete.
+ *
+ * @post The reader is deallocated (and the file unmapped); the file descriptor is not closed.
+*/
+void delete_reader(reader * reader);
+
+/**
+ * @brief Retrieve the next line.
+ *
+ * Blocks of capacity bytes are read with read(2) only when the buffer does not contain a whole line; lines are
+ * located with memchr and returned without being copied.
+ *
+ * @param reader Pointer to the reader to use.
+ * @param line Pointer to the view which will reference the line.
+ *
+ * @pre reader != NULL
+ * @pre line != NULL
+ *
+ * @returns line_read if a line is available, end_of_input if the input is terminated, read_error if read(2) fails,
+ *          line_too_long if a line does not fit in the buffer.
+ *
+ * @note Characters after the last newline are ignored.
+*/
+read_result next_line(reader * reader, line * line);
+
+/**
+ * @brief Retrieve the next token of the current line.
+ *
+ * Only the token has to fit in the buffer, so a line made of many tokens can be consumed one token at a time
+ * whatever its length.
+ *
+ * @param reader Pointer to the reader to use.
+ * @param separator Character which separates the tokens of a line.
+ * @param token Pointer to the view which will reference the token (separator excluded).
+ * @param last Address where 1 is put if the token terminates the line, 0 otherwise.
+ *
+ * @pre reader != NULL
+ * @pre token != NULL
+ * @pre last != NULL
+ *
+ * @returns line_read if a token is available, end_of_input if the input terminates before the end of the token,
+ *          read_error if read(2) fails, line_too_long if a token does not fit in the buffer.
+*/
+read_result next_token(reader * reader, char separator, line * token, uint * last);
+
+/**
+ * @brief Retrieve every whole token of the current line which is in the buffer.
+ *
+ * The view ends at the newline if the rest of the line is buffered, before the last buffered separator otherwise; in
+ * both cases the character after the view is consumed. Compared with next_token, a line is consumed in a few views
+ * of many tokens, which can be decoded together.
+ *
+ * @param reader Pointer to the reader to use.
+ * @param separator Character which separates the tokens of a line.
+ * @param tokens Pointer to the view which will reference the tokens (the last separator or newline excluded).
+ * @param last Address where 1 is put if the view terminates the line, 0 otherwise.
+ *
+ * @pre reader != NULL
+ * @pre tokens != NULL
+ * @pre last != NULL
+ *
+ * @returns line_read if at least a token is available, end_of_input if the input terminates before the end of the
+ *          token, read_error if read(2) fails, line_too_long if a token does not fit in the buffer.
+*/
+read_result next_tokens(reader * reader, char separator, line * tokens, uint * last);
+
+/**
+ * @brief Make at least length bytes avaible after reader->begin, if the input contains them.
+ *
+ * @param reader Pointer to the reader to use.
+ * @param length Number of bytes requested.
+ *
+ * @pre reader != NULL
+ *
+ * @returns line_read if the bytes are avaible, end_of_input if the input terminates before, read_error if read(2)
+ *          fails, line_too_long if they do not fit in the buffer.
+*/
+read_result ensure_avaible(reader * reader, size_t length);
+
+/**
+ * @brief Retrieve the next record of a binary stream (see binary.h).
+ *
+ * @param reader Pointer to the reader to use.
+ * @param record Pointer to the view which will reference the payload of the record (length prefix excluded).
+ *
+ * @pre reader != NULL
+ * @pre record != NULL
+ *
+ * @returns line_read if a record is available, end_of_input if the input is terminated, read_error if read(2) fails
+ *          or the length prefix is malformed, line_too_long if a record does not fit in the buffer.
+ *
+ * @note A truncated record at the end of the input is ignored.
+*/
+read_result next_record(reader * reader, line * record);
+
+/**
+ * @brief Consume a prefix if the input starts with it.
+ *
+ * @param reader Pointer to the reader to use, at the start of a line or record.
+ * @param prefix Pointer to the expected bytes.
+ * @param length Number of bytes of the prefix.
+ *
+ * @pre reader != NULL
+ * @pre length <= reader->capacity
+ *
+ * @returns 1 if the input starts with prefix (which is consumed), 0 otherwise (nothing is consumed).
+*/
+uint consume_prefix(reader * reader, const char * prefix, uint length);
+
+#endif
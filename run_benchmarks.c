@@ -0,0 +1,157 @@
+#include "benchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+const char test_directory[] = {"test/"};
+const char test_prefix[] = {"open_"};
+const char test_extension[] = {".txt"};
+
+const unsigned int N_TEST = 111;
+const unsigned int TEST_OFFSET = 1;
+
+typedef void (* file_benchmark)(const char * path);
+
+void run_on_files(file_benchmark benchmark, int argc, char * argv[]) {
+    if(argc > 0) {
+        for(int i = 0; i < argc; ++i) {
+            benchmark(argv[i]);
+        }
+
+        return;
+    }
+
+    char path[100];
+    for(unsigned int i = 0; i < N_TEST; ++i) {
+        sprintf(path, "%s%s%u%s", test_directory, test_prefix, i + TEST_OFFSET, test_extension);
+        if(access(path, R_OK) == 0) {
+            benchmark(path);
+        }
+    }
+}
+
+typedef void (* stations_benchmark)(unsigned int stations);
+
+void run_on_stations(stations_benchmark benchmark, int argc, char * argv[]) {
+    if(argc > 0) {
+        for(int i = 0; i < argc; ++i) {
+            benchmark(atoi(argv[i]));
+        }
+
+        return;
+    }
+
+    for(unsigned int stations = 100000; stations <= 10000000; stations *= 10) {
+        benchmark(stations);
+    }
+}
+
+int main(int argc, char * argv[]) {
+
+    if(argc < 2) {
+        printf("Usage: %s benchmark [file ...]\n", argv[0]);
+        printf("Benchmarks: reader, parse, numbers, encoding, executor, server, snapshot, journal, batch, churn, layout, plan, cars, memory, search, lookup, demolition, load, forward\n");
+        printf("Without files, the tests in %s are used (numbers uses a generated line)\n", test_directory);
+        printf("churn, layout, memory, lookup, demolition and load take numbers of stations instead of files (100000, 1000000 and 10000000 by default)\n");
+        printf("plan takes numbers of stations from start to end of the plans instead of files (100, 1000 and 10000 by default)\n");
+        printf("cars takes numbers of cars of the station instead of files (10000, 100000 and 1000000 by default)\n");
+        printf("search takes numbers of stations instead of files (powers of 10 from 1000 to 100000000 by default)\n");
+        printf("forward takes numbers of stations instead of files (powers of 10 from 1000 to 1000000 by default)\n");
+
+        return 1;
+    }
+
+    if(strcmp(argv[1], "reader") == 0) {
+        run_on_files(benchmark_reader, argc - 2, argv + 2);
+    }
+    else if(strcmp(argv[1], "parse") == 0) {
+        run_on_files(benchmark_parse, argc - 2, argv + 2);
+    }
+    else if(strcmp(argv[1], "numbers") == 0) {
+        benchmark_numbers();
+    }
+    else if(strcmp(argv[1], "encoding") == 0) {
+        run_on_files(benchmark_encoding, argc - 2, argv + 2);
+    }
+    else if(strcmp(argv[1], "executor") == 0) {
+        run_on_files(benchmark_executor, argc - 2, argv + 2);
+    }
+    else if(strcmp(argv[1], "server") == 0) {
+        run_on_files(benchmark_server, argc - 2, argv + 2);
+    }
+    else if(strcmp(argv[1], "snapshot") == 0) {
+        run_on_files(benchmark_snapshot, argc - 2, argv + 2);
+    }
+    else if(strcmp(argv[1], "journal") == 0) {
+        run_on_files(benchmark_journal, argc - 2, argv + 2);
+    }
+    else if(strcmp(argv[1], "batch") == 0) {
+        run_on_files(benchmark_batch, argc - 2, argv + 2);
+    }
+    else if(strcmp(argv[1], "churn") == 0) {
+        run_on_stations(benchmark_churn, argc - 2, argv + 2);
+    }
+    else if(strcmp(argv[1], "layout") == 0) {
+        run_on_stations(benchmark_layout, argc - 2, argv + 2);
+    }
+    else if(strcmp(argv[1], "memory") == 0) {
+        run_on_stations(benchmark_memory, argc - 2, argv + 2);
+    }
+    else if(strcmp(argv[1], "lookup") == 0) {
+        run_on_stations(benchmark_lookup, argc - 2, argv + 2);
+    }
+    else if(strcmp(argv[1], "demolition") == 0) {
+        run_on_stations(benchmark_demolition, argc - 2, argv + 2);
+    }
+    else if(strcmp(argv[1], "load") == 0) {
+        run_on_stations(benchmark_load, argc - 2, argv + 2);
+    }
+    else if(strcmp(argv[1], "search") == 0) {
+        if(argc > 2) {
+            run_on_stations(benchmark_search, argc - 2, argv + 2);
+        }
+        else {
+            for(unsigned int stations = 1000; stations <= 100000000; stations *= 10) {
+                benchmark_search(stations);
+            }
+        }
+    }
+    else if(strcmp(argv[1], "cars") == 0) {
+        if(argc > 2) {
+            run_on_stations(benchmark_cars, argc - 2, argv + 2);
+        }
+        else {
+            for(unsigned int cars = 10000; cars <= 1000000; cars *= 10) {
+                benchmark_cars(cars);
+            }
+        }
+    }
+    else if(strcmp(argv[1], "forward") == 0) {
+        if(argc > 2) {
+            run_on_stations(benchmark_forward, argc - 2, argv + 2);
+        }
+        else {
+            for(unsigned int stations = 1000; stations <= 1000000; stations *= 10) {
+                benchmark_forward(stations);
+            }
+        }
+    }
+    else if(strcmp(argv[1], "plan") == 0) {
+        if(argc > 2) {
+            run_on_stations(benchmark_plan, argc - 2, argv + 2);
+        }
+        else {
+            for(unsigned int length = 100; length <= 10000; length *= 10) {
+                benchmark_plan(length);
+            }
+        }
+    }
+    else {
+        printf("Unknown benchmark %s\n", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file search.c
+ * @brief Search distances in ordered arrays and in Eytzinger indexes.
+*/
+
+#include "search.h"
+#include <stdlib.h>
+
+#define NDEBUG
+
+#ifndef NDEBUG
+#include <stdio.h>
+#endif
+
+/**
+ * Bytes of a cache line: the keys of an Eytzinger index are aligned to it.
+*/
+#define CACHE_LINE 64
+
+/**
+ * Keys in a cache line, which are the descendants of an element four levels down in an Eytzinger index.
+*/
+#define LINE_KEYS (CACHE_LINE / sizeof(matrix_size))
+
+matrix_size lower_bound(const matrix_size * keys, matrix_size length, matrix_size target) {
+    if(length == 0) {
+        return 0;
+    }
+
+    const matrix_size * base = keys;
+    matrix_size n = length;
+
+    while(n > 1) {
+        matrix_size half = n / 2;
+
+        // Both the ranges which may follow are prefetched, as which one is taken is known only after the comparison
+        __builtin_prefetch(base + half / 2);
+        __builtin_prefetch(base + half + half / 2);
+
+        base += (base[half] < target) * half;
+        n -= half;
+    }
+
+    return (base - keys) + (*base < target);
+}
+
+matrix_size upper_bound(const matrix_size * keys, matrix_size length, matrix_size target) {
+    if(length == 0) {
+        return 0;
+    }
+
+    const matrix_size * base = keys;
+    matrix_size n = length;
+
+    while(n > 1) {
+        matrix_size half = n / 2;
+
+        __builtin_prefetch(base + half / 2);
+        __builtin_prefetch(base + half + half / 2);
+
+        base += (base[half] <= target) * half;
+        n -= half;
+    }
+
+    return (base - keys) + (*base <= target);
+}
+
+/**
+ * @brief Put the keys from position i in the subtree of the element k of an Eytzinger index, following the in order
+ * visit of the subtree.
+ *
+ * @returns The position of the first key not put.
+*/
+matrix_size fill_eytzinger(eytzinger_index * index, const matrix_size * keys, matrix_size i, matrix_size k) {
+    if(k <= index->length) {
+        i = fill_eytzinger(index, keys, i, 2 * k);
+        index->keys[k] = keys[i];
+        index->ranks[k] = i++;
+        i = fill_eytzinger(index, keys, i, 2 * k + 1);
+    }
+
+    return i;
+}
+
+eytzinger_index * create_eytzinger_index(const matrix_size * keys, matrix_size length) {
+    eytzinger_index * index = (eytzinger_index *) malloc(sizeof(eytzinger_index));
+    if(index == NULL) {
+        return NULL;
+    }
+
+    // aligned_alloc needs a size multiple of the alignment
+    size_t bytes = ((sizeof(matrix_size) * (length + 1) + CACHE_LINE - 1) / CACHE_LINE) * CACHE_LINE;
+
+    index->keys = (matrix_size *) aligned_alloc(CACHE_LINE, bytes);
+    index->ranks = (matrix_size *) malloc(sizeof(matrix_size) * (length + 1));
+    index->length = length;
+
+    if(index->keys == NULL || index->ranks == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough memory to allocate Eytzinger index of %d keys\n", length);
+        #endif
+
+        delete_eytzinger_index(index);
+        return NULL;
+    }
+
+    fill_eytzinger(index, keys, 0, 1);
+
+    return index;
+}
+
+void delete_eytzinger_index(eytzinger_index * index) {
+    if(index != NULL) {
+        free(index->keys);
+        free(index->ranks);
+        free(index);
+    }
+}
+
+matrix_size eytzinger_lower_bound(const eytzinger_index * index, matrix_size target) {
+    const matrix_size * keys = index->keys;
+    matrix_size k = 1;
+
+    while(k <= index->length) {
+        // The 16 descendants of k four levels down share a cache line (a prefetch past the keys is harmless)
+        __builtin_prefetch(keys + LINE_KEYS * k);
+        k = 2 * k + (keys[k] < target);
+    }
+
+    // The last step to the right is undone: k becomes the last element where the search went left
+    k >>= __builtin_ffs(~k);
+
+    return k == 0 ? index->length : index->ranks[k];
+}
@@ -0,0 +1,86 @@
+#ifndef _SEARCH_
+#define _SEARCH_
+
+/**
+ * @headerfile search.h
+ * @brief Interface of search.c
+ *
+ * Searches on arrays of distances increasingly ordered. lower_bound and upper_bound halve the range without branches:
+ * the comparison only selects the offset of the next range, so the loop takes the same log2(n) steps for every
+ * target and nothing is mispredicted.
+ *
+ * An eytzinger_index stores a copy of the distances in Eytzinger (breadth first) order, where the children of the
+ * element k are 2k and 2k + 1: the elements of the first levels share few cache lines, and the descendants four levels
+ * down are contiguous, so they are prefetched while the search goes down. The index is built in O(n), and reading the
+ * position of the key found costs one more access (to ranks): it is worth only for many searches on distances which
+ * do not change and are much larger than the cache (see the search benchmark).
+*/
+
+#include "solver.h"
+
+/**
+ * @struct eytzinger_index
+ * @brief Distances in Eytzinger order.
+ *
+ * @param keys Distances in Eytzinger order, from keys[1] (the root).
+ * @param ranks Position in the ordered array of every element of keys.
+ * @param length Number of distances.
+*/
+typedef struct eytzinger_index {
+    matrix_size * keys;
+    matrix_size * ranks;
+    matrix_size length;
+} eytzinger_index;
+
+/**
+ * @brief Find the first key not less than target.
+ *
+ * @param keys Keys increasingly ordered.
+ * @param length Number of keys.
+ * @param target Key to search.
+ *
+ * @returns The index of the key, length if every key is less than target.
+ *
+ * @note T(n) = O(log(n)), without branches on the keys.
+*/
+matrix_size lower_bound(const matrix_size * keys, matrix_size length, matrix_size target);
+
+/**
+ * @brief Find the first key greater than target.
+ *
+ * @returns The index of the key, length if no key is greater than target (see lower_bound).
+*/
+matrix_size upper_bound(const matrix_size * keys, matrix_size length, matrix_size target);
+
+/**
+ * @brief Create the Eytzinger index of an array of keys.
+ *
+ * @param keys Keys increasingly ordered.
+ * @param length Number of keys.
+ *
+ * @returns A pointer to the index allocated on heap, NULL if there is not enough memory.
+ *
+ * @note T(n) = O(n).
+*/
+eytzinger_index * create_eytzinger_index(const matrix_size * keys, matrix_size length);
+
+/**
+ * @brief Delete an Eytzinger index.
+ *
+ * @param index Pointer to the index to delete.
+*/
+void delete_eytzinger_index(eytzinger_index * index);
+
+/**
+ * @brief Find the first key not less than target in an Eytzinger index.
+ *
+ * @param index Pointer to the index to use.
+ * @param target Key to search.
+ *
+ * @pre index != NULL
+ *
+ * @returns The index of the key in the ordered array, length if every key is less than target (as lower_bound).
+*/
+matrix_size eytzinger_lower_bound(const eytzinger_index * index, matrix_size target);
+
+#endif
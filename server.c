@@ -0,0 +1,354 @@
+/**
+ * @file server.c
+ * @brief Serve commands of many local clients on a resident highway.
+ *
+ * A single thread multiplexes the listening socket and the clients with epoll(7): when a client is readable, every
+ * whole command it has sent is executed and the replies are flushed together, while an incomplete command stays in
+ * the reader of the connection until the rest arrives (the parameters of an aggiungi-stazione or importa-stazioni
+ * command, which is decoded as it arrives, stay in the arena of the connection instead).
+ *
+ * The loop never waits for a client: the replies a client does not read yet stay in the queue of its connection,
+ * which is watched for EPOLLOUT until it is written, and the commands of a client whose queue is longer than
+ * CONNECTION_MAX_QUEUE are not read until it shrinks.
+ *
+ * When no client is ready and the highway is sparse (see sparse_highway), the loop compacts it before waiting:
+ * removals stay cheap while the clients are busy, and the arrays are dense again when they are idle. The few
+ * tombstones which add_station spreads between the stations are kept, since they make the next insertions cheap.
+*/
+
+#define _GNU_SOURCE
+
+#include "server.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define NDEBUG
+
+#ifndef NDEBUG
+#include <stdio.h>
+#endif
+
+#define LISTEN_BACKLOG 128
+
+volatile sig_atomic_t stop_server = 0;
+
+void request_stop(int signal) {
+    (void) signal;
+    stop_server = 1;
+}
+
+/**
+ * @brief Unregister a client, remove it from the open connections and delete it.
+*/
+void close_client(int epoll, connection ** clients, connection * client) {
+    epoll_ctl(epoll, EPOLL_CTL_DEL, client->fd, NULL);
+
+    if(client->previous != NULL) {
+        client->previous->next = client->next;
+    }
+    else {
+        *clients = client->next;
+    }
+    if(client->next != NULL) {
+        client->next->previous = client->previous;
+    }
+
+    delete_connection(client);
+}
+
+connection * create_connection(int fd) {
+    #ifndef NDEBUG
+    printf("Starting connection creation\n");
+    #endif
+
+    connection * new_connection = (connection *) malloc(sizeof(connection));
+    if(new_connection == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough space to allocate connection of %ld bytes\n", sizeof(connection));
+        #endif
+
+        return NULL;
+    }
+
+    new_connection->fd = fd;
+    new_connection->previous = NULL;
+    new_connection->next = NULL;
+    new_connection->input = create_reader(fd, CONNECTION_BUFFER_CAPACITY);
+    new_connection->output = create_queued_writer(fd, CONNECTION_BUFFER_CAPACITY);
+    new_connection->arena = create_parse_arena(STD_ARENA_CAPACITY);
+    new_connection->streamed.command = no_command;
+    new_connection->finished = 0;
+    new_connection->events = 0;
+
+    if(new_connection->input == NULL || new_connection->output == NULL || new_connection->arena == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough space to allocate connection buffers\n");
+        #endif
+
+        delete_reader(new_connection->input);
+        delete_writer(new_connection->output);
+        delete_parse_arena(new_connection->arena);
+        free(new_connection);
+
+        return NULL;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    #ifndef NDEBUG
+    printf("Ending connection creation\n");
+    #endif
+
+    return new_connection;
+}
+
+void delete_connection(connection * connection) {
+    if(connection != NULL) {
+        delete_reader(connection->input);
+        delete_writer(connection->output);
+        delete_parse_arena(connection->arena);
+        close(connection->fd);
+        free(connection);
+    }
+}
+
+uint serve_connection(executor * executor, connection * connection) {
+    instruction instruction;
+    read_result read = line_read;
+
+    // The replies queued by the previous calls go first, so a full queue may shrink enough to read more commands
+    if(!flush_writer(connection->output)) {
+        return 0;
+    }
+
+    executor->output = connection->output;
+
+    while(!connection->finished && connection->output->length < CONNECTION_MAX_QUEUE && 
+        (read = next_text_instruction(connection->input, connection->arena, &connection->streamed, 
+                &instruction)) == line_read) {
+        execute_command(executor, &instruction);
+    }
+
+    uint pending = read == line_read || (read == read_error && (errno == EAGAIN || errno == EWOULDBLOCK));
+
+    #ifndef NDEBUG
+    printf("\tConnection %d: read result %d, pending %d\n", connection->fd, read, pending);
+    #endif
+
+    if(read == line_too_long) {
+        write_literal(connection->output, "Command syntax error\n");
+    }
+    if(!pending) {
+        connection->finished = 1;
+    }
+
+    return flush_writer(connection->output) && (!connection->finished || connection->output->length > 0);
+}
+
+/**
+ * @brief Register in the epoll instance the events a connection waits for, if they changed.
+ *
+ * A connection waits for its commands until it is finished or its queue is full, and for the socket to be writable
+ * while its queue is not empty.
+ *
+ * @returns 1 if the events are registered, 0 if epoll_ctl(2) fails.
+*/
+uint watch_connection(int epoll, connection * connection) {
+    uint events = connection->output->length > 0 ? EPOLLOUT : 0;
+    if(!connection->finished && connection->output->length < CONNECTION_MAX_QUEUE) {
+        events |= EPOLLIN | EPOLLRDHUP;
+    }
+
+    if(events == connection->events) {
+        return 1;
+    }
+
+    struct epoll_event event = {events, {.ptr = connection}};
+    if(epoll_ctl(epoll, EPOLL_CTL_MOD, connection->fd, &event) != 0) {
+        return 0;
+    }
+    connection->events = events;
+
+    return 1;
+}
+
+/**
+ * @brief Create a listening Unix domain socket bound to a path.
+ *
+ * @returns The socket, -1 on error.
+*/
+int create_listener(const char * socket_path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if(strlen(socket_path) >= sizeof(address.sun_path)) {
+        #ifndef NDEBUG
+        printf("\tSocket path longer than %ld characters\n", sizeof(address.sun_path) - 1);
+        #endif
+
+        return -1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(listener < 0) {
+        return -1;
+    }
+
+    unlink(socket_path);
+
+    if(bind(listener, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(listener, LISTEN_BACKLOG) != 0) {
+        #ifndef NDEBUG
+        printf("\tUnable to listen on %s\n", socket_path);
+        #endif
+
+        close(listener);
+        return -1;
+    }
+
+    return listener;
+}
+
+/**
+ * @brief Accept every pending client, register it in the epoll instance and put it at the head of the open connections.
+*/
+void accept_clients(int epoll, int listener, connection ** clients) {
+    int client = -1;
+
+    while((client = accept4(listener, NULL, NULL, SOCK_CLOEXEC)) >= 0) {
+        connection * new_connection = create_connection(client);
+        if(new_connection == NULL) {
+            close(client);
+            continue;
+        }
+
+        struct epoll_event event = {EPOLLIN | EPOLLRDHUP, {.ptr = new_connection}};
+        if(epoll_ctl(epoll, EPOLL_CTL_ADD, client, &event) != 0) {
+            delete_connection(new_connection);
+            continue;
+        }
+        new_connection->events = event.events;
+
+        new_connection->next = *clients;
+        if(*clients != NULL) {
+            (*clients)->previous = new_connection;
+        }
+        *clients = new_connection;
+
+        #ifndef NDEBUG
+        printf("\tAccepted client %d\n", client);
+        #endif
+    }
+}
+
+uint run_server(executor * executor, const char * socket_path) {
+    #ifndef NDEBUG
+    printf("Starting server on %s\n", socket_path);
+    #endif
+
+    int listener = create_listener(socket_path);
+    if(listener < 0) {
+        return 0;
+    }
+
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event event = {EPOLLIN, {.ptr = NULL}};
+
+    if(epoll < 0 || epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event) != 0) {
+        #ifndef NDEBUG
+        printf("\tUnable to create epoll instance\n");
+        #endif
+
+        if(epoll >= 0) {
+            close(epoll);
+        }
+        close(listener);
+        unlink(socket_path);
+
+        return 0;
+    }
+
+    // The stop signals are delivered only inside epoll_pwait, so a signal cannot be lost between the check and the wait
+    sigset_t stop_signals, original_mask;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &stop_signals, &original_mask);
+
+    struct sigaction stop;
+    memset(&stop, 0, sizeof(stop));
+    stop.sa_handler = request_stop;
+    sigemptyset(&stop.sa_mask);
+    sigaction(SIGINT, &stop, NULL);
+    sigaction(SIGTERM, &stop, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    writer * output = executor->output;
+    connection * clients = NULL;
+    struct epoll_event events[MAX_EVENTS];
+    uint result = 1;
+
+    stop_server = 0;
+
+    while(!stop_server) {
+        int timeout = executor->journal != NULL ? journal_tick(executor->journal) : -1;
+        if(sparse_highway(executor->highway)) {
+            timeout = 0;
+        }
+
+        int n = epoll_pwait(epoll, events, MAX_EVENTS, timeout, &original_mask);
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            result = 0;
+            break;
+        }
+
+        if(n == 0 && sparse_highway(executor->highway)) {
+            compact_highway(executor->highway);
+            continue;
+        }
+
+        for(int i = 0; i < n; ++i) {
+            connection * client = (connection *) events[i].data.ptr;
+
+            if(client == NULL) {
+                accept_clients(epoll, listener, &clients);
+            }
+            else if(serve_connection(executor, client) == 0 || watch_connection(epoll, client) == 0) {
+                #ifndef NDEBUG
+                printf("\tClosing client %d\n", client->fd);
+                #endif
+
+                close_client(epoll, &clients, client);
+            }
+        }
+    }
+
+    while(clients != NULL) {
+        close_client(epoll, &clients, clients);
+    }
+
+    executor->output = output;
+    sigprocmask(SIG_SETMASK, &original_mask, NULL);
+
+    close(epoll);
+    close(listener);
+    unlink(socket_path);
+
+    #ifndef NDEBUG
+    printf("Ending server\n");
+    #endif
+
+    return result;
+}
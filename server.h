@@ -0,0 +1,110 @@
+#ifndef _SERVER_
+#define _SERVER_
+
+/**
+ * @headerfile server.h
+ * @brief Interface of server.c
+*/
+
+#include "executor.h"
+
+/**
+ * Maximum number of events returned by a single epoll_wait(2).
+*/
+#define MAX_EVENTS 64
+
+/**
+ * Capacity of the input and output buffers of every connection.
+*/
+#define CONNECTION_BUFFER_CAPACITY (1 << 16)
+
+/**
+ * Number of bytes of replies queued for a client above which its commands are not read until the client reads them.
+*/
+#define CONNECTION_MAX_QUEUE (1 << 20)
+
+/**
+ * @struct connection
+ * @brief Stores the state of a client connection.
+ * 
+ * @param fd Non blocking socket of the client.
+ * @param input Pointer to the reader of the commands of the client.
+ * @param output Pointer to the queued writer of the replies to the client (see create_queued_writer).
+ * @param arena Pointer to the arena which stores the parameters of the commands of the client.
+ * @param streamed Progress of the command of the client whose parameters are being decoded.
+ * @param finished 1 if no more commands are read from the client (it closed its side or sent a malformed command).
+ * @param events Events the socket is registered for in the epoll instance of the server.
+ * @param previous Pointer to the previous open connection of the server.
+ * @param next Pointer to the next open connection of the server.
+*/
+typedef struct connection {
+    int fd;
+    reader * input;
+    writer * output;
+    parse_arena * arena;
+    streamed_command streamed;
+    uint finished;
+    uint events;
+    struct connection * previous;
+    struct connection * next;
+} connection;
+
+/**
+ * @brief Create a connection on a socket.
+ * 
+ * @param fd Socket of the client, which is made non blocking.
+ * 
+ * @returns A pointer to the connection allocated on heap, NULL if there is not enough memory.
+*/
+connection * create_connection(int fd);
+
+/**
+ * @brief Delete a connection.
+ * 
+ * @param connection Pointer to the connection to delete.
+ * 
+ * @post The pending replies are written as far as the socket accepts them, the buffers are deallocated and the socket 
+ *       is closed.
+*/
+void delete_connection(connection * connection);
+
+/**
+ * @brief Write the queued replies of a connection and execute every whole command received on it.
+ * 
+ * Commands are read until the socket has no more data or the queue of the replies is longer than 
+ * CONNECTION_MAX_QUEUE, so a client can send many commands without waiting for the replies (which are written in 
+ * order, flushed once per call). The socket is never waited for: the replies it does not accept stay queued.
+ * 
+ * @param executor Pointer to the executor which owns the highway.
+ * @param connection Pointer to the connection to serve.
+ * 
+ * @pre executor != NULL
+ * @pre connection != NULL
+ * 
+ * @returns 1 if the connection has to be kept open, 0 if an error occurred or the client closed it and every reply 
+ *          has been written.
+ * 
+ * @note executor->output is replaced with the writer of the connection.
+*/
+uint serve_connection(executor * executor, connection * connection);
+
+/**
+ * @brief Serve text commands on a Unix domain socket until SIGINT or SIGTERM is received.
+ * 
+ * Every client works on the same highway, which stays in memory between connections; the sockets are multiplexed 
+ * with epoll(7) on the calling thread, so commands of different clients are executed one at a time. If the executor
+ * has a journal with a time trigger, the wait is bounded so the pending records are synchronized in time.
+ * 
+ * @param executor Pointer to the executor which owns the highway.
+ * @param socket_path Path of the socket to create (an existing file at that path is replaced).
+ * 
+ * @pre executor != NULL
+ * @pre socket_path != NULL
+ * 
+ * @returns 1 if the server is terminated by a signal, 0 if the socket cannot be created or epoll fails.
+ * 
+ * @post Every open connection is closed and the socket file is removed.
+*/
+uint run_server(executor * executor, const char * socket_path);
+
+#endif
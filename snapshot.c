@@ -0,0 +1,258 @@
+/**
+ * @file snapshot.c
+ * @brief Save and restore the content of an highway.
+*/
+
+#include "snapshot.h"
+#include "station_hash.h"
+#include "writer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define NDEBUG
+
+#define SNAPSHOT_BUFFER_CAPACITY (1 << 16)
+#define STD_HIGHWAY_CAPACITY 256
+
+uint64_t update_checksum(uint64_t checksum, const uint32_t * words, size_t length) {
+    uint32_t low = (uint32_t) checksum;
+    uint32_t high = (uint32_t) (checksum >> 32);
+
+    for(size_t i = 0; i < length; ++i) {
+        low += words[i];
+        high += low;
+    }
+
+    return ((uint64_t) high << 32) | low;
+}
+
+/**
+ * @brief Write length 32 bit words and add them to the checksum.
+*/
+void write_words(writer * output, const void * words, size_t length, uint64_t * checksum) {
+    *checksum = update_checksum(*checksum, (const uint32_t *) words, length);
+    write_text(output, (const char *) words, length * sizeof(uint32_t));
+}
+
+snapshot_result save_snapshot(const highway * highway, const char * path, uint32_t journal_generation) {
+    #ifndef NDEBUG
+    printf("Starting snapshot of %d stations in %s\n", highway->length, path);
+    #endif
+
+    char * temporary_path = (char *) malloc(strlen(path) + 5);
+    if(temporary_path == NULL) {
+        return snapshot_io_error;
+    }
+    sprintf(temporary_path, "%s.tmp", path);
+
+    int fd = open(temporary_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    writer * output = fd < 0 ? NULL : create_writer(fd, SNAPSHOT_BUFFER_CAPACITY);
+    if(output == NULL) {
+        #ifndef NDEBUG
+        printf("\tUnable to create %s\n", temporary_path);
+        #endif
+
+        if(fd >= 0) {
+            close(fd);
+            unlink(temporary_path);
+        }
+        free(temporary_path);
+
+        return snapshot_io_error;
+    }
+
+    snapshot_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LENGTH);
+    header.version = SNAPSHOT_VERSION;
+    header.stations = highway->length - highway->tombstones;
+    header.journal_generation = journal_generation;
+
+    // The header is rewritten at the end, when the checksum is known
+    write_text(output, (const char *) &header, sizeof(header));
+
+    uint64_t checksum = 0;
+
+    // Tombstones are not saved
+    uint64_t offset = 0, cars = 0;
+    for(matrix_size i = 0; i < highway->length; ++i) {
+        if(highway->stations[i] != NULL) {
+            write_words(output, &offset, 2, &checksum);
+            offset += highway->stations[i]->n_runs;
+            cars += highway->stations[i]->length;
+        }
+    }
+    write_words(output, &offset, 2, &checksum);
+
+    // The distances are written a sequence of stations at a time
+    for(matrix_size i = 0, j; i < highway->length; i = j + 1) {
+        for(j = i; j < highway->length && highway->stations[j] != NULL; ++j);
+        write_words(output, highway->distance + i, j - i, &checksum);
+    }
+
+    for(matrix_size i = 0; i < highway->length; ++i) {
+        const station * current = highway->stations[i];
+        if(current != NULL) {
+            write_words(output, current->runs, current->n_runs * 2, &checksum);
+        }
+    }
+
+    header.cars = cars;
+    header.runs = offset;
+    header.checksum = checksum;
+
+    uint result = flush_writer(output) && !output->error;
+    result = result && pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+    result = result && fsync(fd) == 0;
+
+    delete_writer(output);
+    result = close(fd) == 0 && result;
+    result = result && rename(temporary_path, path) == 0;
+
+    if(!result) {
+        unlink(temporary_path);
+    }
+    free(temporary_path);
+
+    #ifndef NDEBUG
+    printf("Ending snapshot (result %d)\n", result);
+    #endif
+
+    return result ? snapshot_done : snapshot_io_error;
+}
+
+/**
+ * @brief Create the highway described by the validated arrays of a snapshot.
+ *
+ * @returns A pointer to the highway, NULL if there is not enough memory.
+*/
+highway * restore_highway(uint32_t stations, const uint32_t * distances, const uint64_t * offsets,
+                    const fuel_run * runs) {
+    highway * restored = create_highway(stations > STD_HIGHWAY_CAPACITY ? stations : STD_HIGHWAY_CAPACITY);
+    if(restored == NULL) {
+        return NULL;
+    }
+
+    for(uint32_t i = 0; i < stations; ++i) {
+        matrix_size n_runs = offsets[i + 1] - offsets[i];
+
+        station * new_station = create_pooled_station(restored, distances[i], n_runs);
+        if(new_station == NULL || !hash_insert(restored->lookup, new_station)) {
+            delete_station(new_station);
+            delete_highway(restored);
+            return NULL;
+        }
+
+        memcpy(new_station->runs, runs + offsets[i], n_runs * sizeof(fuel_run));
+        new_station->n_runs = n_runs;
+        for(matrix_size r = 0; r < n_runs; ++r) {
+            new_station->length += runs[offsets[i] + r].count;
+        }
+        new_station->car_max_fuel = n_runs > 0 ? runs[offsets[i] + n_runs - 1].fuel : 0;
+
+        restored->distance[restored->length] = distances[i];
+        restored->max_fuel[restored->length] = new_station->car_max_fuel;
+        new_station->slot = restored->length;
+        restored->stations[restored->length++] = new_station;
+    }
+
+    return restored;
+}
+
+snapshot_result load_snapshot(const char * path, highway ** highway, uint32_t * journal_generation) {
+    #ifndef NDEBUG
+    printf("Starting restore of %s\n", path);
+    #endif
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        return errno == ENOENT ? snapshot_not_found : snapshot_io_error;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0) {
+        close(fd);
+        return snapshot_io_error;
+    }
+    if(info.st_size < (off_t) sizeof(snapshot_header)) {
+        close(fd);
+        return snapshot_malformed;
+    }
+
+    char * mapping = (char *) mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED) {
+        return snapshot_io_error;
+    }
+    madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+
+    const snapshot_header * header = (const snapshot_header *) mapping;
+    uint64_t stations = header->stations;
+    uint64_t body = (stations + 1) * sizeof(uint64_t) + stations * sizeof(uint32_t) + header->runs * sizeof(fuel_run);
+
+    snapshot_result result = snapshot_done;
+
+    if(memcmp(header->magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LENGTH) != 0 || header->version != SNAPSHOT_VERSION ||
+        header->cars > UINT32_MAX || header->runs > header->cars ||
+        (uint64_t) info.st_size - sizeof(snapshot_header) != body) {
+        result = snapshot_malformed;
+    }
+    else if(update_checksum(0, (const uint32_t *) (mapping + sizeof(snapshot_header)), body / sizeof(uint32_t))
+        != header->checksum) {
+        result = snapshot_corrupted;
+    }
+
+    const uint64_t * offsets = (const uint64_t *) (mapping + sizeof(snapshot_header));
+    const uint32_t * distances = (const uint32_t *) (offsets + stations + 1);
+    const fuel_run * runs = (const fuel_run *) (distances + stations);
+
+    if(result == snapshot_done && (offsets[0] != 0 || offsets[stations] != header->runs)) {
+        result = snapshot_malformed;
+    }
+    for(uint64_t i = 0; result == snapshot_done && i < stations; ++i) {
+        if(offsets[i] > offsets[i + 1] || (i > 0 && distances[i - 1] >= distances[i])) {
+            result = snapshot_malformed;
+        }
+    }
+
+    // Runs are copied as they are, so they must be valid runs: increasing fuels and no empty run
+    uint64_t cars = 0;
+    for(uint64_t i = 0; result == snapshot_done && i < stations; ++i) {
+        for(uint64_t r = offsets[i]; result == snapshot_done && r < offsets[i + 1]; ++r) {
+            if(runs[r].count == 0 || (r > offsets[i] && runs[r - 1].fuel >= runs[r].fuel)) {
+                result = snapshot_malformed;
+            }
+            cars += runs[r].count;
+        }
+    }
+    if(result == snapshot_done && cars != header->cars) {
+        result = snapshot_malformed;
+    }
+
+    if(result == snapshot_done) {
+        struct highway * restored = restore_highway(stations, distances, offsets, runs);
+        if(restored != NULL) {
+            *highway = restored;
+            if(journal_generation != NULL) {
+                *journal_generation = header->journal_generation;
+            }
+        }
+        else {
+            result = snapshot_io_error;
+        }
+    }
+
+    munmap(mapping, info.st_size);
+
+    #ifndef NDEBUG
+    printf("Ending restore (result %d)\n", result);
+    #endif
+
+    return result;
+}
@@ -0,0 +1,117 @@
+#ifndef _SNAPSHOT_
+#define _SNAPSHOT_
+
+/**
+ * @headerfile snapshot.h
+ * @brief Interface of snapshot.c
+ *
+ * A snapshot is a snapshot_header followed by three arrays, each naturally aligned and in native byte order:
+ *  - the offsets of the runs of every station in the runs array (uint64, stations + 1 entries, the last is runs);
+ *  - the distances of the stations (uint32, increasing);
+ *  - the runs of all the stations, as in station->runs (a uint32 fuel and a uint32 count, by increasing fuel).
+ *
+ * The checksum covers everything after the header, so a truncated or corrupted file is refused.
+*/
+
+#include "station_handler.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Bytes which start a snapshot.
+*/
+#define SNAPSHOT_MAGIC "HWS\0"
+#define SNAPSHOT_MAGIC_LENGTH 4
+
+/**
+ * Version of the layout written by save_snapshot.
+*/
+#define SNAPSHOT_VERSION 2
+
+/**
+ * @struct snapshot_header
+ * @brief Header of a snapshot file.
+ *
+ * @param magic SNAPSHOT_MAGIC.
+ * @param version Version of the layout.
+ * @param stations Number of stations.
+ * @param journal_generation Generation of the journal which continues the snapshot (0 if there is no journal).
+ * @param cars Total number of cars.
+ * @param runs Total number of runs.
+ * @param checksum Checksum of the bytes after the header.
+*/
+typedef struct snapshot_header {
+    char magic[SNAPSHOT_MAGIC_LENGTH];
+    uint32_t version;
+    uint32_t stations;
+    uint32_t journal_generation;
+    uint64_t cars;
+    uint64_t runs;
+    uint64_t checksum;
+} snapshot_header;
+
+/**
+ * @enum snapshot_result
+ * @brief Codifies the outcome of a snapshot operation.
+*/
+typedef enum {
+    snapshot_done = 1,
+    snapshot_not_found = 0,
+    snapshot_io_error = -1,
+    snapshot_malformed = -2,
+    snapshot_corrupted = -3
+} snapshot_result;
+
+/**
+ * @brief Compute the checksum of an array of 32 bit words.
+ *
+ * Two running sums of the words are kept in the two halves of the result, so the checksum can be updated block by
+ * block.
+ *
+ * @param checksum Checksum of the previous blocks (0 for the first one).
+ * @param words Pointer to the words of the block.
+ * @param length Number of words of the block.
+ *
+ * @returns The checksum of the previous blocks followed by this one.
+*/
+uint64_t update_checksum(uint64_t checksum, const uint32_t * words, size_t length);
+
+/**
+ * @brief Write the content of an highway in a snapshot file.
+ *
+ * The snapshot is written in a temporary file, synchronized with fsync(2) and renamed over path, so an existing
+ * snapshot is replaced only by a complete one.
+ *
+ * @param highway Pointer to the highway to save.
+ * @param path Path of the snapshot.
+ * @param journal_generation Generation of the journal which will record the mutations after the snapshot.
+ *
+ * @pre highway != NULL
+ * @pre path != NULL
+ *
+ * @returns snapshot_done if the snapshot is written, snapshot_io_error otherwise.
+*/
+snapshot_result save_snapshot(const highway * highway, const char * path, uint32_t journal_generation);
+
+/**
+ * @brief Restore an highway from a snapshot file.
+ *
+ * The file is mapped in memory and validated; every station is then created in order with its runs copied by a
+ * single memcpy, so no search nor insertion is performed.
+ *
+ * @param path Path of the snapshot.
+ * @param highway Address where the pointer to the restored highway (allocated on heap) will be put.
+ * @param journal_generation Address where the journal generation of the snapshot will be put (ignored if NULL).
+ *
+ * @pre path != NULL
+ * @pre highway != NULL
+ *
+ * @returns snapshot_done if the highway is restored, snapshot_not_found if path does not exist, snapshot_io_error
+ *          if the file cannot be read or there is not enough memory, snapshot_malformed if the header or the layout
+ *          are not valid, snapshot_corrupted if the checksum does not match.
+ *
+ * @note highway and journal_generation are set only if snapshot_done is returned.
+*/
+snapshot_result load_snapshot(const char * path, highway ** highway, uint32_t * journal_generation);
+
+#endif
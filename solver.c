@@ -5,6 +5,7 @@
 
 #include "solver.h"
 #include <stdlib.h>
+#include <stdint.h>
 
 #define NDEBUG
 
@@ -30,10 +31,36 @@ matrix_size min(matrix_size x, matrix_size y) {
   return y;
 }
 
+/**
+ * @brief Distance of the i-th station of a view along the route: from the first station if dir=forward, to the last 
+ * station (measured from it) if dir=backward.
+*/
+inline matrix_size view_distance(const station_view * view, direction dir, matrix_size i);
+matrix_size view_distance(const station_view * view, direction dir, matrix_size i) {
+  if(dir == forward) {
+    return view->distance[view->first + i];
+  }
+
+  matrix_size last = view->first + view->length - 1;
+  return view->distance[last] - view->distance[last - i];
+}
+
+/**
+ * @brief Maximum fuel of the i-th station of a view along the route (see view_distance).
+*/
+inline matrix_size view_fuel(const station_view * view, direction dir, matrix_size i);
+matrix_size view_fuel(const station_view * view, direction dir, matrix_size i) {
+  if(dir == forward) {
+    return view->max_fuel[view->first + i];
+  }
+
+  return view->max_fuel[view->first + view->length - 1 - i];
+}
+
 //-----------------------------------------------------------------------------------------------------------------------------------------
 //Dynamic programming approach
 //-----------------------------------------------------------------------------------------------------------------------------------------
-matrix_size * retrieve_traceback(const matrix_size * stations, matrix_size n_stations, matrix_size ** matrix, 
+matrix_size * retrieve_traceback(const station_view * view, direction dir, matrix_size ** matrix, 
                                   matrix_size ** traceback, matrix_size ** last_station, matrix_size stops, matrix_size fuel_index) {
   #ifndef NDEBUG
   printf("Starting traceback computation\n");
@@ -54,34 +81,34 @@ matrix_size * retrieve_traceback(const matrix_size * stations, matrix_size n_sta
   #endif
   
   int pos = 0;
-  int s = n_stations - 1;
+  int s = view->length - 1;
     
-  solution[(stops + 2) - ++pos] = stations[s];
+  solution[(stops + 2) - ++pos] = view_distance(view, dir, s);
   #ifndef NDEBUG
-  printf("\tAdded station=%d at distance=%d to solution\n", s, stations[s]);
+  printf("\tAdded station=%d at distance=%d to solution\n", s, view_distance(view, dir, s));
   #endif
   
   while(s > 0) {
 
     #ifndef NDEBUG
-    printf("\tStation=%d, distance=%d, pos=%d, fuel_index=%d, stops=%d\n", s, stations[s], pos, fuel_index, matrix[s][fuel_index]);
+    printf("\tStation=%d, distance=%d, pos=%d, fuel_index=%d, stops=%d\n", s, view_distance(view, dir, s), pos, fuel_index, matrix[s][fuel_index]);
     #endif  
 
     if(matrix[s - 1][traceback[s][fuel_index]] < matrix[s][fuel_index]) {
       #ifndef NDEBUG
-      printf("\tAdded station=%d at distance=%d to solution\n", s, stations[s]);
+      printf("\tAdded station=%d at distance=%d to solution\n", s, view_distance(view, dir, s));
       #endif
 
-      solution[(stops + 2) - ++pos] = stations[s];
+      solution[(stops + 2) - ++pos] = view_distance(view, dir, s);
     }
 
     fuel_index = traceback[s][fuel_index];
     --s;
   }
   
-  solution[(stops + 2) - ++pos] = stations[0];
+  solution[(stops + 2) - ++pos] = view_distance(view, dir, 0);
   #ifndef NDEBUG
-  printf("\tAdded station=%d at distance=%d to solution\n", s, stations[s]);
+  printf("\tAdded station=%d at distance=%d to solution\n", s, view_distance(view, dir, s));
   #endif
 
   #ifndef NDEBUG
@@ -208,11 +235,13 @@ void allocate_dynamic_matrixes(matrix_size ** matrix, matrix_size ** traceback_f
  * fuels which actully allow to arrive at station[i] (skip all infinite of the recurrence equation).
  * 
  * @note If dir = forward, the solution that minimizes the distance from start; otherwise (dir = backward), is computed the solution which minimizes
- * the distance to the end.
+ * the distance to the end, reading the view from its last station.
  * @note Time complexity is T(n) = O(n * f), where f is the mean number of way you can arrive at a station.  
  * @note Space complexity is M(n) = O(n * f), where f is the mean number of way you can arrive at a station. 
 */
-int min_stops_dynamic(const matrix_size * stations, matrix_size n_stations, const matrix_size * cars, matrix_size ** solution, matrix_size max_fuel, direction dir) {
+int min_stops_dynamic(const station_view * view, matrix_size ** solution, matrix_size max_fuel, direction dir) {
+
+  matrix_size n_stations = view->length;
 
   matrix_size ** matrix = NULL;
   matrix_size ** traceback_fuel = NULL;
@@ -307,7 +336,7 @@ int min_stops_dynamic(const matrix_size * stations, matrix_size n_stations, cons
   printf("Ending memory allocation, starting base case initialization\n");
   #endif
 
-  fuel[0] = cars[0];
+  fuel[0] = view_fuel(view, dir, 0);
   offset[0] = 0;
   matrix[0][0] = 0;
   traceback_station[0][0] = 0;
@@ -321,19 +350,25 @@ int min_stops_dynamic(const matrix_size * stations, matrix_size n_stations, cons
   printf("\n");
   #endif
 
+  matrix_size next_distance = view_distance(view, dir, 0);
+
   for(matrix_size s = 0; s < n_stations - 1; ++s) {
     
+    matrix_size distance = next_distance;
+    next_distance = view_distance(view, dir, s + 1);
+    matrix_size next_car = view_fuel(view, dir, s + 1);
+
     #ifndef NDEBUG
-    printf("Starting iteration for s=%d, distance=%d, cars=%d, next_s=%d\n", s, stations[s], cars[s], stations[s + 1]);
+    printf("Starting iteration for s=%d, distance=%d, cars=%d, next_s=%d\n", s, distance, view_fuel(view, dir, s), next_distance);
     #endif
 
     for(matrix_size i = 0; i < index_length; ++i) {
-      if(fuel[i] >= stations[s + 1] - stations[s]) {
-        if(fuel[i] + stations[s] - stations[s + 1] == cars[s + 1]) {
+      if(fuel[i] >= next_distance - distance) {
+        if(fuel[i] + distance - next_distance == next_car) {
           reload_index = new_index_length;
         }
 
-        fuel[new_index_length++] = fuel[i] + stations[s] - stations[s + 1];
+        fuel[new_index_length++] = fuel[i] + distance - next_distance;
         offset[offset_index + 1] = offset[offset_index];
         ++offset_index;
       }
@@ -388,7 +423,7 @@ int min_stops_dynamic(const matrix_size * stations, matrix_size n_stations, cons
         min_fuel = traceback_fuel[s + 1][i];  
 
         #ifndef NDEBUG
-        printf("New best found: stops=%d, last_station=%d, last_fuel=%d\n", min_stops, stations[last_station], min_fuel);
+        printf("New best found: stops=%d, last_station=%d, last_fuel=%d\n", min_stops, view_distance(view, dir, last_station), min_fuel);
         #endif
       }
       else if(matrix[s + 1][i] == min_stops && dir == backward && traceback_station[s + 1][i] > last_station) {
@@ -397,13 +432,13 @@ int min_stops_dynamic(const matrix_size * stations, matrix_size n_stations, cons
         min_fuel = traceback_fuel[s + 1][i];
 
         #ifndef NDEBUG
-        printf("New best found: stops=%d, last_station=%d, last_fuel=%d\n", min_stops, stations[last_station], min_fuel);
+        printf("New best found: stops=%d, last_station=%d, last_fuel=%d\n", min_stops, view_distance(view, dir, last_station), min_fuel);
         #endif
       }
 
       #ifndef NDEBUG
       printf("Index:%d --> %d->%d:%d:%d=%d\n", i,fuel[i], matrix[s + 1][i], traceback_fuel[s + 1][i], 
-      traceback_station[s + 1][i], stations[traceback_station[s + 1][i]]);
+      traceback_station[s + 1][i], view_distance(view, dir, traceback_station[s + 1][i]));
       #endif
     }
 
@@ -412,13 +447,13 @@ int min_stops_dynamic(const matrix_size * stations, matrix_size n_stations, cons
       traceback_station[s + 1][new_index_length] = s + 1;
       traceback_fuel[s + 1][new_index_length] = min_fuel;
 
-      fuel[new_index_length] = cars[s + 1];
+      fuel[new_index_length] = next_car;
 
       if(last_station == INF)
         last_station = 0;
       #ifndef NDEBUG
       printf("Station reload not computed\n\t%d->%d:%d:%d, last_station=%d\n", fuel[new_index_length], matrix[s + 1][new_index_length], 
-      traceback_fuel[s + 1][new_index_length], traceback_station[s + 1][new_index_length], stations[last_station]);
+      traceback_fuel[s + 1][new_index_length], traceback_station[s + 1][new_index_length], view_distance(view, dir, last_station));
       #endif
       if(last_station == 0)
         last_station = INF;
@@ -479,7 +514,7 @@ int min_stops_dynamic(const matrix_size * stations, matrix_size n_stations, cons
   }
 
   if(min_stops < INF) {
-    *solution = retrieve_traceback(stations, n_stations, matrix, traceback_fuel, traceback_station, min_stops, min_fuel);
+    *solution = retrieve_traceback(view, dir, matrix, traceback_fuel, traceback_station, min_stops, min_fuel);
     if(*solution == NULL) {
       min_stops = mem_error;
     }
@@ -501,13 +536,20 @@ int min_stops_dynamic(const matrix_size * stations, matrix_size n_stations, cons
 //-----------------------------------------------------------------------------------------------------------------------------------------
 //Simplest approach
 //-----------------------------------------------------------------------------------------------------------------------------------------
+/**
+ * Initial capacity of the solution of min_stops, doubled when it is full.
+*/
+#define SOLUTION_CAPACITY 16
+
 /**
  * @brief Compute the optimal solution starting from the end and finding the furthest station (e.g. the nearest to the start) which allows to reach
  * the last station; repeat until you arrive at the start. 
  * 
+ * The stops are put in the solution from the end, which is reversed at last.
+ * 
  * @note Is always found the solution that minimizes the distance from the first station (stations[0]).
  * @note Time complexity is T(n) = O(n^2) in the worst case, but generally looks linear (T(n) = O(n)). 
- * @note Space complexity is M(n) = O(n), reducible to O(s), where s is the length of the solution.
+ * @note Space complexity is M(n) = O(s), where s is the length of the solution.
 */
 int min_stops(const matrix_size * stations, matrix_size n_stations, const matrix_size * cars, matrix_size ** solution) {
   matrix_size stops, further_station_index, no_solution_found = 0;
@@ -516,9 +558,18 @@ int min_stops(const matrix_size * stations, matrix_size n_stations, const matrix
 
   end_index = n_stations - 1;
   start_index = 0;
-  matrix_size * tmp_solution = (matrix_size *) malloc(sizeof(matrix_size) * n_stations);
 
-  tmp_solution[0] = end_index;
+  matrix_size capacity = SOLUTION_CAPACITY;
+  matrix_size * reversed = (matrix_size *) malloc(sizeof(matrix_size) * capacity);
+  if(reversed == NULL) {
+    #ifndef NDEBUG
+    printf("\tNot enough space to allocate solution array of %ld bytes\n", sizeof(matrix_size) * capacity);
+    #endif
+
+    return mem_error;
+  }
+
+  reversed[0] = stations[end_index];
   stops = 0;
 
   while(!no_solution_found && end_index > start_index) {
@@ -533,7 +584,18 @@ int min_stops(const matrix_size * stations, matrix_size n_stations, const matrix
     }
     if(further_station_index < end_index) {
       if(further_station_index > start_index) {
-        tmp_solution[stops + 1] = further_station_index;
+        // One slot is always left for the start
+        if(stops + 3 > capacity) {
+          matrix_size * grown = (matrix_size *) realloc(reversed, sizeof(matrix_size) * capacity * 2);
+          if(grown == NULL) {
+            free(reversed);
+            return mem_error;
+          }
+          reversed = grown;
+          capacity *= 2;
+        }
+
+        reversed[stops + 1] = stations[further_station_index];
         ++stops;
       }
       end_index = further_station_index;
@@ -543,24 +605,153 @@ int min_stops(const matrix_size * stations, matrix_size n_stations, const matrix
     }
   } 
 
-  int return_value = no_solution;
+  if(no_solution_found) {
+    free(reversed);
+    return no_solution;
+  }
 
-  if(!no_solution_found) {
-    tmp_solution[stops + 1] = start_index;
-    (*solution) = (matrix_size *) malloc(sizeof(matrix_size) * (stops + 2));
-    
-    for(matrix_size i = 0; i < stops + 2; ++i) {
-      (*solution)[i] = stations[tmp_solution[stops - i + 1]];
+  reversed[stops + 1] = stations[start_index];
+  for(matrix_size i = 0; i < (stops + 2) / 2; ++i) {
+    matrix_size tmp = reversed[i];
+    reversed[i] = reversed[stops + 1 - i];
+    reversed[stops + 1 - i] = tmp;
+  }
+
+  *solution = reversed;
+  return stops;
+}
+//-----------------------------------------------------------------------------------------------------------------------------------------
+
+
+//-----------------------------------------------------------------------------------------------------------------------------------------
+//Linear approach
+//-----------------------------------------------------------------------------------------------------------------------------------------
+/**
+ * @brief Compute the same solution of min_stops in linear time.
+ * 
+ * The stations are split in layers by a forward sweep: the layer k holds the stations reached with k - 1 stops at best, 
+ * and it ends at the last station within the furthest reach (distance + max fuel) of the layers before it. The stations 
+ * reached by a route are also reached by every route at least as long, so the layers are contiguous and the minimum 
+ * number of stops only grows along the highway. 
+ * 
+ * Only the first station of each layer is stored; then the route goes back from the end, taking every time the first 
+ * station of the previous layer which reaches the current one, which is the furthest from the current station that 
+ * reaches it as chosen by min_stops. The stations of the route overwrite the first stations of the layers, which are 
+ * not read anymore.
+ * 
+ * The stations are read along the route (see view_distance), so a backward route is solved in place, without copying 
+ * or reversing the view.
+ * 
+ * If latest is set, the route takes every time the last station of the previous layer which reaches the current one 
+ * instead, so the stops are the nearest to the end of the route, as the ones of min_stops_dynamic on a backward route.
+ * 
+ * @note Is always found the solution that minimizes the distance from the first station of the route (from the last 
+ * if latest is set).
+ * @note Time complexity is T(n) = O(n): the sweep reads every station once, and the route reads every layer at most once.
+ * @note Space complexity is M(n) = O(s), where s is the length of the solution.
+*/
+/**
+ * @brief Check if the i-th station of a view along the route can stop before a station at a further distance.
+ * 
+ * A tombstone of the highway has the distance of the station before it and no fuel, so it is never a stop: it would 
+ * reach the station it follows, which is at its same distance.
+*/
+inline matrix_size reaches(const station_view * view, direction dir, matrix_size i, matrix_size distance);
+matrix_size reaches(const station_view * view, direction dir, matrix_size i, matrix_size distance) {
+  matrix_size station_distance = view_distance(view, dir, i);
+
+  return station_distance < distance && view_fuel(view, dir, i) >= distance - station_distance;
+}
+
+int min_stops_layers_view(const station_view * view, direction dir, matrix_size latest, matrix_size ** solution) {
+  matrix_size capacity = SOLUTION_CAPACITY;
+  matrix_size * layers = (matrix_size *) malloc(sizeof(matrix_size) * capacity);
+  if(layers == NULL) {
+    #ifndef NDEBUG
+    printf("\tNot enough space to allocate layers array of %ld bytes\n", sizeof(matrix_size) * capacity);
+    #endif
+
+    return mem_error;
+  }
+
+  matrix_size end_index = view->length - 1;
+  // The reach is 64-bit wide since distance + max fuel may not fit in a matrix_size
+  matrix_size n_layers = 1, last = 0;
+  uint64_t reach = (uint64_t) view_distance(view, dir, 0) + view_fuel(view, dir, 0);
+  layers[0] = 0;
+
+  while(last < end_index) {
+    if(view_distance(view, dir, last + 1) > reach) {
+      free(layers);
+      return no_solution;
     }
 
-    return_value = stops;
+    if(n_layers == capacity) {
+      matrix_size * grown = (matrix_size *) realloc(layers, sizeof(matrix_size) * capacity * 2);
+      if(grown == NULL) {
+        free(layers);
+        return mem_error;
+      }
+      layers = grown;
+      capacity *= 2;
+    }
+    layers[n_layers++] = last + 1;
+
+    // The reach of the new layer is known only when it ends, so it extends the reach of the next one
+    uint64_t next_reach = reach;
+    while(last < end_index && view_distance(view, dir, last + 1) <= reach) {
+      ++last;
+      uint64_t station_reach = (uint64_t) view_distance(view, dir, last) + view_fuel(view, dir, last);
+      if(station_reach > next_reach) {
+        next_reach = station_reach;
+      }
+    }
+    reach = next_reach;
   }
 
-  free(tmp_solution);
-  return return_value;
+  #ifndef NDEBUG
+  printf("\t%d layers computed\n", n_layers);
+  #endif
+
+  // A route of a single station stops at the start as min_stops does
+  if(n_layers == 1) {
+    layers[n_layers++] = 0;
+  }
+
+  matrix_size current = end_index;
+  for(matrix_size k = n_layers - 1; k > 0; --k) {
+    matrix_size i = layers[k - 1];
+    matrix_size current_distance = view_distance(view, dir, current);
+
+    if(latest) {
+      // The previous layer ends before the current station, which is in the layer k
+      matrix_size j = min(layers[k], current);
+      while(j > i && !reaches(view, dir, j - 1, current_distance)) {
+        --j;
+      }
+      i = j > i ? j - 1 : i;
+    }
+    else {
+      while(i < current && !reaches(view, dir, i, current_distance)) {
+        ++i;
+      }
+    }
+
+    layers[k] = current_distance;
+    current = i;
+  }
+  layers[0] = view_distance(view, dir, 0);
+
+  *solution = layers;
+  return n_layers - 2;
 }
-//-----------------------------------------------------------------------------------------------------------------------------------------
 
+int min_stops_layers(const matrix_size * stations, matrix_size n_stations, const matrix_size * cars, matrix_size ** solution) {
+  station_view view = {stations, cars, 0, n_stations};
+
+  return min_stops_layers_view(&view, forward, 0, solution);
+}
+//-----------------------------------------------------------------------------------------------------------------------------------------
 
 void explain_solution(const matrix_size * stations, matrix_size n_stations, const matrix_size * cars, matrix_size * solution, matrix_size stops, direction dir) {
   for(matrix_size i = 0; i < stops + 1; ++i) {
@@ -584,7 +775,13 @@ void explain_solution(const matrix_size * stations, matrix_size n_stations, cons
   }
 }
 
-int solve(matrix_size * stations, matrix_size n_stations, matrix_size * cars, direction dir, matrix_size ** solution) {
+int solve(const matrix_size * stations, matrix_size n_stations, const matrix_size * cars, direction dir, matrix_size ** solution) {
+    station_view view = {stations, cars, 0, n_stations};
+
+    return solve_view(&view, dir, solution);
+}
+
+int solve_view(const station_view * view, direction dir, matrix_size ** solution) {
     
     #ifndef NDEBUG
     printf("Starting solve\n");
@@ -593,7 +790,7 @@ int solve(matrix_size * stations, matrix_size n_stations, matrix_size * cars, di
     int stops = 0;
     *solution = NULL;
 
-    if(stations == NULL || cars == NULL) {
+    if(view == NULL || view->distance == NULL || view->max_fuel == NULL) {
       #ifndef NDEBUG
       printf("\tNULL pointer\n");
       #endif
@@ -601,63 +798,34 @@ int solve(matrix_size * stations, matrix_size n_stations, matrix_size * cars, di
       return null_ptr;
     }
 
-    if(dir == forward) {
-        stops = min_stops(stations, n_stations, cars, solution);
+    if(view->length == 0) {
+      return no_solution;
     }
-    else {
-      
-      matrix_size last_station = stations[n_stations - 1], tmp = 0;
 
-      for(matrix_size i = 0; i < n_stations / 2; ++i) {
-        tmp = last_station - stations[i];
-        stations[i] = last_station - stations[n_stations - i - 1];
-        stations[n_stations - i - 1] = tmp;
+    const matrix_size * stations = view->distance + view->first;
+    matrix_size n_stations = view->length;
 
-        tmp = cars[i];
-        cars[i] = cars[n_stations - i - 1];
-        cars[n_stations - i - 1] = tmp;
-      }
-      if(n_stations % 2 == 1) {
-        stations[n_stations / 2] = last_station - stations[n_stations / 2];
-      }
-
-      #ifdef MINIMIZE_DISTANCE
-      matrix_size max_fuel = 0;
-      for(matrix_size i = 0; i < n_stations; ++i) {
-        if(cars[i] > max_fuel) {
-          max_fuel = cars[i];
-        }
-      }
-
-      stops = min_stops_dynamic(stations, n_stations, cars, solution, max_fuel, backward);
-      #else
-      stops = min_stops(stations, n_stations, cars, solution);
-      #endif
-
-      if(stops >= 0){
-        for(int i = 0; i < stops + 2; ++i){
-          (*solution)[i] = last_station - (*solution)[i];
-        }
-      }
+    #ifdef MINIMIZE_DISTANCE
+    // Along a backward route the stops nearest to the start of the highway are the last of their layers
+    matrix_size latest = dir == backward;
+    #else
+    matrix_size latest = 0;
+    #endif
 
-      for(matrix_size i = 0; i < n_stations / 2; ++i) {
-        tmp = last_station - stations[i];
-        stations[i] = last_station - stations[n_stations - i - 1];
-        stations[n_stations - i - 1] = tmp;
+    stops = min_stops_layers_view(view, dir, latest, solution);
 
-        tmp = cars[i];
-        cars[i] = cars[n_stations - i - 1];
-        cars[n_stations - i - 1] = tmp;
-      }
-      if(n_stations % 2 == 1) {
-        stations[n_stations / 2] = last_station - stations[n_stations / 2];
+    // The distances of a backward route are measured from its first station (the last of the view)
+    if(dir == backward && stops >= 0) {
+      matrix_size last_station = stations[n_stations - 1];
+      for(int i = 0; i < stops + 2; ++i) {
+        (*solution)[i] = last_station - (*solution)[i];
       }
     }
 
     #ifndef NDEBUG
     if(stops >= 0) {
       printf("Solution explanation:\n");
-      explain_solution(stations, n_stations, cars, *solution, stops, dir);
+      explain_solution(stations, n_stations, view->max_fuel + view->first, *solution, stops, dir);
     }
     #endif
     
@@ -38,6 +38,22 @@ typedef enum {
 
 typedef unsigned int matrix_size;
 
+/**
+ * @struct station_view
+ * @brief Read only view of the stations from first to first + length - 1 of two parallel arrays.
+ * 
+ * @param distance Base of the array of the distances of the stations, increasingly ordered.
+ * @param max_fuel Base of the array of the maximum fuel of the cars at stations.
+ * @param first Index of the first station of the view.
+ * @param length Number of stations of the view.
+*/
+typedef struct station_view {
+    const matrix_size * distance;
+    const matrix_size * max_fuel;
+    matrix_size first;
+    matrix_size length;
+} station_view;
+
 /**
  *  @brief Compute the optimal solution for the problem of finding the minimum number of stops.
  *  
@@ -55,8 +71,69 @@ typedef unsigned int matrix_size;
  *  @note If more solutions are avaible, is choosen the solution which minimizes the distance from the actual start 
  *  (if dir=forward from the beginning, if dir=backward from the end).
  *  @note if MINIMIZE_DISTANCE in defined, is always choosen the solution which minimizes the distance from the start (stations[0]).
+ *  @note stations and cars are not modified (see solve_view).
 */
-int solve(matrix_size * stations, matrix_size n_stations, matrix_size * cars, 
+int solve(const matrix_size * stations, matrix_size n_stations, const matrix_size * cars, 
         direction dir, matrix_size ** solution);
+
+/**
+ *  @brief Compute the optimal solution on a view of the stations (see solve).
+ *  
+ *  The stations are read in place: a backward route reads the view from the last station, so neither a copy nor a
+ *  reversal of the stations is needed, and a route in either direction allocates only the solution.
+ * 
+ *  @param view Pointer to the view of the stations, from the start to the end if dir=forward, from the end to the start
+ *              if dir=backward.
+ *  @param dir Direction to follow (forward or backward).
+ *  @param solution Address of the pointer which will reference the solution (composed by the distances of the station from start).
+ * 
+ *  @returns The minimum number of stops necessary (see solve); null_ptr if the arrays of the view are NULL, no_solution if
+ *           the view is empty.
+*/
+int solve_view(const station_view * view, direction dir, matrix_size ** solution);
+
+/**
+ *  @brief Compute the optimal solution of a forward route, going back from the end to the furthest station which 
+ *  reaches it (see solve).
+ * 
+ *  @returns The minimum number of stops necessary (see solve).
+ * 
+ *  @note T(n) = O(n^2) in the worst case (cars which reach only the next stations): it is kept as reference for 
+ *  min_stops_layers, which is used by solve.
+*/
+int min_stops(const matrix_size * stations, matrix_size n_stations, const matrix_size * cars, matrix_size ** solution);
+
+/**
+ *  @brief Compute the same solution of min_stops in linear time, splitting the stations in layers by the number of stops 
+ *  (see solve).
+ * 
+ *  @returns The minimum number of stops necessary (see solve).
+ * 
+ *  @note T(n) = O(n), and only the solution is allocated (M(n) = O(s), with s the length of the solution).
+*/
+int min_stops_layers(const matrix_size * stations, matrix_size n_stations, const matrix_size * cars, 
+        matrix_size ** solution);
+
+/**
+ *  @brief Compute the solution of min_stops_layers on a view of the stations, read along the route (see solve_view).
+ * 
+ *  @param latest 1 to choose the stops nearest to the end of the route, as min_stops_dynamic does on a backward route; 
+ *                0 to choose the stops nearest to its start, as min_stops does.
+ * 
+ *  @returns The minimum number of stops necessary (see solve); the solution holds the distances along the route.
+*/
+int min_stops_layers_view(const station_view * view, direction dir, matrix_size latest, matrix_size ** solution);
+
+/**
+ *  @brief Compute the optimal solution through dynamic programming (see solve).
+ * 
+ *  @param max_fuel Maximum fuel of the cars of the view.
+ * 
+ *  @returns The minimum number of stops necessary (see solve); the solution holds the distances along the route.
+ * 
+ *  @note T(n) = O(n * f) and M(n) = O(n * f), where f is the mean number of ways of arriving at a station: it is kept 
+ *  as reference for min_stops_layers_view, which is used by solve on backward routes.
+*/
+int min_stops_dynamic(const station_view * view, matrix_size ** solution, matrix_size max_fuel, direction dir);
                     
 #endif
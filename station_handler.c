@@ -6,7 +6,11 @@
 */
 
 #include "station_handler.h"
+#include "search.h"
+#include "station_hash.h"
+#include "station_pool.h"
 #include <stdlib.h>
+#include <string.h>
 
 #define NDEBUG
 
@@ -15,80 +19,27 @@
 #endif
 
 /**
- * @brief Run binary search to find the position of the element nearest to target.
+ * @brief Find the index of the station at a given distance.
  * 
- * @param stations Array of pointers to station struct.
- * @param a Lower limit.
- * @param b Upper limit.
- * @param target Target element to find.
+ * @returns The index of the station, -1 if it is not in the highway.
  * 
- * @pre stations != NULL
- * @pre a >= 0
- * @pre b <= station.length - 1
- * @pre a <= b
- * 
- * @returns The position of the element nearest to target.
- * 
- * @note T(n) = O(log(n)).
- * @note M(n) = O(1).
- * @note If target is not present, it's returned the index of the nearest element to target.
+ * @note O(1) expected time: the station is found in the hash table and its slot is the index.
 */
-int bin_search(station** stations, int a, int b, int target) {
-
-  #ifndef NDEBUG
-  printf("\tbin_search: a=%d, b=%d, target=%d ", a, b, target);
-  #endif
-
-  if(a >= b) {
-
-    if(stations[a] != NULL && stations[a]->distance <= target) {
-      return a;
-    }
-
-    return b;
-  }
-
-  int m = (a + b) / 2;
-
-  #ifndef NDEBUG
-  printf("m=%d, station=%d\n", m, stations[m]->distance);
-  #endif
-
-  if(stations[m]->distance == target) {
-    return m;
-  }
+int station_index(const highway * highway, matrix_size distance) {
+  station * found = highway == NULL ? NULL : hash_find(highway->lookup, distance);
 
-  if(target < stations[m]->distance) {
-    return bin_search(stations, a, m - 1, target);
-  } else {
-    return bin_search(stations, m + 1, b, target);
-  }
+  return found == NULL ? -1 : (int) found->slot;
 }
 
-void test_binary_search() {
-    matrix_size length = 10;
-    station * vect[length];
-    
-    vect[0] = create_station(1, 4);
-    vect[1] = create_station(3, 5);
-    vect[2] = create_station(6, 12);
-    vect[3] = create_station(7, 1);
-    vect[4] = create_station(8, 11);
-    vect[5] = create_station(10, 8);
-    vect[6] = create_station(13, 6);
-    vect[7] = create_station(17, 4);
-    vect[8] = create_station(18, 3);
-    vect[9] = create_station(20, 4);
-    
-    #ifndef NDEBUG
-    for(int i = vect[0]->distance - 1; i < vect[length - 1]->distance + 3; ++i) {
-        printf("bin_search(vect, 0, %d, %d) = %d\n", length - 1, i, bin_search(vect, 0, length - 1, i));
-    }
-    #endif
-
-    for(int i = 0; i < length; ++i) {
-      delete_station(vect[i]);
+/**
+ * @brief Set the slot of the stations from index first to index last (excluded) of an highway.
+*/
+void update_slots(highway * my_highway, matrix_size first, matrix_size last) {
+  for(matrix_size i = first; i < last; ++i) {
+    if(my_highway->stations[i] != NULL) {
+      my_highway->stations[i]->slot = i;
     }
+  }
 }
 
 
@@ -121,15 +72,25 @@ highway * create_highway(matrix_size capacity) {
 
   my_highway->capacity = capacity;
   my_highway->length = 0;
+  my_highway->tombstones = 0;
+  my_highway->pool = NULL;
+  my_highway->lookup = NULL;
 
   #ifndef NDEBUG
   printf("\tSetted highway capacity and length\n");
   #endif
 
-  station** stations = (station**) calloc(capacity, sizeof(station *));
-  if(stations == NULL) {
+  my_highway->distance = (matrix_size *) malloc(sizeof(matrix_size) * capacity);
+  my_highway->max_fuel = (matrix_size *) malloc(sizeof(matrix_size) * capacity);
+  my_highway->stations = (station**) calloc(capacity, sizeof(station *));
+  my_highway->pool = create_station_pool();
+  my_highway->lookup = create_station_hash(capacity);
+
+  if(my_highway->distance == NULL || my_highway->max_fuel == NULL || my_highway->stations == NULL || 
+      my_highway->pool == NULL || my_highway->lookup == NULL) {
     #ifndef NDEBUG
-    printf("\tNot enough memory to allocate stations pointers array of %ld bytes\n", capacity * sizeof(station *));
+    printf("\tNot enough memory to allocate stations arrays of %ld bytes\n", 
+      capacity * (2 * sizeof(matrix_size) + sizeof(station *)));
     #endif
 
     delete_highway(my_highway);
@@ -137,13 +98,7 @@ highway * create_highway(matrix_size capacity) {
   }
 
   #ifndef NDEBUG
-  printf("\tAllocated stations pointers array of %ld bytes\n", sizeof(station *) * capacity);
-  #endif
-
-  my_highway->stations = stations;
-
-  #ifndef NDEBUG
-  printf("\tSetted highway stations\n");
+  printf("\tAllocated stations arrays of %ld bytes\n", capacity * (2 * sizeof(matrix_size) + sizeof(station *)));
   printf("Ending highway creation\n");
   #endif
 
@@ -173,6 +128,13 @@ void delete_highway(highway * my_highway) {
       #endif
     }
 
+    free(my_highway->distance);
+    free(my_highway->max_fuel);
+
+    // Every station of the pool has been deleted with the highway
+    delete_station_pool(my_highway->pool);
+    delete_station_hash(my_highway->lookup);
+
     free(my_highway);
     my_highway = NULL;
     #ifndef NDEBUG
@@ -186,16 +148,78 @@ void delete_highway(highway * my_highway) {
 }
 
 
+/**
+ * @brief Allocate an array of runs, from a pool if it is not NULL.
+ * 
+ * @returns A pointer to the array (of granted runs), NULL if there is not enough memory.
+*/
+fuel_run * alloc_runs(station_pool * pool, matrix_size capacity, matrix_size * granted) {
+  if(pool != NULL) {
+    return pool_alloc_runs(pool, capacity, granted);
+  }
+
+  *granted = capacity;
+  return (fuel_run *) malloc(sizeof(fuel_run) * capacity);
+}
+
+/**
+ * @brief Release the runs of a station, unless they are the inline ones.
+*/
+void free_runs(station * station) {
+  if(station->runs == station->inline_runs) {
+    return;
+  }
+
+  if(station->pool != NULL) {
+    pool_free_runs(station->pool, station->runs, station->capacity);
+  }
+  else {
+    free(station->runs);
+  }
+}
+
+/**
+ * @brief Initialize a station, using the inline runs if capacity <= STATION_INLINE_RUNS.
+ * 
+ * @returns 1 if the station is initialized; 0 if there is not enough memory for the runs (station->runs is NULL).
+*/
+matrix_size init_station(station * new_station, station_pool * pool, matrix_size distance, matrix_size capacity) {
+  new_station->distance = distance;
+  new_station->n_runs = 0;
+  new_station->length = 0;
+  new_station->car_max_fuel = 0;
+  new_station->slot = 0;
+  new_station->pool = pool;
+
+  if(capacity <= STATION_INLINE_RUNS) {
+    new_station->runs = new_station->inline_runs;
+    new_station->capacity = STATION_INLINE_RUNS;
+
+    return 1;
+  }
+
+  new_station->runs = alloc_runs(pool, capacity, &new_station->capacity);
+  if(new_station->runs == NULL) {
+    #ifndef NDEBUG
+    printf("\tNot enough memory to allocate runs array of %ld bytes\n", capacity * sizeof(fuel_run));
+    #endif
+
+    return 0;
+  }
+
+  #ifndef NDEBUG
+  printf("\tAllocated runs array of %ld bytes\n", sizeof(fuel_run) * new_station->capacity);
+  #endif
+
+  return 1;
+}
+
 station * create_station(matrix_size distance, matrix_size capacity) {
 
     #ifndef NDEBUG
     printf("Starting station creation\n");
     #endif
 
-    if(capacity == 0) {
-      ++capacity;
-    }
-
     station * new_station = (station *) malloc(sizeof(station));
     if(new_station == NULL) {
       #ifndef NDEBUG
@@ -209,27 +233,44 @@ station * create_station(matrix_size distance, matrix_size capacity) {
     printf("\tAllocated station of %ld bytes\n", sizeof(*new_station));
     #endif
 
-    new_station->cars = (matrix_size *) malloc(sizeof(matrix_size) * capacity);
-    if(new_station->cars == NULL) {
-      #ifndef NDEBUG
-      printf("\tNot enough memory to allocate cars array of %ld bytes\n", capacity * sizeof(matrix_size));
-      #endif
-
+    if(!init_station(new_station, NULL, distance, capacity)) {
       delete_station(new_station);
       return NULL;
     }
 
     #ifndef NDEBUG
-    printf("\tAllocated cars array of %ld bytes\n", sizeof(matrix_size) * capacity);
+    printf("Ending station creation\n");
     #endif
 
-    new_station->distance = distance;
-    new_station->capacity = capacity;
-    new_station->length = 0;
-    new_station->car_max_fuel = 0;
+    return new_station;
+}
+
+station * create_pooled_station(highway * highway, matrix_size distance, matrix_size capacity) {
 
     #ifndef NDEBUG
-    printf("Ending station creation\n");
+    printf("Starting pooled station creation\n");
+    #endif
+
+    if(highway == NULL || highway->pool == NULL) {
+      #ifndef NDEBUG
+      printf("\tNULL pointer\n");
+      #endif
+
+      return NULL;
+    }
+
+    station * new_station = pool_alloc_station(highway->pool);
+    if(new_station == NULL) {
+      return NULL;
+    }
+
+    if(!init_station(new_station, highway->pool, distance, capacity)) {
+      delete_station(new_station);
+      return NULL;
+    }
+
+    #ifndef NDEBUG
+    printf("Ending pooled station creation\n");
     #endif
 
     return new_station;
@@ -241,13 +282,18 @@ void delete_station(station * station) {
   #endif
   
   if(station != NULL) {
-    free(station->cars);
-    station->cars = NULL;
+    free_runs(station);
+    station->runs = NULL;
     #ifndef NDEBUG
-    printf("\tDeallocated cars\n");
+    printf("\tDeallocated runs\n");
     #endif
 
-    free(station);
+    if(station->pool != NULL) {
+      pool_free_station(station->pool, station);
+    }
+    else {
+      free(station);
+    }
     station = NULL;
     #ifndef NDEBUG
     printf("\tDeallocated station\n");
@@ -259,17 +305,76 @@ void delete_station(station * station) {
   #endif
 }
 
-matrix_size add_station(highway ** highway_pointer, station * new_station) {
-  
+/**
+ * @brief Change the capacity of the array of stations in place, keeping NULL the pointers after the last station.
+ * 
+ * @returns 1 if the capacity is changed; 0 if there is not enough memory (the highway is unchanged).
+ * 
+ * @note Large arrays are moved by realloc remapping their pages (mremap), without copying the pointers.
+*/
+matrix_size resize_highway(highway * my_highway, matrix_size capacity) {
+  // Every array is replaced as soon as it is resized, so after a failure they all hold at least the smaller capacity
+  matrix_size * distance = (matrix_size *) realloc(my_highway->distance, sizeof(matrix_size) * capacity);
+  if(distance != NULL) {
+    my_highway->distance = distance;
+  }
+
+  matrix_size * max_fuel = distance == NULL ? NULL : 
+                            (matrix_size *) realloc(my_highway->max_fuel, sizeof(matrix_size) * capacity);
+  if(max_fuel != NULL) {
+    my_highway->max_fuel = max_fuel;
+  }
+
+  station ** stations = max_fuel == NULL ? NULL : 
+                        (station **) realloc(my_highway->stations, sizeof(station *) * capacity);
+  if(stations == NULL) {
+    #ifndef NDEBUG
+    printf("\tUnable to resize stations arrays to %d stations\n", capacity);
+    #endif
+
+    if(capacity < my_highway->capacity) {
+      my_highway->capacity = capacity;
+    }
+
+    return 0;
+  }
+
+  if(capacity > my_highway->capacity) {
+    memset(stations + my_highway->capacity, 0, sizeof(station *) * (capacity - my_highway->capacity));
+  }
+
   #ifndef NDEBUG
-  printf("Starting station insertion\n");
+  printf("\tHighway capacity changed from %d to %d\n", my_highway->capacity, capacity);
   #endif
 
-  #ifndef NDEBUG
-    printf("\tHighway length=%d, new_station distance=%d\n", (*highway_pointer)->length, new_station->distance);
+  my_highway->stations = stations;
+  my_highway->capacity = capacity;
+
+  return 1;
+}
+
+matrix_size reserve_highway(highway * my_highway, matrix_size capacity) {
+  if(my_highway == NULL) {
+    #ifndef NDEBUG
+    printf("\tNULL pointer\n");
     #endif
 
-  if(highway_pointer == NULL || *highway_pointer == NULL || new_station == NULL) {
+    return 0;
+  }
+
+  if(!hash_reserve(my_highway->lookup, capacity)) {
+    return 0;
+  }
+
+  if(capacity <= my_highway->capacity) {
+    return 1;
+  }
+
+  return resize_highway(my_highway, capacity);
+}
+
+matrix_size shrink_highway_to_fit(highway * my_highway) {
+  if(my_highway == NULL) {
     #ifndef NDEBUG
     printf("\tNULL pointer\n");
     #endif
@@ -277,111 +382,425 @@ matrix_size add_station(highway ** highway_pointer, station * new_station) {
     return 0;
   }
 
-  highway * my_highway = *highway_pointer;
+  compact_highway(my_highway);
+
+  matrix_size capacity = my_highway->length > 0 ? my_highway->length : 1;
+  if(capacity == my_highway->capacity) {
+    return 1;
+  }
+
+  return resize_highway(my_highway, capacity);
+}
+
+matrix_size compact_highway(highway * my_highway) {
+  if(my_highway == NULL || my_highway->tombstones == 0) {
+    return 0;
+  }
+
+  matrix_size kept = 0;
+  for(matrix_size i = 0; i < my_highway->length; ++i) {
+    if(my_highway->stations[i] != NULL) {
+      my_highway->distance[kept] = my_highway->distance[i];
+      my_highway->max_fuel[kept] = my_highway->max_fuel[i];
+      my_highway->stations[kept] = my_highway->stations[i];
+      my_highway->stations[kept]->slot = kept;
+      ++kept;
+    }
+  }
+
+  matrix_size removed = my_highway->length - kept;
+  memset(my_highway->stations + kept, 0, sizeof(station *) * removed);
+
+  my_highway->length = kept;
+  my_highway->tombstones = 0;
+
+  #ifndef NDEBUG
+  printf("\tCompacted %d tombstones, new length: %d/%d\n", removed, my_highway->length, my_highway->capacity);
+  #endif
+
+  return removed;
+}
+
+matrix_size sparse_highway(const highway * my_highway) {
+  return my_highway != NULL && 
+          (size_t) my_highway->tombstones * 100 > (size_t) my_highway->length * HIGHWAY_SPREAD_TOMBSTONES;
+}
+
+/**
+ * @brief Find the slot of a new station at index: a tombstone within HIGHWAY_SEGMENT slots on either side, or the end 
+ * of the arrays if it is as near.
+ * 
+ * @returns The nearest slot (a tombstone at index first, then the one right before it), -1 if there is none.
+*/
+int find_slot(const highway * my_highway, matrix_size index) {
+  if(my_highway->tombstones == 0) {
+    return my_highway->length - index <= HIGHWAY_SEGMENT ? (int) my_highway->length : -1;
+  }
+
+  // A slot at distance d after index moves d stations, as one at distance d before index - 1
+  for(matrix_size d = 0; d <= HIGHWAY_SEGMENT; ++d) {
+    if(index + d >= my_highway->length) {
+      return my_highway->length;
+    }
+    if(my_highway->stations[index + d] == NULL) {
+      return index + d;
+    }
+    if(index > d && my_highway->stations[index - 1 - d] == NULL) {
+      return index - 1 - d;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * @brief Spread evenly the stations from index lo to index hi (excluded) over the slots from lo to end (excluded).
+ * 
+ * The stations are packed at the end of the slots, then moved to their place from the start; every other slot becomes 
+ * a tombstone with the distance of the station before it, so the distances stay ordered.
+ * 
+ * @pre hi <= end <= highway->capacity, and the station at lo is the first of the slots after the spread.
+*/
+void spread_window(highway * my_highway, matrix_size lo, matrix_size hi, matrix_size end) {
+  matrix_size packed = end;
+  for(matrix_size i = hi; i > lo; --i) {
+    if(my_highway->stations[i - 1] != NULL) {
+      --packed;
+      my_highway->distance[packed] = my_highway->distance[i - 1];
+      my_highway->max_fuel[packed] = my_highway->max_fuel[i - 1];
+      my_highway->stations[packed] = my_highway->stations[i - 1];
+    }
+  }
+
+  size_t n = end - packed, slots = end - lo;
+  matrix_size next = lo, previous = 0;
+
+  // Every station moves back (its place is never after its packed slot), so no station is overwritten before it moves
+  for(size_t j = 0; j < n; ++j) {
+    matrix_size target = lo + j * slots / n;
+
+    for(; next < target; ++next) {
+      my_highway->distance[next] = previous;
+      my_highway->max_fuel[next] = 0;
+      my_highway->stations[next] = NULL;
+    }
+
+    previous = my_highway->distance[packed + j];
+    my_highway->distance[target] = previous;
+    my_highway->max_fuel[target] = my_highway->max_fuel[packed + j];
+    my_highway->stations[target] = my_highway->stations[packed + j];
+    my_highway->stations[target]->slot = target;
+    next = target + 1;
+  }
+
+  for(; next < end; ++next) {
+    my_highway->distance[next] = previous;
+    my_highway->max_fuel[next] = 0;
+    my_highway->stations[next] = NULL;
+  }
+}
+
+/**
+ * @brief Make a tombstone near index, spreading the stations of the smallest window around it which is not too full.
+ * 
+ * Windows are aligned blocks of HIGHWAY_SEGMENT << h slots, up to the level of the whole highway: a window is spread if, 
+ * with the new station, its stations fill at most 100 - HIGHWAY_SPREAD_TOMBSTONES * h / levels percent of it. Larger 
+ * windows must be emptier, so a window is spread again only after many insertions in it. If even the whole highway is 
+ * too full, its stations are spread over more slots, growing the arrays.
+ * 
+ * @pre index + HIGHWAY_SEGMENT < highway->length
+ * 
+ * @returns 1 if the stations are spread; 0 if there is not enough memory to grow the arrays (the highway is unchanged).
+*/
+matrix_size spread_stations(highway * my_highway, matrix_size index) {
+  matrix_size levels = 1;
+  while(((size_t) HIGHWAY_SEGMENT << levels) < my_highway->length) {
+    ++levels;
+  }
+
+  // The stations of every window are counted adding the slots it has more than the previous one
+  size_t lo = index, hi = index, n = 0;
+  for(matrix_size h = 0; h <= levels; ++h) {
+    size_t size = (size_t) HIGHWAY_SEGMENT << h;
+    size_t window_lo = index / size * size;
+    size_t window_hi = window_lo + size < my_highway->length ? window_lo + size : my_highway->length;
+
+    for(size_t i = window_lo; i < lo; ++i) {
+      n += my_highway->stations[i] != NULL;
+    }
+    for(size_t i = hi; i < window_hi; ++i) {
+      n += my_highway->stations[i] != NULL;
+    }
+    lo = window_lo;
+    hi = window_hi;
+
+    if((n + 1) * 100 * levels <= (hi - lo) * (100 * levels - HIGHWAY_SPREAD_TOMBSTONES * h)) {
+      #ifndef NDEBUG
+      printf("\tSpreading %zu stations from %zu to %zu\n", n, lo, hi);
+      #endif
+
+      spread_window(my_highway, lo, hi, hi);
+      return 1;
+    }
+  }
+
+  n = my_highway->length - my_highway->tombstones;
+  size_t length = (n + 1) * 100 / (100 - HIGHWAY_SPREAD_TOMBSTONES) + 1;
+  if(length > my_highway->capacity && 
+      !resize_highway(my_highway, length > 2 * (size_t) my_highway->capacity ? length : 2 * my_highway->capacity)) {
+    return 0;
+  }
+
+  #ifndef NDEBUG
+  printf("\tSpreading %zu stations of the highway on %zu slots\n", n, length);
+  #endif
 
-  int index = 0;
+  spread_window(my_highway, 0, my_highway->length, length);
+  my_highway->tombstones += length - my_highway->length;
+  my_highway->length = length;
 
-  if(my_highway->length > 0) {
+  return 1;
+}
+
+matrix_size add_station(highway * my_highway, station * new_station) {
+  
+  #ifndef NDEBUG
+  printf("Starting station insertion\n");
+  #endif
+
+  if(my_highway == NULL || new_station == NULL) {
     #ifndef NDEBUG
-    printf("\tHighway length=%d, new_station distance=%d\n", my_highway->length, new_station->distance);
+    printf("\tNULL pointer\n");
     #endif
 
-    index = bin_search(my_highway->stations, 0, my_highway->length - 1, new_station->distance);
-    
+    return 0;
+  }
+
+  #ifndef NDEBUG
+  printf("\tHighway length=%d, new_station distance=%d\n", my_highway->length, new_station->distance);
+  #endif
+
+  if(hash_find(my_highway->lookup, new_station->distance) != NULL) {
     #ifndef NDEBUG
-    printf("\tInitial index computed: %d\n", index);
+    printf("\tStation at distance %d already inserted\n", new_station->distance);
     #endif
 
-    if(index < 0) {
-      index = 0;
-    }
+    return 0;
+  }
 
-    if(index < my_highway->length && new_station->distance == my_highway->stations[index]->distance) {
+  // The station takes the tombstone at its position (which may have its same distance) or the one right before it; 
+  // otherwise the nearest tombstone on either side, moving only the stations in between, or a new slot after the last 
+  // station. When they are all far, the stations around the position are spread to make a tombstone near it
+  matrix_size index = lower_bound(my_highway->distance, my_highway->length, new_station->distance);
+  int found = find_slot(my_highway, index);
+  if(found < 0) {
+    if(!spread_stations(my_highway, index)) {
       #ifndef NDEBUG
-      printf("\tStation at distance %d already inserted\n", new_station->distance);
+      printf("\tUnable to grow the highway to spread its stations\n");
       #endif
 
       return 0;
     }
 
-    if(index < my_highway->length && new_station->distance > my_highway->stations[index]->distance) {
-      ++index;
-    }
+    index = lower_bound(my_highway->distance, my_highway->length, new_station->distance);
+    found = find_slot(my_highway, index);
   }
+  matrix_size slot = found >= 0 ? (matrix_size) found : my_highway->length;
 
   #ifndef NDEBUG
-  printf("\tComputed new station index: %d\n", index);
+  printf("\tComputed new station index: %d, slot: %d\n", index, slot);
   #endif
   
-  if(my_highway->length == my_highway->capacity) {
+  if(slot == my_highway->length && my_highway->length == my_highway->capacity) {
     
     #ifndef NDEBUG
     printf("\tArray full (%d/%d), attempting to double capacity\n", my_highway->length, my_highway->capacity);
     #endif
 
-    highway* new_highway = create_highway(my_highway->capacity * 2);
-    if(new_highway == NULL) {
+    if(resize_highway(my_highway, my_highway->capacity * 2) == 0) {
       #ifndef NDEBUG
       printf("\tUnable to double capacity\n");
       #endif
 
       return 0;
     }
+  }
 
+  if(!hash_insert(my_highway->lookup, new_station)) {
     #ifndef NDEBUG
-    printf("\tCapacity doubled, inserting new station\n");
+    printf("\tUnable to grow the hash table\n");
     #endif
 
-    for(int i = 0; i < index; ++i) {
-      new_highway->stations[i] = my_highway->stations[i];
-    }
-    new_highway->stations[index] = new_station;
-    for(int i = index + 1; i <= my_highway->length; ++i) {
-      new_highway->stations[i] = my_highway->stations[i - 1];
-    }
+    return 0;
+  }
 
-    new_highway->length = my_highway->length + 1;
-    
-    free(my_highway->stations);
-    free(my_highway);
+  if(slot < my_highway->length) {
+    --my_highway->tombstones;
+  }
+  else {
+    ++my_highway->length;
+  }
 
-    *highway_pointer = new_highway;
-    my_highway = *highway_pointer;
+  if(slot < index) {
+    // The stations between the tombstone and the position move back by one, and the station goes right before them
+    matrix_size moved = index - slot - 1;
+    memmove(my_highway->distance + slot, my_highway->distance + slot + 1, sizeof(matrix_size) * moved);
+    memmove(my_highway->max_fuel + slot, my_highway->max_fuel + slot + 1, sizeof(matrix_size) * moved);
+    memmove(my_highway->stations + slot, my_highway->stations + slot + 1, sizeof(station *) * moved);
+    update_slots(my_highway, slot, slot + moved);
+    index = index - 1;
+  }
+  else {
+    matrix_size moved = slot - index;
+    memmove(my_highway->distance + index + 1, my_highway->distance + index, sizeof(matrix_size) * moved);
+    memmove(my_highway->max_fuel + index + 1, my_highway->max_fuel + index, sizeof(matrix_size) * moved);
+    memmove(my_highway->stations + index + 1, my_highway->stations + index, sizeof(station *) * moved);
+    update_slots(my_highway, index + 1, index + 1 + moved);
+  }
+
+  my_highway->distance[index] = new_station->distance;
+  my_highway->max_fuel[index] = new_station->car_max_fuel;
+  my_highway->stations[index] = new_station;
+  new_station->slot = index;
+
+  #ifndef NDEBUG
+  printf("\tStation inserted in position %d, new length: %d/%d\n", index, my_highway->length, my_highway->capacity);
+  #endif
+
+  #ifndef NDEBUG
+  printf("\tStations distances: ");
+  for(int i = 0; i < my_highway->length; ++i) {
+    printf("%d, ", my_highway->distance[i]);
+  }
+  printf("\n");
+  #endif
 
+  #ifndef NDEBUG
+  printf("Ending station insertion\n");
+  #endif
+
+  return 1;
+}
+
+/**
+ * @struct bulk_entry
+ * @brief Station of a bulk load, sorted by distance and then by position in the batch.
+ * 
+ * @param distance Distance of the station.
+ * @param position Index of the station in the batch.
+*/
+typedef struct bulk_entry {
+  matrix_size distance;
+  matrix_size position;
+} bulk_entry;
+
+int compare_bulk_entries(const void * a, const void * b) {
+  const bulk_entry * x = (const bulk_entry *) a, * y = (const bulk_entry *) b;
+
+  if(x->distance != y->distance) {
+    return x->distance < y->distance ? -1 : 1;
+  }
+  return (x->position > y->position) - (x->position < y->position);
+}
+
+int add_stations(highway * my_highway, station ** stations, matrix_size n_stations, matrix_size * added) {
+
+  #ifndef NDEBUG
+  printf("Starting bulk insertion of %d stations\n", n_stations);
+  #endif
+
+  if(my_highway == NULL || (n_stations > 0 && (stations == NULL || added == NULL))) {
     #ifndef NDEBUG
-    printf("\tStation inserted in position %d, new length: %d/%d\n", index, (*highway_pointer)->length, (*highway_pointer)->capacity);
+    printf("\tNULL pointer\n");
     #endif
-  } 
-  else {
+
+    return null_ptr;
+  }
+
+  bulk_entry * entries = (bulk_entry *) malloc(sizeof(bulk_entry) * (n_stations > 0 ? n_stations : 1));
+  if(entries == NULL) {
     #ifndef NDEBUG
-    printf("\tNo need to double capacity (%d/%d), inserting station\n", my_highway->length, my_highway->capacity);
+    printf("\tUnable to allocate array of entries of %ld bytes\n", sizeof(bulk_entry) * n_stations);
     #endif
-  
-    for(int i = my_highway->length; i > index; --i) {
-      my_highway->stations[i] = my_highway->stations[i - 1];
+
+    return mem_error;
+  }
+
+  matrix_size n_entries = 0;
+  for(matrix_size k = 0; k < n_stations; ++k) {
+    added[k] = 0;
+    if(stations[k] != NULL) {
+      entries[n_entries].distance = stations[k]->distance;
+      entries[n_entries++].position = k;
     }
-  
-    my_highway->stations[index] = new_station;
-    my_highway->length += 1;
+  }
 
+  qsort(entries, n_entries, sizeof(bulk_entry), compare_bulk_entries);
+
+  // Only the first station of every distance is accepted, if the distance is not already in the highway (the entries 
+  // accepted are moved before i, so entries[i - 1] is still the previous entry)
+  matrix_size accepted = 0;
+  for(matrix_size i = 0; i < n_entries; ++i) {
+    if((i == 0 || entries[i].distance != entries[i - 1].distance) && 
+        hash_find(my_highway->lookup, entries[i].distance) == NULL) {
+      entries[accepted++] = entries[i];
+    }
+  }
+
+  compact_highway(my_highway);
+
+  matrix_size length = my_highway->length + accepted;
+  matrix_size capacity = length > 2 * my_highway->capacity ? length : 2 * my_highway->capacity;
+  if(length > my_highway->capacity && !reserve_highway(my_highway, capacity)) {
     #ifndef NDEBUG
-    printf("\tStation inserted in position %d, new length: %d/%d\n", index, my_highway->length, my_highway->capacity);
+    printf("\tUnable to reserve %d stations\n", capacity);
     #endif
+
+    free(entries);
+    return mem_error;
   }
 
-  #ifndef NDEBUG
-  printf("\tStations distances: ");
-  for(int i = 0; i < (*highway_pointer)->length; ++i) {
-    printf("%d, ", (*highway_pointer)->stations[i]->distance);
+  if(!hash_reserve(my_highway->lookup, length)) {
+    free(entries);
+    return mem_error;
+  }
+
+  // The arrays are merged from the end, so every station of the highway is moved at most once
+  matrix_size i = my_highway->length, j = accepted, k = length;
+  while(j > 0) {
+    station * next = stations[entries[j - 1].position];
+    --k;
+
+    if(i > 0 && my_highway->distance[i - 1] > next->distance) {
+      --i;
+      my_highway->distance[k] = my_highway->distance[i];
+      my_highway->max_fuel[k] = my_highway->max_fuel[i];
+      my_highway->stations[k] = my_highway->stations[i];
+      if(my_highway->stations[k] != NULL) {
+        my_highway->stations[k]->slot = k;
+      }
+    }
+    else {
+      --j;
+      my_highway->distance[k] = next->distance;
+      my_highway->max_fuel[k] = next->car_max_fuel;
+      my_highway->stations[k] = next;
+      next->slot = k;
+
+      hash_insert(my_highway->lookup, next);
+      added[entries[j].position] = 1;
+    }
   }
-  printf("\n");
-  #endif
+
+  my_highway->length = length;
+  free(entries);
 
   #ifndef NDEBUG
-  printf("Ending station insertion\n");
+  printf("\t%d stations inserted, new length: %d/%d\n", accepted, my_highway->length, my_highway->capacity);
+  printf("Ending bulk insertion\n");
   #endif
 
-  return 1;
+  return accepted;
 }
 
 matrix_size remove_station(highway * my_highway, matrix_size distance) {
@@ -406,8 +825,8 @@ matrix_size remove_station(highway * my_highway, matrix_size distance) {
       return 0;
     }
 
-    matrix_size index = bin_search(my_highway->stations, 0, my_highway->length - 1, distance);
-    if(my_highway->stations[index]->distance != distance) {
+    int index = station_index(my_highway, distance);
+    if(index < 0) {
 
       #ifndef NDEBUG
       printf("\tStation at distance %d not found\n", distance);
@@ -422,15 +841,30 @@ matrix_size remove_station(highway * my_highway, matrix_size distance) {
 
     station * tmp = my_highway->stations[index];
 
-    while(index < my_highway->length - 1) {
-        my_highway->stations[index] = my_highway->stations[index + 1];
-        ++index;
+    // The slot becomes a tombstone (its distance is kept, so the distances stay ordered), unless it is the last one:
+    // then it is dropped together with the tombstones before it
+    my_highway->stations[index] = NULL;
+    my_highway->max_fuel[index] = 0;
+
+    if(index == my_highway->length - 1) {
+      --my_highway->length;
+      while(my_highway->length > 0 && my_highway->stations[my_highway->length - 1] == NULL) {
+        --my_highway->length;
+        --my_highway->tombstones;
+      }
+    }
+    else {
+      ++my_highway->tombstones;
     }
 
-    --my_highway->length; 
+    hash_remove(my_highway->lookup, distance);
 
     delete_station(tmp);
 
+    if((size_t) my_highway->tombstones * 100 > (size_t) my_highway->length * HIGHWAY_MAX_TOMBSTONES) {
+      compact_highway(my_highway);
+    }
+
     #ifndef NDEBUG
     printf("\tStation removed and deallocated\n");
     #endif
@@ -464,8 +898,8 @@ station * find_station(const highway * highway, matrix_size distance) {
     return NULL;
   }
 
-  matrix_size index = bin_search(highway->stations, 0, highway->length - 1, distance);
-  if(index < 0 || index >= highway->length || highway->stations[index]->distance != distance) {
+  station * found = hash_find(highway->lookup, distance);
+  if(found == NULL) {
     #ifndef NDEBUG
     printf("\tStation at distance %d not found\n", distance);
     #endif
@@ -474,21 +908,83 @@ station * find_station(const highway * highway, matrix_size distance) {
   }
 
   #ifndef NDEBUG
-  printf("\tStation at distance %d found at index %d\n", distance, index);
+  printf("\tStation at distance %d found\n", distance);
   printf("Ending station search\n");
   #endif
 
-  return highway->stations[index];
+  return found;
 }
 
 
+/**
+ * @brief Find the run of a fuel in a station.
+ * 
+ * @returns The index of the first run whose fuel is not less than fuel (station->n_runs if there is none).
+ * 
+ * @note T(r) = O(log(r)).
+*/
+matrix_size find_run(const station * station, matrix_size fuel) {
+  matrix_size a = 0, b = station->n_runs;
+
+  while(a < b) {
+    matrix_size m = a + (b - a) / 2;
+
+    if(station->runs[m].fuel < fuel) {
+      a = m + 1;
+    }
+    else {
+      b = m;
+    }
+  }
+
+  return a;
+}
+
+/**
+ * @brief Change the capacity of the runs of a station.
+ * 
+ * The inline runs and the runs of a pooled station are copied to a new array; the others are reallocated.
+ * 
+ * @returns 1 if the capacity is changed; 0 if there is not enough memory (the station is unchanged).
+ * 
+ * @note A pooled station can get more runs than capacity (see pool_alloc_runs).
+*/
+matrix_size resize_station(station * station, matrix_size capacity) {
+  matrix_size granted = capacity;
+  fuel_run * runs = NULL;
+
+  if(station->runs != station->inline_runs && station->pool == NULL) {
+    runs = (fuel_run *) realloc(station->runs, sizeof(fuel_run) * capacity);
+  }
+  else {
+    runs = alloc_runs(station->pool, capacity, &granted);
+    if(runs != NULL) {
+      memcpy(runs, station->runs, sizeof(fuel_run) * station->n_runs);
+      free_runs(station);
+    }
+  }
+
+  if(runs == NULL) {
+    #ifndef NDEBUG
+    printf("\tUnable to resize runs array to %d runs\n", capacity);
+    #endif
+
+    return 0;
+  }
+
+  station->runs = runs;
+  station->capacity = granted;
+
+  return 1;
+}
+
 matrix_size add_car(station * station, matrix_size fuel) {
   
   #ifndef NDEBUG
   printf("Starting car insertion\n");
   #endif
 
-  if(station == NULL || station->cars == NULL) {
+  if(station == NULL || station->runs == NULL) {
     #ifndef NDEBUG
     printf("\tNULL pointer\n");
     #endif
@@ -496,63 +992,184 @@ matrix_size add_car(station * station, matrix_size fuel) {
     return 0;
   }
 
-  if(station->length == station->capacity) {
+  matrix_size i = find_run(station, fuel);
+
+  if(i < station->n_runs && station->runs[i].fuel == fuel) {
+    ++station->runs[i].count;
+
     #ifndef NDEBUG
-    printf("\tArray full (%d/%d), attempting to double capacity\n", station->length, station->capacity);
+    printf("\tCar added to run %d, %d cars with fuel %d\n", i, station->runs[i].count, fuel);
     #endif
-
-    matrix_size* new_cars = (matrix_size *) malloc(sizeof(matrix_size) * station->capacity * 2);
-    if(new_cars == NULL) {
+  }
+  else {
+    if(station->n_runs == station->capacity) {
       #ifndef NDEBUG
-      printf("\tUnable to double capacity\n");
+      printf("\tArray full (%d/%d), attempting to double capacity\n", station->n_runs, station->capacity);
       #endif
 
-      return 0;
+      if(!resize_station(station, station->capacity * 2)) {
+        return 0;
+      }
     }
 
+    memmove(station->runs + i + 1, station->runs + i, sizeof(fuel_run) * (station->n_runs - i));
+    station->runs[i].fuel = fuel;
+    station->runs[i].count = 1;
+    ++station->n_runs;
+
     #ifndef NDEBUG
-    printf("\tCapacity doubled, inserting new car\n");
+    printf("\tRun of fuel %d inserted in position %d, new length: %d/%d\n", fuel, i, station->n_runs, station->capacity);
     #endif
+  }
+
+  ++station->length;
+  station->car_max_fuel = station->runs[station->n_runs - 1].fuel;
+
+  #ifndef NDEBUG
+  printf("Ending car insertion\n");
+  #endif
+
+  return 1;
+}
+
+/**
+ * Lists of fuels shorter than this are sorted by insertion sort.
+*/
+#define RADIX_THRESHOLD 64
 
-    for(matrix_size i = 0; i < station->length; ++i) {
-      new_cars[i] = station->cars[i];
+/**
+ * @brief Sort a list of fuels by LSD radix sort, a byte at a time.
+ * 
+ * @param fuels The fuels to sort.
+ * @param buffer Array of n_fuels elements used to move the fuels.
+ * @param n_fuels Number of fuels.
+ * 
+ * @note T(n) = O(n).
+*/
+void sort_fuels(matrix_size * fuels, matrix_size * buffer, matrix_size n_fuels) {
+  if(n_fuels < RADIX_THRESHOLD) {
+    for(matrix_size i = 1; i < n_fuels; ++i) {
+      matrix_size fuel = fuels[i], j = i;
+      for(; j > 0 && fuels[j - 1] > fuel; --j) {
+        fuels[j] = fuels[j - 1];
+      }
+      fuels[j] = fuel;
     }
-    new_cars[station->length] = fuel;
 
-    station->capacity *= 2;
-    ++station->length;
-    if(fuel > station->car_max_fuel) {
-      station->car_max_fuel = fuel;
+    return;
+  }
+
+  matrix_size * from = fuels, * to = buffer;
+
+  // 4 passes (an even number), so the sorted fuels end in fuels
+  for(matrix_size shift = 0; shift < 32; shift += 8) {
+    matrix_size counts[256] = {0};
+
+    for(matrix_size i = 0; i < n_fuels; ++i) {
+      ++counts[(from[i] >> shift) & 0xFF];
+    }
+    for(matrix_size d = 0, position = 0; d < 256; ++d) {
+      matrix_size count = counts[d];
+      counts[d] = position;
+      position += count;
+    }
+    for(matrix_size i = 0; i < n_fuels; ++i) {
+      to[counts[(from[i] >> shift) & 0xFF]++] = from[i];
     }
 
-    free(station->cars);
-    station->cars = new_cars;
-    
+    matrix_size * swap = from;
+    from = to;
+    to = swap;
+  }
+}
+
+matrix_size add_cars(station * station, const matrix_size * fuels, matrix_size n_cars) {
+  
+  #ifndef NDEBUG
+  printf("Starting insertion of %d cars\n", n_cars);
+  #endif
+
+  if(station == NULL || station->runs == NULL || (fuels == NULL && n_cars > 0)) {
     #ifndef NDEBUG
-    printf("\tCar inserted in position %d, new length: %d/%d\n", station->length - 1, station->length, station->capacity);
+    printf("\tNULL pointer\n");
     #endif
+
+    return 0;
   }
-  else {
+
+  if(n_cars == 0) {
+    return 1;
+  }
+
+  matrix_size * sorted = (matrix_size *) malloc(sizeof(matrix_size) * n_cars * 2);
+  if(sorted == NULL) {
     #ifndef NDEBUG
-    printf("\tNo need to double capacity (%d/%d), appending new car\n", station->length, station->capacity);
+    printf("\tUnable to allocate sorting arrays of %ld bytes\n", sizeof(matrix_size) * n_cars * 2);
     #endif
 
-    station->cars[station->length++] = fuel;
-    if(fuel > station->car_max_fuel) {
-      station->car_max_fuel = fuel;
+    return 0;
+  }
 
-      #ifndef NDEBUG
-      printf("\tMax fuel updated at %d\n", station->car_max_fuel);
-      #endif
+  // After sorting, the distinct fuels are compacted at the start of sorted, and their counts are put in counts
+  matrix_size * counts = sorted + n_cars;
+  memcpy(sorted, fuels, sizeof(matrix_size) * n_cars);
+  sort_fuels(sorted, counts, n_cars);
+
+  matrix_size new_runs = 0;
+  for(matrix_size i = 0; i < n_cars; ++i) {
+    if(new_runs > 0 && sorted[new_runs - 1] == sorted[i]) {
+      ++counts[new_runs - 1];
+    }
+    else {
+      sorted[new_runs] = sorted[i];
+      counts[new_runs++] = 1;
+    }
+  }
+
+  matrix_size merged = station->n_runs + new_runs;
+  for(matrix_size i = 0, j = 0; i < station->n_runs && j < new_runs; ) {
+    if(station->runs[i].fuel == sorted[j]) {
+      --merged;
+      ++i;
+      ++j;
+    }
+    else if(station->runs[i].fuel < sorted[j]) {
+      ++i;
+    }
+    else {
+      ++j;
+    }
+  }
+
+  if(merged > station->capacity && !resize_station(station, merged)) {
+    free(sorted);
+    return 0;
+  }
+
+  // The runs are merged from the last, so the runs of the station are moved only once
+  int i = station->n_runs - 1, j = new_runs - 1, k = merged - 1;
+  while(j >= 0) {
+    if(i >= 0 && station->runs[i].fuel > sorted[j]) {
+      station->runs[k--] = station->runs[i--];
+    }
+    else if(i >= 0 && station->runs[i].fuel == sorted[j]) {
+      station->runs[k] = station->runs[i--];
+      station->runs[k--].count += counts[j--];
+    }
+    else {
+      station->runs[k].fuel = sorted[j];
+      station->runs[k--].count = counts[j--];
     }
-    
-    #ifndef NDEBUG
-    printf("\tCar inserted in position %d, new length: %d/%d\n", station->length - 1, station->length, station->capacity);
-    #endif
   }
 
+  station->n_runs = merged;
+  station->length += n_cars;
+  station->car_max_fuel = station->runs[merged - 1].fuel;
+
+  free(sorted);
+
   #ifndef NDEBUG
-  printf("Ending car insertion\n");
+  printf("Ending insertion of cars (%d runs)\n", merged);
   #endif
 
   return 1;
@@ -563,7 +1180,7 @@ matrix_size remove_car(station * station, matrix_size fuel) {
   printf("Starting car removal\n");
   #endif
 
-  if(station == NULL || station->cars == NULL) {
+  if(station == NULL || station->runs == NULL) {
     #ifndef NDEBUG
     printf("\tNULL pointer\n");
     #endif
@@ -571,24 +1188,9 @@ matrix_size remove_car(station * station, matrix_size fuel) {
     return 0;
   }
 
-  if(station->length == 0) {
-    #ifndef NDEBUG
-    printf("\tNo car to remove\n");
-    #endif
-
-    return 0;
-  }
-
-  #ifndef NDEBUG
-  printf("\tStarting car search\n");
-  #endif
-
-  matrix_size i = 0;
-  while(i < station->length && station->cars[i] != fuel) {
-    ++i;
-  }
+  matrix_size i = find_run(station, fuel);
 
-  if(i == station->length) {
+  if(i == station->n_runs || station->runs[i].fuel != fuel) {
     #ifndef NDEBUG
     printf("\tCar with fuel %d not found\n", fuel);
     #endif
@@ -597,31 +1199,19 @@ matrix_size remove_car(station * station, matrix_size fuel) {
   } 
 
   #ifndef NDEBUG
-  printf("\tCar with fuel %d found at index %d, proceding with removal\n", fuel, i);
+  printf("\tCar with fuel %d found in run %d, proceding with removal\n", fuel, i);
   #endif
 
-  station->cars[i] = station->cars[--station->length];
-
-  if(fuel == station->car_max_fuel) {
-    #ifndef NDEBUG
-    printf("\tUpdating max fuel\n");
-    #endif
-
-    station->car_max_fuel = 0;
-    
-    for(i = 0; i < station->length; ++i) {
-      if(station->cars[i] > station->car_max_fuel) {
-        station->car_max_fuel = station->cars[i];
-      }
-    }
-
-    #ifndef NDEBUG
-    printf("\tMax fuel updated at %d\n", station->car_max_fuel);
-    #endif
+  if(--station->runs[i].count == 0) {
+    memmove(station->runs + i, station->runs + i + 1, sizeof(fuel_run) * (station->n_runs - i - 1));
+    --station->n_runs;
   }
 
+  --station->length;
+  station->car_max_fuel = station->n_runs > 0 ? station->runs[station->n_runs - 1].fuel : 0;
+
   #ifndef NDEBUG
-  printf("\tCar removed -> new length: %d/%d\n", station->length, station->capacity);
+  printf("\tCar removed -> %d cars in %d/%d runs\n", station->length, station->n_runs, station->capacity);
   printf("Ending car removal\n");
   #endif
 
@@ -634,12 +1224,17 @@ matrix_size add_car_by_distance(highway * my_highway, matrix_size distance, matr
   printf("Starting car insertion by distance\n");
   #endif
 
-  station * station = find_station(my_highway, distance);
-  if(station == NULL) {
+  station * found = my_highway == NULL ? NULL : hash_find(my_highway->lookup, distance);
+  if(found == NULL) {
     return 0;
   }
 
-  matrix_size result = add_car(station, fuel); 
+  matrix_size max_fuel = found->car_max_fuel;
+  matrix_size result = add_car(found, fuel); 
+
+  if(found->car_max_fuel != max_fuel) {
+    my_highway->max_fuel[found->slot] = found->car_max_fuel;
+  }
 
   #ifndef NDEBUG
   printf("Ending car insertion by distance\n");
@@ -653,12 +1248,17 @@ matrix_size remove_car_by_distance(highway * my_highway, matrix_size distance, m
   printf("Starting car removal by distance\n");
   #endif
 
-  station * station = find_station(my_highway, distance);
-  if(station == NULL) {
+  station * found = my_highway == NULL ? NULL : hash_find(my_highway->lookup, distance);
+  if(found == NULL) {
     return 0;
   }
 
-  matrix_size result = remove_car(station, fuel); 
+  matrix_size max_fuel = found->car_max_fuel;
+  matrix_size result = remove_car(found, fuel); 
+
+  if(found->car_max_fuel != max_fuel) {
+    my_highway->max_fuel[found->slot] = found->car_max_fuel;
+  }
 
   #ifndef NDEBUG
   printf("Ending car removal by distance\n");
@@ -692,8 +1292,8 @@ int extract_stations(const highway * highway, matrix_size start, matrix_size end
     return no_solution;
   }
 
-  matrix_size i = bin_search(highway->stations, 0, highway->length - 1, start);
-  if(highway->stations[i]->distance != start) {
+  int i = station_index(highway, start);
+  if(i < 0) {
     #ifndef NDEBUG
     printf("\tStart station not found\n");
     #endif
@@ -704,8 +1304,8 @@ int extract_stations(const highway * highway, matrix_size start, matrix_size end
   printf("\tStart station found at index %d\n", i);
   #endif
 
-  matrix_size j = bin_search(highway->stations, 0, highway->length - 1, end);
-  if(highway->stations[j]->distance != end) {
+  int j = station_index(highway, end);
+  if(j < 0) {
     #ifndef NDEBUG
     printf("\tEnd station not found\n");
     #endif
@@ -742,9 +1342,19 @@ int extract_stations(const highway * highway, matrix_size start, matrix_size end
   printf("Proceding with extraction\n");
   #endif
   
-  for(int k = i; k <= j; ++k) {
-    actual_stations[k - i] = highway->stations[k]->distance; 
-    actual_cars[k - i] = highway->stations[k]->car_max_fuel;
+  int extracted = j - i + 1;
+  if(highway->tombstones == 0) {
+    memcpy(actual_stations, highway->distance + i, sizeof(matrix_size) * extracted);
+    memcpy(actual_cars, highway->max_fuel + i, sizeof(matrix_size) * extracted);
+  }
+  else {
+    extracted = 0;
+    for(int k = i; k <= j; ++k) {
+      if(highway->stations[k] != NULL) {
+        actual_stations[extracted] = highway->distance[k];
+        actual_cars[extracted++] = highway->max_fuel[k];
+      }
+    }
   }
 
   *stations_p = actual_stations;
@@ -755,7 +1365,7 @@ int extract_stations(const highway * highway, matrix_size start, matrix_size end
   printf("Ending stations extraction by distance\n");
   #endif
 
-  return (j - i + 1);
+  return extracted;
 }
 
 void test_extract_stations() {
@@ -779,20 +1389,20 @@ void test_extract_stations() {
   add_car(s7, 10);
   station * s8 = create_station(1, 34);
 
-  printf("Insertion 1: %d\n", add_station(&highway_2, s1));
-  printf("Insertion 2: %d\n", add_station(&highway_2, s2));
+  printf("Insertion 1: %d\n", add_station(highway_2, s1));
+  printf("Insertion 2: %d\n", add_station(highway_2, s2));
   add_car_by_distance(highway_2, s2->distance, 9);
-  printf("Insertion 3: %d\n", add_station(&highway_2, s3));
+  printf("Insertion 3: %d\n", add_station(highway_2, s3));
   add_car_by_distance(highway_2, s3->distance, 4);
   add_car_by_distance(highway_2, s3->distance, 2);
-  printf("Insertion 4: %d\n", add_station(&highway_2, s4));
-  printf("Insertion 5: %d\n", add_station(&highway_2, s5));
+  printf("Insertion 4: %d\n", add_station(highway_2, s4));
+  printf("Insertion 5: %d\n", add_station(highway_2, s5));
   add_car_by_distance(highway_2, s5->distance, 4);
   add_car_by_distance(highway_2, s5->distance, 5);
   add_car_by_distance(highway_2, s5->distance, 6);
-  printf("Insertion 6: %d\n", add_station(&highway_2, s6));
-  printf("Insertion 7: %d\n", add_station(&highway_2, s7));
-  printf("Insertion 8: %d\n", add_station(&highway_2, s8));
+  printf("Insertion 6: %d\n", add_station(highway_2, s6));
+  printf("Insertion 7: %d\n", add_station(highway_2, s7));
+  printf("Insertion 8: %d\n", add_station(highway_2, s8));
   add_car_by_distance(highway_2, s8->distance, 1);
 
   matrix_size * station_extracted;
@@ -866,49 +1476,79 @@ int plan_path(const highway * highway, matrix_size start, matrix_size end, direc
     return null_ptr;
   }
 
-  matrix_size * stations, * cars;
+  if(highway->stations == NULL) {
+    #ifndef NDEBUG
+    printf("\tNULL pointer\n");
+    #endif
 
-  int n_stations = 0;
-  if(dir == forward) {
-    n_stations = extract_stations(highway, start, end, &stations, &cars);
-  }
-  else {
-    n_stations = extract_stations(highway, end, start, &stations, &cars);
+    return null_ptr;
   }
 
-  if(n_stations < 0) {
+  // The route goes from the nearest station to the furthest, and backward routes are read reversed by the solver
+  matrix_size first = dir == forward ? start : end, last = dir == forward ? end : start;
+  int i = station_index(highway, first), j = station_index(highway, last);
+
+  if(first > last || i < 0 || j < 0) {
     #ifndef NDEBUG
     printf("\tAborting plan path\n");
     #endif
 
-    return n_stations;
+    return no_solution;
   }
 
+  station_view view = {highway->distance, highway->max_fuel, i, j - i + 1};
+
   #ifndef NDEBUG
-  printf("\tSTATION:CAR -> ");
-  
-  for(int i = 0; i < n_stations; ++i) {
-    #ifndef NDEBUG
-    printf("%d:%d ", stations[i], cars[i]);
-    #endif
-  }
-  printf("\n\tMax fuel: %d\n", max_fuel);
+  printf("\tLaunching solve on stations from index %d to index %d\n", i, j);
   #endif
+  int min_stops = solve_view(&view, dir, solution);
 
   #ifndef NDEBUG
-  printf("\tLaunching solve\n");
+  printf("Ending plan path\n");
   #endif
-  int min_stops = solve(stations, n_stations, cars, dir, solution);
+
+  return min_stops;
+}
+
+int plan_path_batch(const highway * highway, const path_query * queries, matrix_size n_queries, path_result * results) {
+
+  #ifndef NDEBUG
+  printf("Starting plan path batch of %d queries\n", n_queries);
+  #endif
+
+  if(highway == NULL || highway->stations == NULL || queries == NULL || results == NULL) {
+    #ifndef NDEBUG
+    printf("\tNULL pointer\n");
+    #endif
+
+    return null_ptr;
+  }
+
+  matrix_size n_solved = 0;
+  for(matrix_size q = 0; q < n_queries; ++q) {
+    results[q].stops = no_solution;
+    results[q].solution = NULL;
+
+    int i = station_index(highway, queries[q].start);
+    int j = station_index(highway, queries[q].end);
+    if(i < 0 || j < 0) {
+      continue;
+    }
+
+    station_view view = {highway->distance, highway->max_fuel, i < j ? i : j, (i < j ? j - i : i - j) + 1};
+    direction dir = queries[q].start > queries[q].end ? backward : forward;
+
+    results[q].stops = solve_view(&view, dir, &results[q].solution);
+    ++n_solved;
+  }
 
   #ifndef NDEBUG
-  printf("\tFreeing resources\n");
+  printf("\t%d queries with both stations in the highway\n", n_solved);
   #endif
-  free(stations);
-  free(cars);
 
   #ifndef NDEBUG
-  printf("Ending plan path\n");
+  printf("Ending plan path batch\n");
   #endif
 
-  return min_stops;
-}
\ No newline at end of file
+  return n_queries;
+}
@@ -8,44 +8,140 @@
 
 #include "solver.h"
 
+/**
+ * Number of runs stored inside a station: the cars of a station with at most STATION_INLINE_RUNS distinct fuels need no 
+ * other memory.
+*/
+#define STATION_INLINE_RUNS 3
+
+/**
+ * Percent of tombstones in the arrays of an highway above which remove_station compacts them.
+*/
+#define HIGHWAY_MAX_TOMBSTONES 25
+
+/**
+ * Number of slots on either side of its position in which add_station looks for a tombstone, before it spreads the 
+ * stations around the position to make one (see add_station).
+*/
+#define HIGHWAY_SEGMENT 64
+
+/**
+ * Percent of tombstones left by add_station when it has to spread the stations of the whole highway (less than 
+ * HIGHWAY_MAX_TOMBSTONES, so the next removals do not compact them).
+*/
+#define HIGHWAY_SPREAD_TOMBSTONES 12
+
+struct station_pool;
+struct station_hash;
+
+/**
+ * @struct fuel_run
+ * @brief Cars of a station with the same fuel.
+ * 
+ * @param fuel Fuel of the cars.
+ * @param count Number of cars with this fuel.
+*/
+typedef struct fuel_run {
+    matrix_size fuel;
+    matrix_size count;
+} fuel_run;
+
 /**
  * @struct station 
  * @brief Rapresents and stores station informations.
  * 
- * Struct which stores all the elements of a station.
+ * Struct which stores all the elements of a station. The cars are stored as a multiset of fuels: a run for every 
+ * distinct fuel, increasingly ordered, so a car is found by binary search and the max fuel is the one of the last run.
+ * The first STATION_INLINE_RUNS runs are stored in the station itself; only a station with more distinct fuels moves 
+ * its runs to an array on heap (taken from the pool of the station, if it has one).
  * 
  * @param distance Distance of a station from the start of the highway.
- * @param cars Fuel of the cars contained in the station.
- * @param capacity Maximum capacity of the dynamic array cars.
- * @param length Actual length of the dynamic array cars.
- * @param car_max_fuel Max fuel among all the cars.
+ * @param runs Runs of the cars contained in the station, ordered by fuel (inline_runs until they do not fit in it).
+ * @param capacity Maximum capacity of the dynamic array runs.
+ * @param n_runs Actual length of the dynamic array runs (number of distinct fuels).
+ * @param length Number of cars of the station.
+ * @param car_max_fuel Max fuel among all the cars (0 if there is no car).
+ * @param slot Index of the station in the arrays of its highway (meaningful only while the station is in an highway).
+ * @param pool Pointer to the pool the station and its runs are allocated from (NULL if they are allocated on heap).
+ * @param inline_runs Runs stored in the station.
  * 
 */
 typedef struct station {
     matrix_size distance;
-    matrix_size * cars;
+    fuel_run * runs;
     matrix_size capacity;
+    matrix_size n_runs;
     matrix_size length;
     matrix_size car_max_fuel;
+    matrix_size slot;
+    struct station_pool * pool;
+    fuel_run inline_runs[STATION_INLINE_RUNS];
 } station;
 
 /**
  * @struct highway 
  * @brief Rapresents and stores highway informations.
  * 
- * Struct which stores all the elements of an highway.
+ * Struct which stores all the elements of an highway, as parallel arrays ordered by distance: the distances and the
+ * max fuels read by searches and plans are contiguous, while the cars stay in the stations, read only when they change.
  * 
+ * A removed station leaves a tombstone: its slot keeps the distance, to keep the arrays ordered, with a NULL station and 
+ * max fuel 0, which no plan can stop at. Tombstones are reused by the stations added next to them and removed all 
+ * together by compact_highway.
+ * 
+ * The arrays are a packed memory array: when there is no tombstone near the position of a new station, add_station 
+ * spreads the stations of the smallest aligned window around it which is not too full, leaving tombstones evenly 
+ * between them (each with the distance of the station before it), so an insertion moves O(log^2(n)) stations 
+ * amortized instead of all the stations after it.
+ * 
+ * @param distance Distances of the stations contained in the highway.
+ * @param max_fuel Max fuel among the cars of every station (a copy of station->car_max_fuel).
  * @param stations Pointer to the stations contained in the highway.
- * @param capacity Maximum capacity of the dynamic array *stations.
- * @param length Actual length of the dynamic array *stations.
+ * @param capacity Maximum capacity of the dynamic arrays.
+ * @param length Actual length of the dynamic arrays (tombstones included).
+ * @param tombstones Number of tombstones in the dynamic arrays.
+ * @param pool Pointer to the pool of the stations created by create_pooled_station (see station_pool.h).
+ * @param lookup Pointer to the hash table from the distances to the stations (see station_hash.h), kept in sync by 
+ *        add_station and remove_station.
+ * 
+ * @note The cars of a station in the highway must be changed with add_car_by_distance and remove_car_by_distance, 
+ *       which keep max_fuel up to date.
 */
 typedef struct highway {
+    matrix_size * distance;
+    matrix_size * max_fuel;
     station ** stations;
     matrix_size capacity;
     matrix_size length;
+    matrix_size tombstones;
+    struct station_pool * pool;
+    struct station_hash * lookup;
 } highway;
 
-void test_binary_search();
+/**
+ * @struct path_query
+ * @brief Stores a query of a batch of plans.
+ * 
+ * @param start Distance of the station to use as start.
+ * @param end Distance of the station to use as end (the direction is backward if end < start).
+*/
+typedef struct path_query {
+    matrix_size start;
+    matrix_size end;
+} path_query;
+
+/**
+ * @struct path_result
+ * @brief Stores the answer to a query of a batch of plans.
+ * 
+ * @param stops The minimum number of stops if a solution is avaible; an element of enum result otherwise.
+ * @param solution Distances of the stations of the solution (allocated on heap, NULL if there is no solution).
+*/
+typedef struct path_result {
+    int stops;
+    matrix_size * solution;
+} path_result;
+
 void test_extract_stations();
 
 /**
@@ -56,6 +152,8 @@ void test_extract_stations();
  * @post highway.capacity = capacity.
  * @post highway.length = 0.
  * @post stations is a pointer to an array of capacity pointers (initializated to NULL).
+ * @post pool is an empty station pool.
+ * @post lookup is an empty station hash which holds capacity stations.
  * 
  * @return A pointer to the highway allocated on heap.
  * 
@@ -66,6 +164,8 @@ highway * create_highway (matrix_size capacity);
  * @brief Delete an highway struct.
  * 
  * @param highway Pointer to the highway to delete.
+ * 
+ * @post The stations of the highway and its pool are deallocated.
 */
 void delete_highway(highway * highway);
 
@@ -75,15 +175,33 @@ void delete_highway(highway * highway);
  * Create a new station with given distance and capacity.
  * 
  * @param distance Distance of the station from the start of the highway.
- * @param capacity Initial capacity oh the station.
+ * @param capacity Initial capacity oh the station (number of distinct fuels).
  * 
  * @returns A pointer to the stations if it is created successfully, NULL otherwise.
+ * 
+ * @note No array of runs is allocated if capacity <= STATION_INLINE_RUNS.
 */
 station * create_station(matrix_size distance, matrix_size capacity);
+/**
+ * @brief Create a new station from the pool of an highway.
+ * 
+ * The station is carved from a slab of the pool instead of being allocated on its own, and the runs which do not fit 
+ * in it are taken from the pool too (see station_pool.h).
+ * 
+ * @param highway Pointer to the highway which owns the pool.
+ * @param distance Distance of the station from the start of the highway.
+ * @param capacity Initial capacity oh the station (number of distinct fuels).
+ * 
+ * @returns A pointer to the stations if it is created successfully, NULL otherwise.
+ * 
+ * @note The station can be added only to highway, and it must be deleted (by delete_station or by removing it from 
+ *       highway) before highway is deleted.
+*/
+station * create_pooled_station(highway * highway, matrix_size distance, matrix_size capacity);
 /**
  * @brief Delete a station.
  * 
- * Deallocate the station from the heap.
+ * Deallocate the station from the heap, or give it back to its pool.
  * 
  * @param station Pointer to the station to deallocate.
  * 
@@ -91,21 +209,91 @@ station * create_station(matrix_size distance, matrix_size capacity);
 */
 void delete_station(station * station);
 
+/**
+ * @brief Make room for at least capacity stations in an highway.
+ * 
+ * @param highway Pointer to the highway.
+ * @param capacity Number of stations the highway must hold without growing.
+ * 
+ * @return 1 if the highway can hold capacity stations; 0 otherwise (the highway is unchanged).
+ * 
+ * @note The array of stations is grown in place: the address of the highway does not change.
+ * @note The hash table of the highway is grown to hold capacity stations too.
+*/
+matrix_size reserve_highway(highway * highway, matrix_size capacity);
+/**
+ * @brief Reduce the capacity of an highway to its number of stations (at least 1), releasing the memory left by 
+ * demolitions.
+ * 
+ * @param highway Pointer to the highway.
+ * 
+ * @return 1 if the capacity is reduced (or it is already the smallest); 0 otherwise (the highway is unchanged).
+ * 
+ * @note The tombstones are compacted first.
+*/
+matrix_size shrink_highway_to_fit(highway * highway);
+/**
+ * @brief Remove the tombstones of an highway, moving every station next to the previous one.
+ * 
+ * @param highway Pointer to the highway.
+ * 
+ * @return The number of tombstones removed.
+ * 
+ * @note T(n) = O(n), in a single pass over the arrays.
+*/
+matrix_size compact_highway(highway * highway);
+
+/**
+ * @brief Check if an highway has more tombstones than add_station leaves when it spreads the stations.
+ * 
+ * @param highway Pointer to the highway.
+ * 
+ * @return 1 if more than HIGHWAY_SPREAD_TOMBSTONES percent of the slots of the highway are tombstones, 0 otherwise.
+ * 
+ * @note The tombstones left by add_station make the next insertions cheap, so they are worth compacting only when the 
+ *       demolitions left more of them.
+*/
+matrix_size sparse_highway(const highway * highway);
+
 /**
  * @brief Add a station to an highway.
  * 
- * @param highway The address of a pointer to the highway which will add the station.
+ * @param highway Pointer to the highway which will add the station.
  * @param station A pointer to the station to add.
  * 
  * @post Highway takes ownership of station. 
  * 
  * @return 1 if the station is added successfully; 0 otherwise.
  * 
- * @note If the highway is full (highway->length == highway->capacity), his capacity is doubled.
+ * @note If the highway is full (highway->length == highway->capacity), his capacity is doubled in place, so the 
+ *       address of the highway never changes.
  * @note Stations are stored increasingly ordered.
  * @note There cannot be more than one station at the same distance.
+ * @note A tombstone next to the position of the station is reused, and otherwise only the stations up to the nearest 
+ *       tombstone (before or after it) are moved. If there is no tombstone within HIGHWAY_SEGMENT slots, the stations 
+ *       of a window around the position are spread first (see highway), so T(n) = O(log^2(n)) amortized.
+*/
+matrix_size add_station(highway * highway, station * station);
+/**
+ * @brief Add a batch of stations to an highway.
+ * 
+ * The batch is sorted once by distance and merged with the stations of the highway in a single pass from the end, 
+ * instead of searching and moving the stations for each one as add_station does.
+ * 
+ * @param highway Pointer to the highway.
+ * @param stations Pointer to the stations to add (NULL entries are skipped).
+ * @param n_stations Number of stations of the batch.
+ * @param added Pointer to an array of n_stations elements, where added[k] is set to 1 if stations[k] is added and to 0 
+ *        otherwise.
+ * 
+ * @returns The number of stations added; an element of enum result otherwise (the highway is unchanged).
+ * 
+ * @note Every station added belongs to the highway, the others must be deleted by the caller.
+ * @note A station is not added if its distance is already in the highway or belongs to a station before it in the 
+ *       batch, so the result is the same of add_station called on every station in order.
+ * @note The tombstones are compacted first. T(n, m) = O(n + m*log(m)), with m the stations of the batch.
 */
-matrix_size add_station(highway ** highway, station * station);
+int add_stations(highway * highway, station ** stations, matrix_size n_stations, matrix_size * added);
 /**
  * @brief Remove a station from an highway.
  * 
@@ -115,6 +303,9 @@ matrix_size add_station(highway ** highway, station * station);
  * @post The station is not in the highway. 
  * 
  * @return 1 if the station is removed successfully; 0 otherwise.
+ * 
+ * @note The slot of the station becomes a tombstone, so no station is moved (T(n) = O(log(n))); when the tombstones are 
+ *       more than HIGHWAY_MAX_TOMBSTONES percent of the slots, they are compacted (amortized O(1) per removal).
 */
 matrix_size remove_station(highway * highway, matrix_size distance);
 /**
@@ -125,7 +316,7 @@ matrix_size remove_station(highway * highway, matrix_size distance);
  * 
  * @return A pointer to station if the station is found successfully; NULL otherwise.
  * 
- * @note Performs binary search to find the station (T(n) = O(log(n))).
+ * @note The station is found in the hash table of the highway, in O(1) expected time.
 */
 station * find_station(const highway * highway, matrix_size distance);
 
@@ -137,9 +328,22 @@ station * find_station(const highway * highway, matrix_size distance);
  * 
  * @return 1 if the car is added successfully; 0 otherwise.
  * 
- * @note If the station is full (station->length == station->capacity), his capacity is doubled.
+ * @note The run of fuel is found in T(r) = O(log(r)), where r is the number of distinct fuels; a new fuel moves the runs 
+ *       after it, and doubles the capacity of the station if it is full (station->n_runs == station->capacity).
 */
 matrix_size add_car(station * station, matrix_size fuel);
+/**
+ * @brief Add a list of cars to a station.
+ * 
+ * @param station A pointer to the station which will add the cars.
+ * @param fuels The fuels of the cars to add, in any order. 
+ * @param n_cars Number of cars to add.
+ * 
+ * @return 1 if the cars are added successfully; 0 otherwise (the station is unchanged).
+ * 
+ * @note The fuels are sorted by radix sort and merged with the runs of the station, in T(n) = O(n_cars + r).
+*/
+matrix_size add_cars(station * station, const matrix_size * fuels, matrix_size n_cars);
 /**
  * @brief Remove a car from a station.
  * 
@@ -148,7 +352,9 @@ matrix_size add_car(station * station, matrix_size fuel);
  * 
  * @return 1 if the car is removed successfully; 0 otherwise.
  * 
- * @note If more cars with the same fuel are present, it's removed one of them randomly.
+ * @note If more cars with the same fuel are present, only one of them is removed.
+ * @note The run of fuel is found in T(r) = O(log(r)), and the max fuel is read from the last run; only the removal of the
+ *       last car of a fuel moves the runs after it.
 */
 matrix_size remove_car(station * station, matrix_size fuel);
 /**
@@ -160,7 +366,8 @@ matrix_size remove_car(station * station, matrix_size fuel);
  * 
  * @return 1 if the car is added successfully; 0 otherwise.
  * 
- * @note If the station is full (station->length == station->capacity), his capacity is doubled.
+ * @note The station is found in the hash table of the highway; the index of the station is searched only when its max 
+ *       fuel changes. See add_car.
 */
 matrix_size add_car_by_distance(highway * highway, matrix_size distance, matrix_size fuel);
 /**
@@ -172,10 +379,27 @@ matrix_size add_car_by_distance(highway * highway, matrix_size distance, matrix_
  * 
  * @return 1 if the car is removed successfully; 0 otherwise.
  * 
- * @note If more cars with the same fuel are present, it's removed one of them randomly.
+ * @note If more cars with the same fuel are present, only one of them is removed (see remove_car).
+ * @note The station is found in the hash table of the highway; the index of the station is searched only when its max 
+ *       fuel changes.
 */
 matrix_size remove_car_by_distance(highway * highway, matrix_size distance, matrix_size fuel);
 
+/**
+ * @brief Extract the distances and the max fuels of the stations from start to end, both included.
+ * 
+ * @param highway Pointer to the highway to use.
+ * @param start Distance of the first station.
+ * @param end Distance of the last station.
+ * @param stations_p Address of the array where the distances will be put (allocated on heap).
+ * @param cars_p Address of the array where the max fuels will be put (allocated on heap).
+ * 
+ * @returns The number of stations extracted if both the stations are in the highway; an element of enum result otherwise.
+ * 
+ * @note Tombstones are skipped.
+*/
+int extract_stations(const highway * highway, matrix_size start, matrix_size end, matrix_size ** stations_p, matrix_size ** cars_p);
+
 /**
  * @brief Retrieve the optimal path from start to end.
  * 
@@ -188,6 +412,26 @@ matrix_size remove_car_by_distance(highway * highway, matrix_size distance, matr
  * @param solution Address of the array where the solution will be put.
  * 
  * @returns The minimum number of stops if a solution is avaible; an element of enum result otherwise.
+ * 
+ * @note The solver reads the stations from the distance and max_fuel arrays of the highway (see solve_view), so no 
+ *       copy of the stations from start to end is made.
 */
 int plan_path(const highway * highway, matrix_size start, matrix_size end, direction dir, matrix_size ** solution);
+
+/**
+ * @brief Retrieve the optimal paths of a batch of queries.
+ * 
+ * Every query is solved in order on a view of the arrays of the highway, as plan_path does, so the stations of 
+ * overlapping queries are shared without being copied. Every result is the same of plan_path.
+ * 
+ * @param highway Pointer to the highway to use.
+ * @param queries Array of the queries.
+ * @param n_queries Number of queries.
+ * @param results Array of n_queries results, filled in the order of queries.
+ * 
+ * @returns n_queries if the batch is executed; null_ptr otherwise (no result is set).
+ * 
+ * @note The caller must free the solution of every result.
+*/
+int plan_path_batch(const highway * highway, const path_query * queries, matrix_size n_queries, path_result * results);
 #endif
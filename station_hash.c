@@ -0,0 +1,176 @@
+/**
+ * @file station_hash.c
+ * @brief Find stations by distance in an open addressing hash table.
+*/
+
+#include "station_hash.h"
+#include <stdlib.h>
+#include <stdint.h>
+
+#define NDEBUG
+
+#ifndef NDEBUG
+#include <stdio.h>
+#endif
+
+/**
+ * Base 2 logarithm of the number of slots of the smallest table.
+*/
+#define HASH_MIN_BITS 4
+
+/**
+ * @brief Find the home slot of a distance (Fibonacci hashing: the high bits of the product by 2^32 / phi).
+*/
+matrix_size home_slot(const station_hash * hash, matrix_size distance) {
+    return (uint32_t) (distance * 2654435769u) >> (32 - hash->bits);
+}
+
+/**
+ * @brief Find the number of bits of the smallest table which holds capacity stations.
+*/
+matrix_size bits_for(matrix_size capacity) {
+    matrix_size bits = HASH_MIN_BITS;
+    while(bits < 31 && ((size_t) 1 << bits) * HASH_MAX_LOAD < (size_t) capacity * 100) {
+        ++bits;
+    }
+
+    return bits;
+}
+
+/**
+ * @brief Put a station in the first free slot from its home slot.
+ *
+ * @pre The table has a free slot and no station at the same distance.
+*/
+void place_station(station_hash * hash, matrix_size distance, station * station) {
+    matrix_size mask = ((matrix_size) 1 << hash->bits) - 1;
+    matrix_size i = home_slot(hash, distance);
+
+    while(hash->slots[i].station != NULL) {
+        i = (i + 1) & mask;
+    }
+
+    hash->slots[i].distance = distance;
+    hash->slots[i].station = station;
+}
+
+/**
+ * @brief Move the stations of a table to a new array of 2^bits slots.
+ *
+ * @returns 1 if the table is rebuilt; 0 if there is not enough memory (the table is unchanged).
+*/
+matrix_size rehash(station_hash * hash, matrix_size bits) {
+    hash_slot * slots = (hash_slot *) calloc((size_t) 1 << bits, sizeof(hash_slot));
+    if(slots == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough memory to allocate %ld slots\n", (size_t) 1 << bits);
+        #endif
+
+        return 0;
+    }
+
+    hash_slot * old_slots = hash->slots;
+    size_t old_length = hash->slots == NULL ? 0 : (size_t) 1 << hash->bits;
+
+    hash->slots = slots;
+    hash->bits = bits;
+
+    for(size_t i = 0; i < old_length; ++i) {
+        if(old_slots[i].station != NULL) {
+            place_station(hash, old_slots[i].distance, old_slots[i].station);
+        }
+    }
+
+    free(old_slots);
+
+    return 1;
+}
+
+station_hash * create_station_hash(matrix_size capacity) {
+    station_hash * hash = (station_hash *) malloc(sizeof(station_hash));
+    if(hash == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough space to allocate station hash of %ld bytes\n", sizeof(station_hash));
+        #endif
+
+        return NULL;
+    }
+
+    hash->slots = NULL;
+    hash->bits = 0;
+    hash->length = 0;
+
+    if(!rehash(hash, bits_for(capacity))) {
+        free(hash);
+        return NULL;
+    }
+
+    return hash;
+}
+
+void delete_station_hash(station_hash * hash) {
+    if(hash != NULL) {
+        free(hash->slots);
+        free(hash);
+    }
+}
+
+matrix_size hash_reserve(station_hash * hash, matrix_size capacity) {
+    matrix_size bits = bits_for(capacity);
+
+    return bits <= hash->bits || rehash(hash, bits);
+}
+
+matrix_size hash_insert(station_hash * hash, station * station) {
+    if(!hash_reserve(hash, hash->length + 1)) {
+        return 0;
+    }
+
+    place_station(hash, station->distance, station);
+    ++hash->length;
+
+    return 1;
+}
+
+matrix_size hash_remove(station_hash * hash, matrix_size distance) {
+    matrix_size mask = ((matrix_size) 1 << hash->bits) - 1;
+    matrix_size i = home_slot(hash, distance);
+
+    while(hash->slots[i].station != NULL && hash->slots[i].distance != distance) {
+        i = (i + 1) & mask;
+    }
+
+    if(hash->slots[i].station == NULL) {
+        return 0;
+    }
+
+    // A following station of the cluster is moved back to i if i is between its home slot and its slot
+    for(matrix_size j = (i + 1) & mask; hash->slots[j].station != NULL; j = (j + 1) & mask) {
+        matrix_size home = home_slot(hash, hash->slots[j].distance);
+
+        if(((j - home) & mask) >= ((j - i) & mask)) {
+            hash->slots[i] = hash->slots[j];
+            i = j;
+        }
+    }
+
+    hash->slots[i].station = NULL;
+    --hash->length;
+
+    return 1;
+}
+
+station * hash_find(const station_hash * hash, matrix_size distance) {
+    matrix_size mask = ((matrix_size) 1 << hash->bits) - 1;
+    matrix_size i = home_slot(hash, distance);
+
+    while(hash->slots[i].station != NULL) {
+        if(hash->slots[i].distance == distance) {
+            return hash->slots[i].station;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    return NULL;
+}
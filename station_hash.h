@@ -0,0 +1,100 @@
+#ifndef _STATION_HASH_
+#define _STATION_HASH_
+
+/**
+ * @headerfile station_hash.h
+ * @brief Interface of station_hash.c
+ *
+ * A station hash maps the distance of every station of an highway to the station, so a station is found in O(1)
+ * expected time by commands which need only an exact match. It is an open addressing table with linear probing: the
+ * distance is stored next to the pointer, so a probe reads no station, and a removal shifts back the entries which
+ * follow instead of leaving tombstones. The table doubles when it is more than HASH_MAX_LOAD full.
+*/
+
+#include "solver.h"
+#include "station_handler.h"
+
+/**
+ * Maximum load of a station hash, in percent.
+*/
+#define HASH_MAX_LOAD 75
+
+/**
+ * @struct hash_slot
+ * @brief Slot of a station hash.
+ *
+ * @param distance Distance of the station.
+ * @param station Pointer to the station (NULL if the slot is empty).
+*/
+typedef struct hash_slot {
+    matrix_size distance;
+    station * station;
+} hash_slot;
+
+/**
+ * @struct station_hash
+ * @brief Hash table from distances to stations.
+ *
+ * @param slots The slots of the table.
+ * @param bits Base 2 logarithm of the number of slots.
+ * @param length Number of stations in the table.
+*/
+typedef struct station_hash {
+    hash_slot * slots;
+    matrix_size bits;
+    matrix_size length;
+} station_hash;
+
+/**
+ * @brief Create an empty station hash.
+ *
+ * @param capacity Number of stations the table holds without growing.
+ *
+ * @returns A pointer to the table allocated on heap, NULL if there is not enough memory.
+*/
+station_hash * create_station_hash(matrix_size capacity);
+
+/**
+ * @brief Delete a station hash (the stations are not deleted).
+ *
+ * @param hash Pointer to the table to delete.
+*/
+void delete_station_hash(station_hash * hash);
+
+/**
+ * @brief Make room for at least capacity stations in a station hash.
+ *
+ * @returns 1 if the table holds capacity stations without growing; 0 if there is not enough memory (the table is
+ *          unchanged).
+*/
+matrix_size hash_reserve(station_hash * hash, matrix_size capacity);
+
+/**
+ * @brief Insert a station in a station hash.
+ *
+ * @param hash Pointer to the table.
+ * @param station Pointer to the station to insert.
+ *
+ * @pre No station at the same distance is in the table.
+ *
+ * @returns 1 if the station is inserted; 0 if there is not enough memory to grow the table (the table is unchanged).
+*/
+matrix_size hash_insert(station_hash * hash, station * station);
+
+/**
+ * @brief Remove the station at a given distance from a station hash.
+ *
+ * @returns 1 if the station is removed, 0 if it is not in the table.
+*/
+matrix_size hash_remove(station_hash * hash, matrix_size distance);
+
+/**
+ * @brief Find the station at a given distance in a station hash.
+ *
+ * @returns A pointer to the station, NULL if it is not in the table.
+ *
+ * @note O(1) expected time.
+*/
+station * hash_find(const station_hash * hash, matrix_size distance);
+
+#endif
@@ -0,0 +1,165 @@
+/**
+ * @file station_pool.c
+ * @brief Allocate stations from slabs and runs from free lists of power of two sizes.
+*/
+
+#include "station_pool.h"
+#include <stdlib.h>
+
+#define NDEBUG
+
+#ifndef NDEBUG
+#include <stdio.h>
+#endif
+
+/**
+ * @brief Find the size class of an array of capacity runs.
+ *
+ * @returns The smallest c such that 2^c >= capacity, POOL_CLASSES + 1 if the array is too long to be pooled.
+*/
+matrix_size runs_class(matrix_size capacity) {
+    matrix_size c = 0;
+    while(c <= POOL_CLASSES && ((matrix_size) 1 << c) < capacity) {
+        ++c;
+    }
+
+    return c;
+}
+
+station_pool * create_station_pool() {
+    station_pool * pool = (station_pool *) malloc(sizeof(station_pool));
+    if(pool == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough space to allocate station pool of %ld bytes\n", sizeof(station_pool));
+        #endif
+
+        return NULL;
+    }
+
+    pool->slabs = NULL;
+    pool->used = POOL_SLAB_STATIONS;
+    pool->free_stations = NULL;
+    for(matrix_size c = 0; c <= POOL_CLASSES; ++c) {
+        pool->free_runs[c] = NULL;
+    }
+    pool->n_slabs = 0;
+    pool->stations = 0;
+    pool->runs_bytes = 0;
+
+    return pool;
+}
+
+void delete_station_pool(station_pool * pool) {
+    if(pool == NULL) {
+        return;
+    }
+
+    while(pool->slabs != NULL) {
+        station_slab * next = pool->slabs->next;
+        free(pool->slabs);
+        pool->slabs = next;
+    }
+
+    for(matrix_size c = 0; c <= POOL_CLASSES; ++c) {
+        while(pool->free_runs[c] != NULL) {
+            void * next = *(void **) pool->free_runs[c];
+            free(pool->free_runs[c]);
+            pool->free_runs[c] = next;
+        }
+    }
+
+    #ifndef NDEBUG
+    printf("\tDeallocated station pool (%d stations still in use)\n", pool->stations);
+    #endif
+
+    free(pool);
+}
+
+station * pool_alloc_station(station_pool * pool) {
+    pool_slot * slot = pool->free_stations;
+
+    if(slot != NULL) {
+        pool->free_stations = slot->next;
+    }
+    else {
+        if(pool->used == POOL_SLAB_STATIONS) {
+            station_slab * slab = (station_slab *) malloc(sizeof(station_slab));
+            if(slab == NULL) {
+                #ifndef NDEBUG
+                printf("\tNot enough space to allocate slab of %ld bytes\n", sizeof(station_slab));
+                #endif
+
+                return NULL;
+            }
+
+            slab->next = pool->slabs;
+            pool->slabs = slab;
+            pool->used = 0;
+            ++pool->n_slabs;
+        }
+
+        slot = pool->slabs->slots + pool->used++;
+    }
+
+    ++pool->stations;
+    return &slot->station;
+}
+
+void pool_free_station(station_pool * pool, station * station) {
+    if(station == NULL) {
+        return;
+    }
+
+    pool_slot * slot = (pool_slot *) station;
+    slot->next = pool->free_stations;
+    pool->free_stations = slot;
+    --pool->stations;
+}
+
+fuel_run * pool_alloc_runs(station_pool * pool, matrix_size capacity, matrix_size * granted) {
+    matrix_size c = runs_class(capacity);
+
+    if(c > POOL_CLASSES) {
+        fuel_run * runs = (fuel_run *) malloc(sizeof(fuel_run) * capacity);
+        if(runs != NULL) {
+            pool->runs_bytes += sizeof(fuel_run) * capacity;
+            *granted = capacity;
+        }
+
+        return runs;
+    }
+
+    // A free array stores the link to the next one in its first bytes, which fit in a single run
+    void * runs = pool->free_runs[c];
+    if(runs != NULL) {
+        pool->free_runs[c] = *(void **) runs;
+    }
+    else {
+        runs = malloc(sizeof(fuel_run) << c);
+        if(runs == NULL) {
+            return NULL;
+        }
+
+        pool->runs_bytes += sizeof(fuel_run) << c;
+    }
+
+    *granted = (matrix_size) 1 << c;
+    return (fuel_run *) runs;
+}
+
+void pool_free_runs(station_pool * pool, fuel_run * runs, matrix_size capacity) {
+    if(runs == NULL) {
+        return;
+    }
+
+    matrix_size c = runs_class(capacity);
+
+    if(c > POOL_CLASSES) {
+        pool->runs_bytes -= sizeof(fuel_run) * capacity;
+        free(runs);
+        return;
+    }
+
+    *(void **) runs = pool->free_runs[c];
+    pool->free_runs[c] = runs;
+}
@@ -0,0 +1,129 @@
+#ifndef _STATION_POOL_
+#define _STATION_POOL_
+
+/**
+ * @headerfile station_pool.h
+ * @brief Interface of station_pool.c
+ *
+ * A station pool hands out the memory of the stations of an highway and of the runs which do not fit in them. Stations
+ * are carved from slabs of POOL_SLAB_STATIONS slots, so they cost no allocation header and lie next to each other;
+ * arrays of runs are rounded up to a power of two and recycled through a free list for every size, so the runs left by
+ * a station are reused by the next one which grows to the same size.
+ *
+ * Memory is given back to the system only when the pool is deleted.
+*/
+
+#include "station_handler.h"
+#include <stddef.h>
+
+/**
+ * Number of stations of a slab.
+*/
+#define POOL_SLAB_STATIONS 1024
+
+/**
+ * Arrays of runs of up to 2^POOL_CLASSES runs are recycled by the pool; longer ones are allocated on heap.
+*/
+#define POOL_CLASSES 16
+
+/**
+ * @union pool_slot
+ * @brief Slot of a slab: a station, or the link to the next free slot.
+*/
+typedef union pool_slot {
+    station station;
+    union pool_slot * next;
+} pool_slot;
+
+/**
+ * @struct station_slab
+ * @brief Block of stations allocated at once.
+ *
+ * @param next Pointer to the slab allocated before this one.
+ * @param slots The stations of the slab.
+*/
+typedef struct station_slab {
+    struct station_slab * next;
+    pool_slot slots[POOL_SLAB_STATIONS];
+} station_slab;
+
+/**
+ * @struct station_pool
+ * @brief Allocator of stations and runs.
+ *
+ * @param slabs Pointer to the last slab allocated (NULL if there is none).
+ * @param used Number of slots of the last slab handed out at least once.
+ * @param free_stations Pointer to the first free slot.
+ * @param free_runs Free arrays of runs of every size class (an array of class c holds 2^c runs).
+ * @param n_slabs Number of slabs allocated.
+ * @param stations Number of stations in use.
+ * @param runs_bytes Bytes of the arrays of runs allocated by the pool (in use or free).
+*/
+typedef struct station_pool {
+    station_slab * slabs;
+    matrix_size used;
+    pool_slot * free_stations;
+    void * free_runs[POOL_CLASSES + 1];
+    matrix_size n_slabs;
+    matrix_size stations;
+    size_t runs_bytes;
+} station_pool;
+
+/**
+ * @brief Create an empty station pool.
+ *
+ * @returns A pointer to the pool allocated on heap, NULL if there is not enough memory.
+*/
+station_pool * create_station_pool();
+
+/**
+ * @brief Delete a station pool, releasing its slabs and its free arrays of runs.
+ *
+ * @param pool Pointer to the pool to delete.
+ *
+ * @pre Every station of the pool has been deleted.
+*/
+void delete_station_pool(station_pool * pool);
+
+/**
+ * @brief Take a station from a pool.
+ *
+ * @param pool Pointer to the pool to use.
+ *
+ * @pre pool != NULL
+ *
+ * @returns A pointer to an uninitialized station, NULL if there is not enough memory.
+*/
+station * pool_alloc_station(station_pool * pool);
+
+/**
+ * @brief Give a station back to its pool.
+ *
+ * @param pool Pointer to the pool the station was taken from.
+ * @param station Pointer to the station.
+*/
+void pool_free_station(station_pool * pool, station * station);
+
+/**
+ * @brief Take an array of at least capacity runs from a pool.
+ *
+ * @param pool Pointer to the pool to use.
+ * @param capacity Minimum number of runs of the array.
+ * @param granted Address where the number of runs of the array is put.
+ *
+ * @pre pool != NULL
+ *
+ * @returns A pointer to the array, NULL if there is not enough memory.
+*/
+fuel_run * pool_alloc_runs(station_pool * pool, matrix_size capacity, matrix_size * granted);
+
+/**
+ * @brief Give an array of runs back to its pool.
+ *
+ * @param pool Pointer to the pool the array was taken from.
+ * @param runs Pointer to the array.
+ * @param capacity Number of runs of the array (as granted by pool_alloc_runs).
+*/
+void pool_free_runs(station_pool * pool, fuel_run * runs, matrix_size capacity);
+
+#endif
@@ -3,12 +3,28 @@
  * @brief Contains unity tests for all the commands. 
 */
 
+#include "binary.h"
+#include "executor.h"
+#include "journal.h"
+#include "numbers.h"
 #include "parser.h"
+#include "pipeline.h"
+#include "reader.h"
+#include "search.h"
+#include "server.h"
+#include "snapshot.h"
 #include "solver.h"
 #include "station_handler.h"
+#include "station_hash.h"
+#include "station_pool.h"
+#include "writer.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
 
 void print_vec(matrix_size * vect, matrix_size length) {
   for(int i = 0; i < length; ++i) {
@@ -18,6 +34,16 @@ void print_vec(matrix_size * vect, matrix_size length) {
   printf("\n");
 }
 
+void print_cars(const station * station) {
+  for(matrix_size i = 0; i < station->n_runs; ++i) {
+    for(matrix_size k = 0; k < station->runs[i].count; ++k) {
+      printf("%d ", station->runs[i].fuel);
+    }
+  }
+
+  printf("\n");
+}
+
 //-------------------------------------------------------------------------------------
 
 void test_solve(matrix_size * stations, matrix_size n_stations, matrix_size * cars, direction dir) {
@@ -113,8 +139,184 @@ void test_dynamic_programming_huge() {
     test_solve(stations, n_stations, cars, backward);
 }
 
+void test_solve_view() {
+    printf("STARTING TEST VIEW\n");
+
+    matrix_size n_stations = 300;
+    matrix_size stations[n_stations], cars[n_stations];
+    matrix_size stations_copy[n_stations], cars_copy[n_stations];
+
+    srand(18);
+    for(matrix_size i = 0; i < n_stations; ++i) {
+      stations[i] = stations_copy[i] = i * 5 + rand() % 5;
+      cars[i] = cars_copy[i] = rand() % 40;
+    }
+
+    matrix_size matching = 1;
+    for(matrix_size q = 0; q < 200; ++q) {
+      matrix_size first = rand() % n_stations, length = 1 + rand() % (n_stations - first);
+      direction dir = q % 2 == 0 ? forward : backward;
+      station_view view = {stations, cars, first, length};
+      matrix_size * view_solution = NULL, * copy_solution = NULL;
+
+      // solve on a copy of the range, as plan_path did before the views
+      matrix_size range_stations[length], range_cars[length];
+      memcpy(range_stations, stations + first, length * sizeof(matrix_size));
+      memcpy(range_cars, cars + first, length * sizeof(matrix_size));
+
+      int view_stops = solve_view(&view, dir, &view_solution);
+      int copy_stops = solve(range_stations, length, range_cars, dir, &copy_solution);
+
+      matching = matching && view_stops == copy_stops;
+      for(int i = 0; matching && view_stops >= 0 && i < view_stops + 2; ++i) {
+        matching = view_solution[i] == copy_solution[i];
+      }
+
+      free(view_solution);
+      free(copy_solution);
+    }
+
+    matching = matching && memcmp(stations, stations_copy, sizeof(stations)) == 0 && 
+                memcmp(cars, cars_copy, sizeof(cars)) == 0;
+    printf("Views matching the copies: %d\n", matching);
+
+    station_view empty = {stations, cars, 0, 0}, missing = {NULL, cars, 0, 1};
+    matrix_size * solution = NULL;
+    printf("Empty view: %d, NULL view: %d\n", solve_view(&empty, forward, &solution), 
+      solve_view(&missing, forward, &solution));
+}
+
+void test_min_stops_layers() {
+    printf("STARTING TEST LAYERS\n");
+
+    matrix_size n_stations = 300;
+    matrix_size stations[n_stations], cars[n_stations];
+
+    srand(25);
+    matrix_size matching = 1, solved = 0;
+    for(matrix_size q = 0; q < 300; ++q) {
+      // Ranges of the cars from the next station only to the whole highway, with some empty stations
+      matrix_size length = 1 + rand() % n_stations, range = 1 + q % 30 * (q % 7 == 0 ? 40 : 1);
+      for(matrix_size i = 0; i < length; ++i) {
+        stations[i] = i * 5 + rand() % 5;
+        cars[i] = rand() % 10 == 0 ? 0 : rand() % (range * 5);
+      }
+
+      matrix_size * solution = NULL, * reference = NULL;
+      int stops = min_stops_layers(stations, length, cars, &solution);
+      int reference_stops = min_stops(stations, length, cars, &reference);
+
+      matching = matching && stops == reference_stops;
+      for(int i = 0; matching && stops >= 0 && i < stops + 2; ++i) {
+        matching = solution[i] == reference[i];
+      }
+      solved += stops >= 0;
+
+      if(stops >= 0) {
+        free(solution);
+      }
+      if(reference_stops >= 0) {
+        free(reference);
+      }
+    }
+    printf("Layers matching min_stops: %d (%d solved)\n", matching, solved);
+
+    // Backward routes, choosing the stops nearest to the end as the dynamic programming does
+    matching = 1, solved = 0;
+    for(matrix_size q = 0; q < 300; ++q) {
+      matrix_size length = 1 + rand() % n_stations, range = 1 + q % 30 * (q % 7 == 0 ? 40 : 1), max_fuel = 0;
+      for(matrix_size i = 0; i < length; ++i) {
+        stations[i] = i * 5 + rand() % 5;
+        cars[i] = rand() % 10 == 0 ? 0 : rand() % (range * 5);
+        max_fuel = cars[i] > max_fuel ? cars[i] : max_fuel;
+      }
+
+      station_view view = {stations, cars, 0, length};
+      matrix_size * solution = NULL, * reference = NULL;
+      int stops = min_stops_layers_view(&view, backward, 1, &solution);
+      int reference_stops = min_stops_dynamic(&view, &reference, max_fuel, backward);
+
+      matching = matching && stops == reference_stops;
+      for(int i = 0; matching && stops >= 0 && i < stops + 2; ++i) {
+        matching = solution[i] == reference[i];
+      }
+      solved += stops >= 0;
+
+      if(stops >= 0) {
+        free(solution);
+      }
+      if(reference_stops >= 0) {
+        free(reference);
+      }
+    }
+    printf("Backward layers matching min_stops_dynamic: %d (%d solved)\n", matching, solved);
+
+    matrix_size chain[] = {0, 1, 2, 3, 4, 5}, chain_cars[] = {1, 1, 1, 1, 1, 0};
+    matrix_size * solution = NULL;
+    int stops = min_stops_layers(chain, 6, chain_cars, &solution);
+    printf("Chain: %d stops, ", stops);
+    print_vec(solution, stops + 2);
+    free(solution);
+
+    stops = min_stops_layers(chain, 1, chain_cars, &solution);
+    printf("Single station: %d stops, ", stops);
+    print_vec(solution, stops + 2);
+    free(solution);
+
+    chain_cars[2] = 0;
+    printf("Broken chain: %d\n", min_stops_layers(chain, 6, chain_cars, &solution));
+
+    // Distance + max fuel beyond UINT_MAX
+    matrix_size far[] = {3000000000u, 4000000000u}, far_cars[] = {2000000000u, 0};
+    stops = min_stops_layers(far, 2, far_cars, &solution);
+    printf("Far stations: %d stops, %u %u\n", stops, solution[0], solution[1]);
+    free(solution);
+}
+
 //-------------------------------------------------------------------------------------
 
+void test_search() {
+  matrix_size keys[300];
+  matrix_size matching = 1;
+
+  // Every search checked against a linear scan, on every length up to 300 and on targets around every key
+  srand(23);
+  for(matrix_size length = 0; length <= 300; ++length) {
+    for(matrix_size i = 0; i < length; ++i) {
+      keys[i] = (i > 0 ? keys[i - 1] : 0) + 1 + rand() % 4;
+    }
+
+    eytzinger_index * index = create_eytzinger_index(keys, length);
+    matching = matching && index != NULL;
+
+    for(matrix_size target = 0; index != NULL && target <= (length > 0 ? keys[length - 1] + 1 : 1); ++target) {
+      matrix_size first_not_less = 0, first_greater = 0;
+      while(first_not_less < length && keys[first_not_less] < target) {
+        ++first_not_less;
+      }
+      while(first_greater < length && keys[first_greater] <= target) {
+        ++first_greater;
+      }
+
+      matching = matching && lower_bound(keys, length, target) == first_not_less && 
+                  upper_bound(keys, length, target) == first_greater && 
+                  eytzinger_lower_bound(index, target) == first_not_less;
+    }
+
+    delete_eytzinger_index(index);
+  }
+  printf("Searches matching the linear scan: %d\n", matching);
+
+  matrix_size example[] = {1, 3, 6, 7, 8, 10, 13, 17, 18, 20};
+  eytzinger_index * index = create_eytzinger_index(example, 10);
+  printf("Eytzinger order: ");
+  print_vec(index->keys + 1, index->length);
+  printf("lower_bound(7) = %d, upper_bound(7) = %d, eytzinger_lower_bound(9) = %d, eytzinger_lower_bound(21) = %d\n", 
+    lower_bound(example, 10, 7), upper_bound(example, 10, 7), eytzinger_lower_bound(index, 9), 
+    eytzinger_lower_bound(index, 21));
+  delete_eytzinger_index(index);
+}
+
 void test_highway() {
     highway * highway_1 = create_highway((matrix_size) 10000);
     highway * highway_2 = create_highway((matrix_size) 438744);
@@ -133,7 +335,11 @@ void test_highway() {
     delete_highway(highway_4);
     
     highway * only_highway = (highway *) malloc(sizeof(highway));
+    only_highway->distance = NULL;
+    only_highway->max_fuel = NULL;
     only_highway->stations = NULL;
+    only_highway->pool = NULL;
+    only_highway->lookup = NULL;
     delete_highway(only_highway);
 }
 
@@ -162,11 +368,11 @@ void test_station_insertion() {
     station * s4 = create_station(7, 34);
     station * s5 = create_station(10, 4);
 
-    printf("Insertion 1: %d\n", add_station(&highway_1, s1));
-    printf("Insertion 2: %d\n", add_station(&highway_1, s2));
-    printf("Insertion 3: %d\n", add_station(&highway_1, s3));
-    printf("Insertion 4: %d\n", add_station(&highway_1, s4));
-    printf("Insertion 5: %d\n", add_station(&highway_1, s5));
+    printf("Insertion 1: %d\n", add_station(highway_1, s1));
+    printf("Insertion 2: %d\n", add_station(highway_1, s2));
+    printf("Insertion 3: %d\n", add_station(highway_1, s3));
+    printf("Insertion 4: %d\n", add_station(highway_1, s4));
+    printf("Insertion 5: %d\n", add_station(highway_1, s5));
 
     delete_highway(highway_1);
 
@@ -181,14 +387,14 @@ void test_station_insertion() {
     station * s7 = create_station(19, 42);
     station * s8 = create_station(1, 34);
 
-    printf("Insertion 1: %d\n", add_station(&highway_2, s1));
-    printf("Insertion 2: %d\n", add_station(&highway_2, s2));
-    printf("Insertion 3: %d\n", add_station(&highway_2, s3));
-    printf("Insertion 4: %d\n", add_station(&highway_2, s4));
-    printf("Insertion 5: %d\n", add_station(&highway_2, s5));
-    printf("Insertion 6: %d\n", add_station(&highway_2, s6));
-    printf("Insertion 7: %d\n", add_station(&highway_2, s7));
-    printf("Insertion 8: %d\n", add_station(&highway_2, s8));
+    printf("Insertion 1: %d\n", add_station(highway_2, s1));
+    printf("Insertion 2: %d\n", add_station(highway_2, s2));
+    printf("Insertion 3: %d\n", add_station(highway_2, s3));
+    printf("Insertion 4: %d\n", add_station(highway_2, s4));
+    printf("Insertion 5: %d\n", add_station(highway_2, s5));
+    printf("Insertion 6: %d\n", add_station(highway_2, s6));
+    printf("Insertion 7: %d\n", add_station(highway_2, s7));
+    printf("Insertion 8: %d\n", add_station(highway_2, s8));
 
     delete_highway(highway_2);
 
@@ -196,7 +402,7 @@ void test_station_insertion() {
 
     for(matrix_size i = 1; i <= 1026; ++i) {
         s1 = create_station(i * 2 - 1, i % 14);
-        add_station(&highway_3, s1);
+        add_station(highway_3, s1);
     }
 
     delete_highway(highway_3);
@@ -204,12 +410,104 @@ void test_station_insertion() {
     highway * highway = create_highway(0);
 
     station * s = create_station(87, 0);
-    add_station(&highway, s);
+    add_station(highway, s);
     delete_station(s);
 
     delete_highway(highway);
 }
 
+void test_highway_growth() {
+    highway * highway = create_highway(1);
+    const struct highway * address = highway;
+
+    for(matrix_size i = 0; i < 1000; ++i) {
+        add_station(highway, create_station(i, 1));
+    }
+    printf("Stable address: %d, length: %d/%d\n", highway == address, highway->length, highway->capacity);
+
+    for(matrix_size i = 10; i < 1000; ++i) {
+        remove_station(highway, i);
+    }
+    matrix_size result = shrink_highway_to_fit(highway);
+    printf("Shrink: %d, length: %d/%d\n", result, highway->length, highway->capacity);
+
+    result = reserve_highway(highway, 5000);
+    printf("Reserve: %d, length: %d/%d\n", result, highway->length, highway->capacity);
+    result = reserve_highway(highway, 20);
+    printf("Reserve smaller: %d, length: %d/%d\n", result, highway->length, highway->capacity);
+
+    matrix_size cleared = 1;
+    for(matrix_size i = highway->length; i < highway->capacity; ++i) {
+        cleared = cleared && highway->stations[i] == NULL;
+    }
+    printf("Free slots cleared: %d, station 9 found: %d\n", cleared, find_station(highway, 9) != NULL);
+
+    for(matrix_size i = 0; i < 10; ++i) {
+        remove_station(highway, i);
+    }
+    result = shrink_highway_to_fit(highway);
+    printf("Shrink empty: %d, length: %d/%d\n", result, highway->length, highway->capacity);
+    printf("Stable address: %d\n", highway == address);
+
+    delete_highway(highway);
+}
+
+void test_highway_layout() {
+    highway * highway = create_highway(4);
+
+    srand(17);
+    for(matrix_size i = 0; i < 20000; ++i) {
+        matrix_size distance = rand() % 500;
+
+        switch(rand() % 4) {
+            case 0: {
+                station * new_station = create_station(distance, 2);
+                add_car(new_station, rand() % 100);
+                if(!add_station(highway, new_station)) {
+                    delete_station(new_station);
+                }
+            }
+            break;
+            case 1: remove_station(highway, distance);
+            break;
+            case 2: add_car_by_distance(highway, distance, rand() % 100);
+            break;
+            default: remove_car_by_distance(highway, distance, rand() % 100);
+        }
+    }
+
+    matrix_size matching = 1, tombstones = 0;
+    for(matrix_size i = 0; i < highway->length; ++i) {
+        if(highway->stations[i] == NULL) {
+            matching = matching && highway->max_fuel[i] == 0;
+            ++tombstones;
+        }
+        else {
+            matching = matching && highway->distance[i] == highway->stations[i]->distance &&
+                        highway->max_fuel[i] == highway->stations[i]->car_max_fuel;
+        }
+        matching = matching && (i == 0 || highway->distance[i - 1] < highway->distance[i]);
+    }
+    matching = matching && tombstones == highway->tombstones;
+    printf("Arrays matching the stations: %d (%d stations)\n", matching, highway->length - highway->tombstones);
+
+    delete_highway(highway);
+
+    // Distances before the first station and after the last one
+    highway = create_highway(4);
+    add_station(highway, create_station(10, 1));
+    add_station(highway, create_station(20, 1));
+
+    matrix_size * stations = NULL, * cars = NULL;
+    printf("Removal before the first: %d, after the last: %d\n", remove_station(highway, 5), 
+        remove_station(highway, 30));
+    printf("Extraction before the first: %d, after the last: %d\n", extract_stations(highway, 5, 20, &stations, &cars),
+        extract_stations(highway, 10, 30, &stations, &cars));
+    printf("Plan before the first: %d\n", plan_path(highway, 5, 20, forward, &stations));
+
+    delete_highway(highway);
+}
+
 void test_station_removal() {
     highway * highway_1 = create_highway(12);
 
@@ -219,11 +517,11 @@ void test_station_removal() {
     station * s4 = create_station(7, 34);
     station * s5 = create_station(10, 4);
 
-    printf("Insertion 1: %d\n", add_station(&highway_1, s1));
-    printf("Insertion 2: %d\n", add_station(&highway_1, s2));
-    printf("Insertion 3: %d\n", add_station(&highway_1, s3));
-    printf("Insertion 4: %d\n", add_station(&highway_1, s4));
-    printf("Insertion 5: %d\n", add_station(&highway_1, s5));
+    printf("Insertion 1: %d\n", add_station(highway_1, s1));
+    printf("Insertion 2: %d\n", add_station(highway_1, s2));
+    printf("Insertion 3: %d\n", add_station(highway_1, s3));
+    printf("Insertion 4: %d\n", add_station(highway_1, s4));
+    printf("Insertion 5: %d\n", add_station(highway_1, s5));
 
     printf("Removal 1: %d\n", remove_station(highway_1, s1->distance));
     printf("Removal 2: %d\n", remove_station(highway_1, s2->distance));
@@ -232,7 +530,7 @@ void test_station_removal() {
     printf("Removal 4: %d\n", remove_station(highway_1, s4->distance));
     printf("Removal 5: %d\n", remove_station(highway_1, s5->distance));
 
-    printf("Removal empty: %d\n", remove_station(highway_1, s5->distance));
+    printf("Removal empty: %d\n", remove_station(highway_1, 10));
 
     delete_highway(highway_1);
 
@@ -240,7 +538,7 @@ void test_station_removal() {
 
     for(matrix_size i = 1; i <= 567; ++i) {
         s1 = create_station(i * 2 - 1, i % 14);
-        add_station(&highway_3, s1);
+        add_station(highway_3, s1);
     }
 
     for(matrix_size i = 1; i <= 200; ++i) {
@@ -250,6 +548,233 @@ void test_station_removal() {
     delete_highway(highway_3);
 }
 
+void test_station_tombstones() {
+    highway * highway = create_highway(8);
+
+    for(matrix_size i = 1; i <= 8; ++i) {
+        station * new_station = create_station(i * 10, 1);
+        add_car(new_station, i * 20);
+        add_station(highway, new_station);
+    }
+
+    printf("Removal 20: %d, 50: %d\n", remove_station(highway, 20), remove_station(highway, 50));
+    printf("Length: %d, tombstones: %d, max fuel of 20: %d\n", highway->length, highway->tombstones, 
+        highway->max_fuel[1]);
+    printf("Find 20: %d, removal again: %d, car on 20: %d\n", find_station(highway, 20) != NULL, 
+        remove_station(highway, 20), add_car_by_distance(highway, 20, 5));
+
+    matrix_size * stations = NULL, * cars = NULL;
+    printf("Extraction from 20: %d\n", extract_stations(highway, 20, 60, &stations, &cars));
+    int n = extract_stations(highway, 10, 60, &stations, &cars);
+    printf("Extracted %d: ", n);
+    print_vec(stations, n);
+    free(stations);
+    free(cars);
+
+    n = plan_path(highway, 10, 80, forward, &stations);
+    printf("Plan 10 -> 80 (%d): ", n);
+    print_vec(stations, n + 2);
+    free(stations);
+
+    // The tombstone at the same distance is revived, the next one takes a station with a greater distance
+    printf("Insertion 20: %d, 55: %d\n", add_station(highway, create_station(20, 1)), 
+        add_station(highway, create_station(55, 1)));
+    printf("Length: %d, tombstones: %d, distances: ", highway->length, highway->tombstones);
+    print_vec(highway->distance, highway->length);
+
+    // The last station is dropped with the tombstones before it
+    remove_station(highway, 70);
+    remove_station(highway, 80);
+    printf("Length after the last: %d, tombstones: %d\n", highway->length, highway->tombstones);
+
+    // Over HIGHWAY_MAX_TOMBSTONES percent of the slots, the arrays are compacted
+    remove_station(highway, 30);
+    printf("Length: %d, tombstones: %d\n", highway->length, highway->tombstones);
+    remove_station(highway, 40);
+    printf("Length: %d, tombstones: %d, distances: ", highway->length, highway->tombstones);
+    print_vec(highway->distance, highway->length);
+
+    remove_station(highway, 20);
+    printf("Compacted: %d\n", compact_highway(highway));
+    printf("Compacted again: %d, length: %d\n", compact_highway(highway), highway->length);
+
+    delete_highway(highway);
+
+    // The nearest tombstone is before the station, so the stations in between move back
+    highway = create_highway(8);
+    for(matrix_size i = 1; i <= 8; ++i) {
+        add_station(highway, create_station(i * 10, 1));
+    }
+    remove_station(highway, 20);
+    printf("Insertion 35: %d, ", add_station(highway, create_station(35, 1)));
+    printf("tombstones: %d, distances: ", highway->tombstones);
+    print_vec(highway->distance, highway->length);
+    printf("Found 35: %d, 30: %d\n", find_station(highway, 35) != NULL, find_station(highway, 30) != NULL);
+
+    delete_highway(highway);
+}
+
+/**
+ * @brief Check the order, the slots and the tombstones of an highway.
+*/
+int valid_highway(const highway * highway) {
+    matrix_size stations = 0;
+
+    for(matrix_size i = 0; i < highway->length; ++i) {
+        if(i > 0 && highway->distance[i - 1] > highway->distance[i]) {
+            return 0;
+        }
+
+        if(highway->stations[i] == NULL) {
+            if(highway->max_fuel[i] != 0) {
+                return 0;
+            }
+        }
+        else if(highway->stations[i]->slot != i || highway->stations[i]->distance != highway->distance[i] ||
+            (i > 0 && highway->distance[i - 1] == highway->distance[i] && highway->stations[i - 1] != NULL)) {
+            return 0;
+        }
+        else {
+            ++stations;
+        }
+    }
+
+    return stations == highway->length - highway->tombstones && stations == highway->lookup->length;
+}
+
+void test_highway_spread() {
+    highway * highway = create_highway(8);
+
+    // Every station is added before the others, so the stations after it are spread instead of moved
+    matrix_size n = 3000;
+    matrix_size inserted = 1;
+    for(matrix_size i = n; i > 0; --i) {
+        station * new_station = create_station(i * 4, 1);
+        add_car(new_station, 4 + (i * 7) % 9);
+        inserted = add_station(highway, new_station) && inserted;
+    }
+    printf("Prepended %d: %d, valid: %d, sparse: %d\n", n, inserted, valid_highway(highway),
+        sparse_highway(highway));
+
+    // Then in the middle of the gaps, in a scattered order
+    for(matrix_size i = 0; i < n; ++i) {
+        station * new_station = create_station(((i * 1237) % n) * 4 + 2, 1);
+        add_car(new_station, 3 + i % 5);
+        inserted = add_station(highway, new_station) && inserted;
+    }
+    printf("Inserted %d: %d, valid: %d, stations: %d\n", n, inserted, valid_highway(highway),
+        highway->length - highway->tombstones);
+
+    // The tombstones between the stations are never stops
+    matrix_size * forward_path = NULL, * backward_path = NULL, * solution = NULL;
+    int forward_stops = plan_path(highway, 2, n * 4, forward, &forward_path);
+    int backward_stops = plan_path(highway, n * 4, 2, backward, &backward_path);
+
+    compact_highway(highway);
+    printf("Compacted, valid: %d, tombstones: %d\n", valid_highway(highway), highway->tombstones);
+
+    int stops = plan_path(highway, 2, n * 4, forward, &solution);
+    printf("Forward stops: %d, same as compacted: %d\n", forward_stops,
+        stops == forward_stops && memcmp(solution, forward_path, (stops + 2) * sizeof(matrix_size)) == 0);
+    free(solution);
+
+    stops = plan_path(highway, n * 4, 2, backward, &solution);
+    printf("Backward stops: %d, same as compacted: %d\n", backward_stops,
+        stops == backward_stops && memcmp(solution, backward_path, (stops + 2) * sizeof(matrix_size)) == 0);
+    free(solution);
+
+    free(forward_path);
+    free(backward_path);
+    delete_highway(highway);
+}
+
+void test_add_stations() {
+    highway * highway = create_highway(2);
+    add_station(highway, create_station(20, 1));
+    add_station(highway, create_station(40, 1));
+    add_station(highway, create_station(50, 1));
+    remove_station(highway, 40);
+
+    station * batch[] = {
+        create_station(30, 1), create_station(20, 1), create_station(10, 1), NULL, create_station(30, 1), 
+        create_station(60, 1), create_station(40, 1)
+    };
+    matrix_size n = sizeof(batch) / sizeof(station *), added[sizeof(batch) / sizeof(station *)];
+
+    printf("Bulk insertion: %d, added: ", add_stations(highway, batch, n, added));
+    print_vec(added, n);
+    printf("Length: %d, tombstones: %d, distances: ", highway->length, highway->tombstones);
+    print_vec(highway->distance, highway->length);
+    printf("Found 10: %d, 30 of the batch: %d\n", find_station(highway, 10) == batch[2], 
+        find_station(highway, 30) == batch[0]);
+
+    for(matrix_size k = 0; k < n; ++k) {
+        if(!added[k]) {
+            delete_station(batch[k]);
+        }
+    }
+
+    printf("Empty batch: %d, NULL highway: %d\n", add_stations(highway, NULL, 0, NULL), 
+        add_stations(NULL, batch, n, added));
+
+    delete_highway(highway);
+
+    // Batches with duplicates add the same stations of add_station called on each one
+    struct highway * sequential = create_highway(1), * bulk = create_highway(1);
+    station * stations[64];
+    matrix_size results[64], inserted[64], matching = 1;
+
+    srand(23);
+    for(matrix_size round = 0; round < 200; ++round) {
+        matrix_size length = rand() % 64;
+
+        for(matrix_size k = 0; k < length; ++k) {
+            stations[k] = create_station(rand() % 1000, 1);
+            add_car(stations[k], rand() % 100);
+
+            station * copy = create_station(stations[k]->distance, 1);
+            add_car(copy, stations[k]->car_max_fuel);
+
+            results[k] = add_station(sequential, copy);
+            if(!results[k]) {
+                delete_station(copy);
+            }
+        }
+
+        add_stations(bulk, stations, length, inserted);
+        for(matrix_size k = 0; k < length; ++k) {
+            matching = matching && inserted[k] == results[k];
+            if(!inserted[k]) {
+                delete_station(stations[k]);
+            }
+        }
+
+        matrix_size demolished = rand() % 1000;
+        remove_station(sequential, demolished);
+        remove_station(bulk, demolished);
+
+        // Every station knows its index, also when tombstones are reused
+        for(matrix_size i = 0; i < sequential->length; ++i) {
+            matching = matching && (sequential->stations[i] == NULL || sequential->stations[i]->slot == i);
+        }
+        for(matrix_size i = 0; i < bulk->length; ++i) {
+            matching = matching && (bulk->stations[i] == NULL || bulk->stations[i]->slot == i);
+        }
+    }
+
+    compact_highway(sequential);
+    compact_highway(bulk);
+    matching = matching && sequential->length == bulk->length && bulk->lookup->length == bulk->length;
+    for(matrix_size i = 0; matching && i < bulk->length; ++i) {
+        matching = sequential->distance[i] == bulk->distance[i] && sequential->max_fuel[i] == bulk->max_fuel[i] &&
+                    bulk->stations[i]->distance == bulk->distance[i] && bulk->stations[i]->slot == i;
+    }
+    printf("Bulk matching sequential insertions: %d (%d stations)\n", matching, bulk->length);
+
+    delete_highway(sequential);
+    delete_highway(bulk);
+}
+
 void test_station_search() {
     highway * highway_2 = create_highway(3);
 
@@ -262,14 +787,14 @@ void test_station_search() {
     station * s7 = create_station(19, 42);
     station * s8 = create_station(1, 34);
 
-    add_station(&highway_2, s1);
-    add_station(&highway_2, s2);
-    add_station(&highway_2, s3);
-    add_station(&highway_2, s4);
-    add_station(&highway_2, s5);
-    add_station(&highway_2, s6);
-    add_station(&highway_2, s7);
-    add_station(&highway_2, s8);
+    add_station(highway_2, s1);
+    add_station(highway_2, s2);
+    add_station(highway_2, s3);
+    add_station(highway_2, s4);
+    add_station(highway_2, s5);
+    add_station(highway_2, s6);
+    add_station(highway_2, s7);
+    add_station(highway_2, s8);
 
     s1 = find_station(highway_2, 24);
     if(s1 == NULL) {
@@ -300,15 +825,12 @@ void test_car_insertion() {
     printf("Car insertion 7: %d\n", add_car(s1, 16));
 
     printf("Cars: ");
-    for(int i = 0; i < s1->length; ++i) {
-        printf("%d ", s1->cars[i]);
-    }
-    printf("\n");
+    print_cars(s1);
 
     delete_station(s1);
 
     s1 = create_station(11, 3);
-    add_station(&highway_1, s1);
+    add_station(highway_1, s1);
 
     for(matrix_size i = 1; i <= 6781; ++i) {
         add_car(s1, i % 134);
@@ -333,10 +855,7 @@ void test_car_removal() {
   printf("Car insertion 7: %d\n", add_car(s1, 16));
 
   printf("Cars before removal: ");
-  for(int i = 0; i < s1->length; ++i) {
-      printf("%d ", s1->cars[i]);
-  }
-  printf("\n");
+  print_cars(s1);
   printf("Max fuel: %d\n", s1->car_max_fuel);
 
   printf("Car removal 1: %d\n", remove_car(s1, 28));
@@ -346,10 +865,7 @@ void test_car_removal() {
   printf("Car removal 5: %d\n", remove_car(s1, 11));
 
   printf("Cars after removal: ");
-  for(int i = 0; i < s1->length; ++i) {
-      printf("%d ", s1->cars[i]);
-  }
-  printf("\n");
+  print_cars(s1);
   printf("Max fuel: %d\n", s1->car_max_fuel);
 
   delete_station(s1);
@@ -362,14 +878,182 @@ void test_car_removal() {
   delete_station(s1);
 }
 
+void test_car_multiset() {
+  #define MULTISET_FUELS 200
+  matrix_size counts[MULTISET_FUELS] = {0}, length = 0;
+  station * s1 = create_station(1, 1);
+
+  // Cars added one at a time, in bulk and removed, checked against the count of cars of every fuel
+  srand(19);
+  matrix_size matching = 1;
+  for(matrix_size i = 0; i < 20000; ++i) {
+    matrix_size fuel = rand() % MULTISET_FUELS;
+
+    if(i % 1000 == 0) {
+      matrix_size fuels[300];
+      for(matrix_size k = 0; k < 300; ++k) {
+        fuels[k] = rand() % MULTISET_FUELS;
+        ++counts[fuels[k]];
+      }
+      add_cars(s1, fuels, 300);
+      length += 300;
+    }
+    else if(rand() % 2) {
+      add_car(s1, fuel);
+      ++counts[fuel];
+      ++length;
+    }
+    else {
+      matching = matching && remove_car(s1, fuel) == (counts[fuel] > 0);
+      if(counts[fuel] > 0) {
+        --counts[fuel];
+        --length;
+      }
+    }
+
+    matrix_size max_fuel = 0;
+    for(matrix_size f = 0; f < MULTISET_FUELS; ++f) {
+      if(counts[f] > 0) {
+        max_fuel = f;
+      }
+    }
+    matching = matching && s1->length == length && s1->car_max_fuel == max_fuel;
+  }
+
+  matrix_size r = 0;
+  for(matrix_size f = 0; f < MULTISET_FUELS; ++f) {
+    if(counts[f] > 0) {
+      matching = matching && r < s1->n_runs && s1->runs[r].fuel == f && s1->runs[r].count == counts[f];
+      ++r;
+    }
+  }
+  matching = matching && r == s1->n_runs;
+  printf("Multiset matching the counts: %d (%d cars, %d runs)\n", matching, s1->length, s1->n_runs);
+
+  delete_station(s1);
+
+  s1 = create_station(2, 1);
+  matrix_size fuels[] = {5, 3, 5, 9, 3, 3};
+  printf("Bulk insertion: %d, empty: %d, NULL: %d\n", add_cars(s1, fuels, 6), add_cars(s1, NULL, 0), 
+    add_cars(NULL, fuels, 6));
+  printf("Cars: ");
+  print_cars(s1);
+  printf("Max fuel: %d, runs: %d\n", s1->car_max_fuel, s1->n_runs);
+
+  delete_station(s1);
+}
+
+void test_station_pool() {
+  highway * highway_1 = create_highway(4);
+  station_pool * pool = highway_1->pool;
+
+  // Stations with few distinct fuels keep their runs inline, the others spill to arrays of the pool
+  matrix_size added = 1;
+  for(matrix_size i = 0; i < 3000; ++i) {
+    station * s = create_pooled_station(highway_1, i, 0);
+    for(matrix_size k = 0; k <= i % 6; ++k) {
+      added = added && add_car(s, 10 * k + i % 7);
+    }
+    added = added && add_station(highway_1, s);
+  }
+  printf("Pooled stations added: %d (%d stations in %d slabs)\n", added, pool->stations, pool->n_slabs);
+
+  station * inline_station = find_station(highway_1, 12);
+  station * spilled_station = find_station(highway_1, 17);
+  printf("Station 12 inline: %d, cars: ", inline_station->runs == inline_station->inline_runs);
+  print_cars(inline_station);
+  printf("Station 17 inline: %d, capacity: %d, cars: ", spilled_station->runs == spilled_station->inline_runs, 
+    spilled_station->capacity);
+  print_cars(spilled_station);
+
+  // A removed station and its runs are given back to the pool and reused by the next station
+  fuel_run * runs = spilled_station->runs;
+  size_t runs_bytes = pool->runs_bytes;
+  remove_station(highway_1, 17);
+  station * s = create_pooled_station(highway_1, 3000, 5);
+  printf("Slot reused: %d, runs reused: %d, runs bytes unchanged: %d\n", s == spilled_station, s->runs == runs, 
+    pool->runs_bytes == runs_bytes);
+  delete_station(s);
+  printf("Stations in use: %d\n", pool->stations);
+
+  station * malloc_station = create_station(1, 0);
+  printf("Station on heap inline: %d, pool: %p\n", malloc_station->runs == malloc_station->inline_runs, 
+    (void *) malloc_station->pool);
+  delete_station(malloc_station);
+
+  printf("Pooled station of NULL highway: %p\n", (void *) create_pooled_station(NULL, 1, 0));
+
+  delete_highway(highway_1);
+}
+
+void test_station_hash() {
+  #define HASH_DISTANCES 4096
+  station * stations[HASH_DISTANCES] = {NULL};
+  station_hash * hash = create_station_hash(4);
+
+  // Random insertions and removals on few slots, so that clusters form and removals shift them back
+  srand(29);
+  matrix_size matching = hash != NULL, length = 0;
+  for(matrix_size i = 0; matching && i < 100000; ++i) {
+    matrix_size distance = rand() % HASH_DISTANCES;
+
+    if(stations[distance] == NULL && rand() % 3 > 0) {
+      stations[distance] = create_station(distance, 0);
+      matching = hash_insert(hash, stations[distance]);
+      ++length;
+    }
+    else if(stations[distance] != NULL) {
+      matching = hash_remove(hash, distance);
+      delete_station(stations[distance]);
+      stations[distance] = NULL;
+      --length;
+    }
+    else {
+      matching = !hash_remove(hash, distance);
+    }
+
+    for(matrix_size k = 0; matching && i % 1000 == 0 && k < HASH_DISTANCES; ++k) {
+      matching = hash_find(hash, k) == stations[k];
+    }
+  }
+  printf("Hash matching the stations: %d (%d stations in %d slots)\n", matching && hash->length == length, 
+    hash->length, 1 << hash->bits);
+
+  for(matrix_size k = 0; k < HASH_DISTANCES; ++k) {
+    delete_station(stations[k]);
+  }
+  delete_station_hash(hash);
+
+  // The hash of an highway follows its stations
+  highway * highway_1 = create_highway(2);
+  for(matrix_size d = 10; d <= 100; d += 10) {
+    add_station(highway_1, create_pooled_station(highway_1, d, 0));
+  }
+  remove_station(highway_1, 50);
+  add_car_by_distance(highway_1, 40, 7);
+  add_car_by_distance(highway_1, 40, 3);
+  remove_car_by_distance(highway_1, 40, 7);
+  printf("Found 40: %d, found 50: %d, add car to 50: %d, max fuel of 40: %d (array %d), stations in hash: %d\n", 
+    find_station(highway_1, 40) != NULL, find_station(highway_1, 50) != NULL, add_car_by_distance(highway_1, 50, 1), 
+    find_station(highway_1, 40)->car_max_fuel, highway_1->max_fuel[3], highway_1->lookup->length);
+
+  matrix_size * stations_extracted, * cars_extracted;
+  printf("Extraction from 10 to 50: %d", extract_stations(highway_1, 10, 50, &stations_extracted, &cars_extracted));
+  printf(", from 10 to 60: %d\n", extract_stations(highway_1, 10, 60, &stations_extracted, &cars_extracted));
+  free(stations_extracted);
+  free(cars_extracted);
+
+  delete_highway(highway_1);
+}
+
 void test_car_insertion_by_distance() {
     highway * highway_1 = create_highway(2);
 
     station * s1 = create_station(11, 2);
-    add_station(&highway_1, s1);
+    add_station(highway_1, s1);
 
     station * s2 = create_station(11, 5);
-    if(add_station(&highway_1, s2) == 0) {
+    if(add_station(highway_1, s2) == 0) {
       delete_station(s2);
     }
 
@@ -382,15 +1066,12 @@ void test_car_insertion_by_distance() {
     printf("Car insertion 7: %d\n", add_car_by_distance(highway_1, 11, 16));
 
     printf("Cars: ");
-    for(int i = 0; i < s1->length; ++i) {
-        printf("%d ", s1->cars[i]);
-    }
-    printf("\n");
+    print_cars(s1);
 
     remove_station(highway_1, 11);
 
     s1 = create_station(11, 3);
-    add_station(&highway_1, s1);
+    add_station(highway_1, s1);
 
     
     for(matrix_size i = 1; i <= 6781; ++i) {
@@ -407,7 +1088,7 @@ void test_car_removal_by_distance() {
   highway * my_highway = create_highway(34);
   station * s1 = create_station(distance, 1);
 
-  add_station(&my_highway, s1);
+  add_station(my_highway, s1);
 
   printf("Car insertion 1: %d\n", add_car_by_distance(my_highway, distance, 23));
   printf("Car insertion 2: %d\n", add_car_by_distance(my_highway, distance, 24));
@@ -418,10 +1099,7 @@ void test_car_removal_by_distance() {
   printf("Car insertion 7: %d\n", add_car_by_distance(my_highway, distance, 23));
 
   printf("Cars before removal: ");
-  for(int i = 0; i < s1->length; ++i) {
-      printf("%d ", s1->cars[i]);
-  }
-  printf("\n");
+  print_cars(s1);
   printf("Max fuel: %d\n", s1->car_max_fuel);
 
   printf("Car removal 1: %d\n", remove_car_by_distance(my_highway, distance, 23));
@@ -431,17 +1109,14 @@ void test_car_removal_by_distance() {
   printf("Car removal 5: %d\n", remove_car_by_distance(my_highway, distance + 1, 23));
 
   printf("Cars after removal: ");
-  for(int i = 0; i < s1->length; ++i) {
-      printf("%d ", s1->cars[i]);
-  }
-  printf("\n");
+  print_cars(s1);
   printf("Max fuel: %d\n", s1->car_max_fuel);
 
   remove_station(my_highway, distance);
 
   s1 = create_station(distance, 3);
 
-  add_station(&my_highway, s1);
+  add_station(my_highway, s1);
 
   printf("Car removal empty : %d\n", remove_car_by_distance(my_highway, 23, 10));
   printf("Car removal NULL: %d\n", remove_car_by_distance(NULL, distance, 10));
@@ -469,20 +1144,20 @@ void test_plan_path() {
   add_car(s7, 10);
   station * s8 = create_station(1, 34);
 
-  printf("Insertion 1: %d\n", add_station(&highway_2, s1));
-  printf("Insertion 2: %d\n", add_station(&highway_2, s2));
+  printf("Insertion 1: %d\n", add_station(highway_2, s1));
+  printf("Insertion 2: %d\n", add_station(highway_2, s2));
   add_car_by_distance(highway_2, s2->distance, 9);
-  printf("Insertion 3: %d\n", add_station(&highway_2, s3));
+  printf("Insertion 3: %d\n", add_station(highway_2, s3));
   add_car_by_distance(highway_2, s3->distance, 4);
   add_car_by_distance(highway_2, s3->distance, 2);
-  printf("Insertion 4: %d\n", add_station(&highway_2, s4));
-  printf("Insertion 5: %d\n", add_station(&highway_2, s5));
+  printf("Insertion 4: %d\n", add_station(highway_2, s4));
+  printf("Insertion 5: %d\n", add_station(highway_2, s5));
   add_car_by_distance(highway_2, s5->distance, 4);
   add_car_by_distance(highway_2, s5->distance, 5);
   add_car_by_distance(highway_2, s5->distance, 6);
-  printf("Insertion 6: %d\n", add_station(&highway_2, s6));
-  printf("Insertion 7: %d\n", add_station(&highway_2, s7));
-  printf("Insertion 8: %d\n", add_station(&highway_2, s8));
+  printf("Insertion 6: %d\n", add_station(highway_2, s6));
+  printf("Insertion 7: %d\n", add_station(highway_2, s7));
+  printf("Insertion 8: %d\n", add_station(highway_2, s8));
   add_car_by_distance(highway_2, s8->distance, 8);
 
   matrix_size * solution;
@@ -521,6 +1196,10 @@ void print_instruction(const instruction * instruction) {
     break;
     case plan_path_command: printf("pianifica-percorso\n");
     break;
+    case save_state_command: printf("salva-stato\n");
+    break;
+    case load_stations_command: printf("importa-stazioni\n");
+    break;
     case no_command: printf("command not codified\n");
     break;
   }
@@ -584,6 +1263,17 @@ void test_parse_instruction() {
   print_instruction(instruction);
   delete_instruction(instruction);
 
+  char command_load[] = "importa-stazioni 10 2 5 6 20 0 30 1 7";
+  instruction = parse_instruction(command_load);
+  printf("Valid: %d\n", validate_instruction(instruction));
+  print_instruction(instruction);
+  delete_instruction(instruction);
+
+  char command_load_wrong[] = "importa-stazioni 10 2 5 6 20 3 7";
+  instruction = parse_instruction(command_load_wrong);
+  printf("Valid: %d\n", validate_instruction(instruction));
+  delete_instruction(instruction);
+
   instruction = parse_instruction("");
   print_instruction(instruction);
   delete_instruction(instruction);
@@ -597,12 +1287,667 @@ void test_parse_instruction() {
   delete_instruction(instruction);
 }
 
+void test_parse_line_into() {
+  const char * commands[] = {
+    "aggiungi-auto 159384 673",
+    "aggiungi-stazione 15 673 1 0 1232 12 34 54 66 7 12 34 5 8 9 10 11 12 13 14 15",
+    "pianifica-percorso 4 6732345",
+    "random-command 4 6732345 7 3 4 5",
+    "salva-stato",
+    "aggiungi-stazionE 1 2",
+    "demolisci-stazione",
+    "rottama-auto 7 -8 9"
+  };
+
+  parse_arena * arena = create_parse_arena(4);
+  instruction instruction;
+
+  for(uint i = 0; i < sizeof(commands) / sizeof(commands[0]); ++i) {
+    printf("Parsed: %d\n", parse_line_into(commands[i], strlen(commands[i]), arena, &instruction));
+    print_instruction(&instruction);
+    printf("Arena capacity %d, allocations %ld\n", arena->capacity, arena->allocations);
+  }
+
+  unsigned long allocations = arena->allocations;
+  for(uint i = 0; i < 100000; ++i) {
+    parse_line_into(commands[i % 8], strlen(commands[i % 8]), arena, &instruction);
+  }
+  printf("Allocations in steady state: %ld\n", arena->allocations - allocations);
+
+  delete_parse_arena(arena);
+}
+
+//-------------------------------------------------------------------------------------
+
+void test_decode_number() {
+  const char * tokens[] = {"0", "42", "  17", "+8", "-0", "-5", "12ab", "", "2147483647", "2147483648", 
+                          "99999999999999999999", "000000000000000000123"};
+
+  for(uint i = 0; i < sizeof(tokens) / sizeof(tokens[0]); ++i) {
+    uint value = 0;
+    uint in_range = decode_number(tokens[i], strlen(tokens[i]), &value);
+    printf("Number \"%s\": %u (in range %d)\n", tokens[i], value, in_range);
+  }
+}
+
+void test_decode_number_list() {
+  const char list[] = "5 0 1234567890123456 7 -1 00000000000000000009 12x 2147483647  4294967296 31 "
+                      "18 1 22 333 4444 55555 666666 7777777 88888888 999999999 ";
+  uint length = strlen(list);
+  uint reference[64], values[64];
+  uint reference_length = 0, reference_out_of_range = 0;
+
+  number_decoder best = detect_number_decoder();
+
+  for(uint decoder = scalar_decoder; decoder <= best; ++decoder) {
+    select_number_decoder(decoder);
+
+    uint n = 0, out_of_range = 0;
+    for(uint position = 0; position <= length; ) {
+      uint consumed = 0;
+      // Few numbers at a time, so the list is resumed in the middle of the blocks
+      n += decode_number_list(list + position, length - position, ' ', values + n, 3, &consumed, &out_of_range);
+      position += consumed;
+    }
+
+    if(decoder == scalar_decoder) {
+      memcpy(reference, values, sizeof(uint) * n);
+      reference_length = n;
+      reference_out_of_range = out_of_range;
+
+      printf("Numbers: ");
+      print_vec(values, n);
+      printf("Out of range: %d\n", out_of_range);
+    }
+    else {
+      printf("Decoder %d same as scalar: %d\n", decoder, n == reference_length && 
+        out_of_range == reference_out_of_range && memcmp(values, reference, sizeof(uint) * n) == 0);
+    }
+  }
+
+  select_number_decoder(best);
+}
+
+//-------------------------------------------------------------------------------------
+
+void print_lines(reader * reader) {
+  line line;
+  read_result result;
+
+  while((result = next_line(reader, &line)) == line_read) {
+    printf("Line (%d): %.*s\n", line.length, line.length, line.text);
+  }
+
+  printf("Read result: %d\n", result);
+}
+
+void test_next_line() {
+  int fd[2];
+  char input[] = "aggiungi-stazione 20 3 5 10 15\ndemolisci-stazione 20\n\npianifica-percorso 4 6732345\nno-newline";
+
+  pipe(fd);
+  write(fd[1], input, strlen(input));
+  close(fd[1]);
+
+  reader * reader = create_reader(fd[0], 16);
+  print_lines(reader);
+  delete_reader(reader);
+  close(fd[0]);
+
+  pipe(fd);
+  write(fd[1], input, strlen(input));
+  close(fd[1]);
+
+  reader = create_reader(fd[0], 64);
+  print_lines(reader);
+  delete_reader(reader);
+  close(fd[0]);
+
+  printf("Reader capacity=0: %p\n", (void *) create_reader(0, 0));
+}
+
+void test_next_token() {
+  int fd[2];
+  char input[] = "aggiungi-stazione 20  5 10\n15\nincomplete";
+  line token;
+  uint last = 0;
+  read_result result;
+
+  pipe(fd);
+  write(fd[1], input, strlen(input));
+  close(fd[1]);
+
+  reader * reader = create_reader(fd[0], 20);
+
+  while((result = next_token(reader, ' ', &token, &last)) == line_read) {
+    printf("Token (%d, last=%d): %.*s\n", token.length, last, token.length, token.text);
+  }
+  printf("Read result: %d\n", result);
+
+  delete_reader(reader);
+  close(fd[0]);
+}
+
+void test_writer_output() {
+  int fd[2];
+  char output[256];
+
+  pipe(fd);
+
+  writer * writer = create_writer(fd[1], 16);
+  write_literal(writer, "aggiunta\n");
+  write_uint(writer, 0);
+  write_char(writer, ' ');
+  write_uint(writer, 9);
+  write_char(writer, ' ');
+  write_uint(writer, 10);
+  write_char(writer, ' ');
+  write_uint(writer, 99);
+  write_char(writer, ' ');
+  write_uint(writer, 100);
+  write_char(writer, ' ');
+  write_uint(writer, 4294967295u);
+  write_char(writer, '\n');
+  write_literal(writer, "nessun percorso\n");
+  write_literal(writer, "non aggiunta\n");
+  delete_writer(writer);
+  close(fd[1]);
+
+  int n = read(fd[0], output, sizeof(output));
+  close(fd[0]);
+
+  printf("Written (%d): %.*s", n, n, output);
+  printf("Writer capacity=%d: %p\n", UINT_DIGITS, (void *) create_writer(1, UINT_DIGITS));
+}
+
+void test_varint() {
+  unsigned char buffer[VARINT_MAX_LENGTH];
+  uint values[] = {0, 1, 127, 128, 16383, 16384, 4294967295u};
+  uint value = 0;
+
+  for(int i = 0; i < sizeof(values) / sizeof(uint); ++i) {
+    uint n = encode_varint(values[i], buffer);
+    uint m = decode_varint(buffer, n, &value);
+    printf("Varint %u -> %d bytes -> %u (%d bytes read)\n", values[i], n, value, m);
+  }
+
+  unsigned char truncated[] = {0x80, 0x80};
+  printf("Truncated varint: %d\n", decode_varint(truncated, 2, &value));
+
+  unsigned char overflow[] = {0xFF, 0xFF, 0xFF, 0xFF, 0x1F};
+  printf("Overflowing varint: %d\n", decode_varint(overflow, 5, &value));
+}
+
+void test_instruction_encoding() {
+  char command[] = "aggiungi-stazione 15 3 1 300 70000";
+  instruction * original = parse_instruction(command);
+
+  unsigned char record[64];
+  uint length = encode_instruction(original, record);
+  printf("Record length: %d (max %d)\n", length, record_max_length(original));
+
+  uint payload_length = 0;
+  uint prefix = decode_varint(record, length, &payload_length);
+  instruction * decoded = decode_instruction(record + prefix, payload_length);
+  print_instruction(decoded);
+
+  delete_instruction(decoded);
+  delete_instruction(original);
+
+  unsigned char malformed[] = {plan_path_command, 0x80};
+  decoded = decode_instruction(malformed, sizeof(malformed));
+  print_instruction(decoded);
+  delete_instruction(decoded);
+
+  unsigned char unknown[] = {17, 1, 2};
+  decoded = decode_instruction(unknown, sizeof(unknown));
+  print_instruction(decoded);
+  delete_instruction(decoded);
+}
+
+//-------------------------------------------------------------------------------------
+
+const char EXAMPLE_COMMANDS[] = 
+  "aggiungi-stazione 20 3 5 10 15\n"
+  "aggiungi-stazione 4 3 1 2 3\n"
+  "aggiungi-stazione 30 0\n"
+  "demolisci-stazione 3\n"
+  "demolisci-stazione 4\n"
+  "aggiungi-auto 30 40\n"
+  "aggiungi-stazione 50 3 20 25 7\n"
+  "rottama-auto 20 8\n"
+  "rottama-auto 9999 5\n"
+  "rottama-auto 50 7\n"
+  "pianifica-percorso 20 30\n"
+  "pianifica-percorso 20 50\n"
+  "pianifica-percorso 50 30\n"
+  "pianifica-percorso 50 20\n"
+  "aggiungi-auto 50 30\n"
+  "pianifica-percorso 50 20\n"
+  "comando-errato 1 2\n";
+
+void run_example_commands(uint pipelined, uint instructions) {
+  int fd[2];
+
+  fflush(stdout);
+
+  pipe(fd);
+  write(fd[1], EXAMPLE_COMMANDS, sizeof(EXAMPLE_COMMANDS) - 1);
+  close(fd[1]);
+
+  reader * input = create_reader(fd[0], 64);
+  executor executor = {.highway = create_highway(1), .output = create_writer(1, 64), .replies = text_format, 
+                       .snapshot_path = NULL, .journal = NULL, .instructions = instructions};
+  uint lines = 0;
+
+  read_result result;
+  if(pipelined) {
+    result = execute_stream_pipelined(&executor, input, text_format, &lines);
+  }
+  else {
+    result = execute_stream(&executor, input, text_format, &lines);
+  }
+  flush_writer(executor.output);
+
+  printf("Read result: %d, commands executed: %d\n", result, lines);
+
+  delete_highway(executor.highway);
+  delete_writer(executor.output);
+  delete_reader(input);
+  close(fd[0]);
+}
+
+void test_execute_stream() {
+  printf("Sequential (fused):\n");
+  run_example_commands(0, 0);
+
+  printf("Sequential (instructions):\n");
+  run_example_commands(0, 1);
+
+  printf("Pipelined:\n");
+  run_example_commands(1, 1);
+}
+
+void run_long_station(uint pipelined, uint instructions) {
+  int fd[2];
+  char station[] = "aggiungi-stazione 10 1000";
+  char cars[] = " 25 3 7 12 1";
+
+  fflush(stdout);
+
+  pipe(fd);
+  write(fd[1], station, sizeof(station) - 1);
+  for(int i = 0; i < 200; ++i) {
+    write(fd[1], cars, sizeof(cars) - 1);
+  }
+  write(fd[1], "\naggiungi-stazione 30 0\npianifica-percorso 10 30\n", 49);
+  close(fd[1]);
+
+  reader * input = create_reader(fd[0], 64);
+  executor executor = {.highway = create_highway(1), .output = create_writer(1, 64), .replies = text_format, 
+                       .snapshot_path = NULL, .journal = NULL, .instructions = instructions};
+  uint lines = 0;
+
+  read_result result;
+  if(pipelined) {
+    result = execute_stream_pipelined(&executor, input, text_format, &lines);
+  }
+  else {
+    result = execute_stream(&executor, input, text_format, &lines);
+  }
+  flush_writer(executor.output);
+
+  printf("Read result: %d, commands executed: %d, cars: %d\n", result, lines, 
+    executor.highway->length > 0 ? executor.highway->stations[0]->length : 0);
+
+  delete_highway(executor.highway);
+  delete_writer(executor.output);
+  delete_reader(input);
+  close(fd[0]);
+}
+
+void test_execute_long_station() {
+  printf("Sequential (fused):\n");
+  run_long_station(0, 0);
+
+  printf("Sequential (instructions):\n");
+  run_long_station(0, 1);
+
+  printf("Pipelined:\n");
+  run_long_station(1, 1);
+}
+
+void test_execute_long_record() {
+  int fd[2];
+  char station[] = "aggiungi-stazione 10 1000";
+  char cars[] = " 25 3 7 12 70000";
+  char tail[] = "\naggiungi-stazione 30 0\npianifica-percorso 10 30\n";
+
+  // The record of the station is about 2 KB, the buffer of the reader 64 bytes
+  char * commands = (char *) malloc(sizeof(station) + 200 * sizeof(cars) + sizeof(tail));
+  uint length = sprintf(commands, "%s", station);
+  for(int i = 0; i < 200; ++i) {
+    length += sprintf(commands + length, "%s", cars);
+  }
+  sprintf(commands + length, "%s", tail);
+
+  fflush(stdout);
+
+  pipe(fd);
+  write(fd[1], BINARY_MAGIC, BINARY_MAGIC_LENGTH);
+  for(char * command = strtok(commands, "\n"); command != NULL; command = strtok(NULL, "\n")) {
+    instruction * instruction = parse_instruction(command);
+    unsigned char * record = (unsigned char *) malloc(record_max_length(instruction));
+    write(fd[1], record, encode_instruction(instruction, record));
+    free(record);
+    delete_instruction(instruction);
+  }
+
+  unsigned char malformed[] = {0x82, 0x01, remove_car_command, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80};
+  write(fd[1], malformed, sizeof(malformed));
+  for(int i = 0; i < 123; ++i) {
+    write(fd[1], "\x01", 1);
+  }
+  close(fd[1]);
+  free(commands);
+
+  reader * input = create_reader(fd[0], 64);
+  executor executor = {.highway = create_highway(1), .output = create_writer(1, 64), .replies = text_format, 
+                       .snapshot_path = NULL, .journal = NULL, .instructions = 0};
+  uint lines = 0;
+
+  detect_format(input);
+  read_result result = execute_stream(&executor, input, binary_format, &lines);
+  flush_writer(executor.output);
+
+  printf("Read result: %d, commands executed: %d, cars: %d\n", result, lines, executor.highway->stations[0]->length);
+
+  delete_highway(executor.highway);
+  delete_writer(executor.output);
+  delete_reader(input);
+  close(fd[0]);
+}
+
+void test_execute_load_stations() {
+  int fd[2];
+  char station[] = " 10 2 3 5";
+  char tail[] = "\nimporta-stazioni 5 1 7 10 0\npianifica-percorso 10 500\nimporta-stazioni 3 2 1\n";
+
+  fflush(stdout);
+
+  pipe(fd);
+  write(fd[1], "importa-stazioni", 16);
+  for(int i = 1; i <= 50; ++i) {
+    char entry[32];
+    write(fd[1], entry, sprintf(entry, " %d 2 %d 15", i * 10, i));
+  }
+  write(fd[1], station, sizeof(station) - 1);
+  write(fd[1], tail, sizeof(tail) - 1);
+  close(fd[1]);
+
+  reader * input = create_reader(fd[0], 64);
+  executor executor = {.highway = create_highway(1), .output = create_writer(1, 64), .replies = text_format, 
+                       .snapshot_path = NULL, .journal = NULL, .instructions = 0};
+  uint lines = 0;
+
+  read_result result = execute_stream(&executor, input, text_format, &lines);
+  flush_writer(executor.output);
+
+  printf("Read result: %d, commands executed: %d, stations: %d\n", result, lines, executor.highway->length);
+
+  delete_highway(executor.highway);
+  delete_writer(executor.output);
+  delete_reader(input);
+  close(fd[0]);
+}
+
+//-------------------------------------------------------------------------------------
+
+void test_serve_connection() {
+  int fd[2];
+  char replies[256];
+
+  socketpair(AF_UNIX, SOCK_STREAM, 0, fd);
+
+  connection * connection = create_connection(fd[0]);
+  executor executor = {.highway = create_highway(1), .output = NULL, .replies = text_format, 
+                       .snapshot_path = NULL, .journal = NULL, .instructions = 0};
+
+  write(fd[1], "aggiungi-stazione 10 1 30\naggiungi-stazione 40 0\npianifica-perc", 63);
+  printf("Keep open: %d\n", serve_connection(&executor, connection));
+  int n = read(fd[1], replies, sizeof(replies));
+  printf("Replies (%d): %.*s", n, n, replies);
+
+  write(fd[1], "orso 10 40\n", 11);
+  shutdown(fd[1], SHUT_WR);
+  printf("Keep open: %d\n", serve_connection(&executor, connection));
+  n = read(fd[1], replies, sizeof(replies));
+  printf("Replies (%d): %.*s", n, n, replies);
+
+  delete_connection(connection);
+  delete_highway(executor.highway);
+  close(fd[1]);
+}
+
+void test_serve_split_command() {
+  int fd[2];
+  char replies[256];
+  const char * parts[] = {"aggiungi-staz", "ione 20 3 1", "0 2 ", "3\nimporta-stazioni 30 1 4", "0 50 0\n"};
+
+  socketpair(AF_UNIX, SOCK_STREAM, 0, fd);
+
+  connection * connection = create_connection(fd[0]);
+  executor executor = {.highway = create_highway(1), .output = NULL, .replies = text_format, 
+                       .snapshot_path = NULL, .journal = NULL, .instructions = 0};
+
+  // Every command is split across two writes, also in the middle of its name and of a parameter
+  for(int i = 0; i < 5; ++i) {
+    write(fd[1], parts[i], strlen(parts[i]));
+    printf("Keep open: %d, ", serve_connection(&executor, connection));
+
+    int n = recv(fd[1], replies, sizeof(replies), MSG_DONTWAIT);
+    printf("replies (%d): %.*s\n", n > 0 ? n : 0, n > 0 ? n - 1 : 0, replies);
+  }
+
+  station * station = find_station(executor.highway, 20);
+  printf("Station 20: max fuel %d, cars ", station != NULL ? station->car_max_fuel : 0);
+  if(station != NULL) {
+    print_cars(station);
+  }
+  printf("Stations: %d\n", executor.highway->length);
+
+  delete_connection(connection);
+  delete_highway(executor.highway);
+  close(fd[1]);
+}
+
+void test_serve_slow_client() {
+  int fd[2], buffer_size = 4096, length = 0;
+  char replies[4096], commands[32768];
+
+  socketpair(AF_UNIX, SOCK_STREAM, 0, fd);
+  setsockopt(fd[0], SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+
+  connection * connection = create_connection(fd[0]);
+  executor executor = {.highway = create_highway(1), .output = NULL, .replies = text_format, 
+                       .snapshot_path = NULL, .journal = NULL, .instructions = 0};
+
+  // Every plan crosses 2000 stations, so the replies are much longer than the buffer of the socket
+  length += sprintf(commands, "importa-stazioni");
+  for(int i = 0; i < 2000; ++i) {
+    length += sprintf(commands + length, " %d 1 1", i);
+  }
+  length += sprintf(commands + length, "\n");
+  for(int i = 0; i < 40; ++i) {
+    length += sprintf(commands + length, "pianifica-percorso 0 1999\n");
+  }
+  write(fd[1], commands, length);
+
+  // The client does not read, so the replies are queued instead of blocking the server
+  printf("Keep open: %d, ", serve_connection(&executor, connection));
+  printf("replies queued: %d\n", connection->output->length > 0);
+
+  uint lines = 0, calls = 0;
+  while(calls < 100000 && connection->output->length > 0) {
+    int n = recv(fd[1], replies, sizeof(replies), MSG_DONTWAIT);
+    for(int i = 0; i < n; ++i) {
+      lines += replies[i] == '\n';
+    }
+
+    serve_connection(&executor, connection);
+    ++calls;
+  }
+  for(int n = 0; (n = recv(fd[1], replies, sizeof(replies), MSG_DONTWAIT)) > 0; ) {
+    for(int i = 0; i < n; ++i) {
+      lines += replies[i] == '\n';
+    }
+  }
+  printf("Replies: %d lines, queue empty: %d\n", lines, connection->output->length == 0);
+
+  delete_connection(connection);
+  delete_highway(executor.highway);
+  close(fd[1]);
+}
+
+//-------------------------------------------------------------------------------------
+
+void test_snapshot_round_trip() {
+  char path[] = "/tmp/test_snapshot_XXXXXX";
+  close(mkstemp(path));
+
+  highway * original = create_highway(1);
+  for(matrix_size i = 0; i < 5; ++i) {
+    station * station = create_station(i * 10, 1);
+    for(matrix_size j = 0; j < i; ++j) {
+      add_car(station, i * 100 + j);
+    }
+    add_station(original, station);
+  }
+
+  printf("Save: %d\n", save_snapshot(original, path, 0));
+
+  highway * restored = NULL;
+  printf("Load: %d\n", load_snapshot(path, &restored, NULL));
+  for(matrix_size i = 0; restored != NULL && i < restored->length; ++i) {
+    printf("Station %d: max fuel %d, cars ", restored->stations[i]->distance, restored->stations[i]->car_max_fuel);
+    print_cars(restored->stations[i]);
+  }
+  delete_highway(restored);
+
+  int fd = open(path, O_WRONLY);
+  pwrite(fd, "\x01", 1, sizeof(snapshot_header) + 4);
+  close(fd);
+  printf("Load corrupted: %d\n", load_snapshot(path, &restored, NULL));
+
+  truncate(path, sizeof(snapshot_header) + 4);
+  printf("Load truncated: %d\n", load_snapshot(path, &restored, NULL));
+
+  unlink(path);
+  printf("Load missing: %d\n", load_snapshot(path, &restored, NULL));
+
+  delete_highway(original);
+}
+
+void print_highway(const highway * highway) {
+  for(matrix_size i = 0; highway != NULL && i < highway->length; ++i) {
+    printf("Station %d: max fuel %d, cars ", highway->stations[i]->distance, highway->stations[i]->car_max_fuel);
+    print_cars(highway->stations[i]);
+  }
+}
+
+void test_journal_replay() {
+  int fd[2];
+  char path[] = "/tmp/test_journal_XXXXXX";
+  char commands[] = "aggiungi-stazione 10 2 5 7\naggiungi-stazione 20 0\naggiungi-auto 20 9\naggiungi-auto 30 1\n"
+    "rottama-auto 10 7\ndemolisci-stazione 20\naggiungi-stazione 40 1 3\n";
+
+  close(mkstemp(path));
+  unlink(path);
+
+  pipe(fd);
+  write(fd[1], commands, sizeof(commands) - 1);
+  close(fd[1]);
+
+  reader * input = create_reader(fd[0], 64);
+  journal * mutations = create_journal(path, 2, 0);
+  executor executor = {.highway = create_highway(1), .output = create_writer(1, 64), .replies = text_format, 
+                       .snapshot_path = NULL, .journal = mutations, .instructions = 0};
+  uint lines = 0;
+
+  fflush(stdout);
+  execute_stream(&executor, input, text_format, &lines);
+  flush_writer(executor.output);
+
+  printf("Journaled %d records of %d commands\n", mutations->records, lines);
+  print_highway(executor.highway);
+
+  delete_journal(mutations);
+  delete_highway(executor.highway);
+  delete_writer(executor.output);
+  delete_reader(input);
+  close(fd[0]);
+
+  highway * replayed = create_highway(1);
+  mutations = create_journal(path, 1, 0);
+  printf("Replayed %d records\n", replay_journal(mutations, replayed, 0));
+  print_highway(replayed);
+
+  printf("Replayed with newer snapshot: %d\n", replay_journal(mutations, replayed, 3));
+  printf("Generation after reset: %d\n", mutations->generation);
+  printf("Replayed with older snapshot: %d\n", replay_journal(mutations, replayed, 2));
+
+  delete_journal(mutations);
+  delete_highway(replayed);
+  unlink(path);
+}
+
+void test_plan_path_batch() {
+  highway * highway = create_highway(4);
+  matrix_size distances[] = {1, 2, 7, 8, 10, 11, 19, 24, 40, 45};
+  matrix_size fuels[] = {8, 9, 3, 4, 6, 10, 10, 7, 6, 30};
+
+  for(matrix_size i = 0; i < 10; ++i) {
+    station * new_station = create_station(distances[i], 2);
+    add_car(new_station, fuels[i]);
+    add_station(highway, new_station);
+  }
+
+  path_query queries[] = {{2, 19}, {45, 1}, {1, 11}, {40, 45}, {19, 2}, {3, 11}, {7, 7}, {24, 10}};
+  matrix_size n_queries = sizeof(queries) / sizeof(queries[0]);
+  path_result results[sizeof(queries) / sizeof(queries[0])];
+
+  printf("Batch: %d\n", plan_path_batch(highway, queries, n_queries, results));
+
+  for(matrix_size q = 0; q < n_queries; ++q) {
+    matrix_size * solution = NULL;
+    direction dir = queries[q].start > queries[q].end ? backward : forward;
+    int stops = queries[q].start == 3 ? no_solution : plan_path(highway, queries[q].start, queries[q].end, dir, &solution);
+
+    printf("Query %d -> %d: stops %d (plan_path %d) ", queries[q].start, queries[q].end, results[q].stops, stops);
+    if(results[q].stops >= 0) {
+      print_vec(results[q].solution, results[q].stops + 2);
+    }
+    else {
+      printf("\n");
+    }
+
+    free(results[q].solution);
+    free(solution);
+  }
+
+  delete_highway(highway);
+}
+
 //-------------------------------------------------------------------------------------
 
 void test_solver() {
 
   test_dynamic_programming_example();
 
+  test_solve_view();
+
+  test_min_stops_layers();
+
   //test_dynamic_programming_small();
   
   //test_dynamic_programming_huge();
@@ -610,7 +1955,7 @@ void test_solver() {
 
 void test_station_handler() {
 
-    test_binary_search();
+    test_search();
 
     test_highway();
     
@@ -618,14 +1963,29 @@ void test_station_handler() {
 
     test_station_insertion();
 
+    test_highway_growth();
+    test_highway_layout();
+
     test_station_removal();
 
+    test_station_tombstones();
+
+    test_highway_spread();
+
+    test_add_stations();
+
     test_station_search();
 
     test_car_insertion();
 
     test_car_removal();
 
+    test_car_multiset();
+
+    test_station_pool();
+
+    test_station_hash();
+
     test_car_insertion_by_distance();
 
     test_car_removal_by_distance();
@@ -633,10 +1993,60 @@ void test_station_handler() {
     test_extract_stations();
 
     test_plan_path();
+
+    test_plan_path_batch();
 }
 
 void test_parser() {
   test_parse_instruction();
+
+  test_parse_line_into();
+}
+
+void test_numbers() {
+  test_decode_number();
+
+  test_decode_number_list();
+}
+
+void test_reader() {
+  test_next_line();
+
+  test_next_token();
+}
+
+void test_writer() {
+  test_writer_output();
+}
+
+void test_binary() {
+  test_varint();
+
+  test_instruction_encoding();
+}
+
+void test_executor() {
+  test_execute_stream();
+
+  test_execute_long_station();
+
+  test_execute_long_record();
+
+  test_execute_load_stations();
+}
+
+void test_server() {
+  test_serve_connection();
+  test_serve_split_command();
+  test_serve_slow_client();
+}
+
+void test_snapshot() {
+  test_snapshot_round_trip();
+}
+
+void test_journal() {
+  test_journal_replay();
 }
 
 void test_example() {
@@ -646,7 +2056,7 @@ void test_example() {
   highway * highway = create_highway(1);
 
   matrix_size result = 1;
-  result = result && add_station(&highway, create_station(20, cars_capacity));
+  result = result && add_station(highway, create_station(20, cars_capacity));
   result = result && add_car_by_distance(highway, 20, 3);
   result = result && add_car_by_distance(highway, 20, 5);
   result = result && add_car_by_distance(highway, 20, 10);
@@ -659,7 +2069,7 @@ void test_example() {
   }
 
   result = 1;
-  result = result && add_station(&highway, create_station(4, cars_capacity));
+  result = result && add_station(highway, create_station(4, cars_capacity));
   result = result && add_car_by_distance(highway, 4, 3);
   result = result && add_car_by_distance(highway, 4, 1);
   result = result && add_car_by_distance(highway, 4, 2);
@@ -672,7 +2082,7 @@ void test_example() {
   }
 
   result = 1;
-  result = result && add_station(&highway, create_station(30, cars_capacity));
+  result = result && add_station(highway, create_station(30, cars_capacity));
   result = result && add_car_by_distance(highway, 30, 0);
   if(result == 1) {
     printf("aggiunta\n");
@@ -703,7 +2113,7 @@ void test_example() {
   }
 
   result = 1;
-  result = result && add_station(&highway, create_station(50, cars_capacity));
+  result = result && add_station(highway, create_station(50, cars_capacity));
   result = result && add_car_by_distance(highway, 50, 3);
   result = result && add_car_by_distance(highway, 50, 20);
   result = result && add_car_by_distance(highway, 50, 25);
@@ -9,6 +9,14 @@
 void test_solver();
 void test_station_handler();
 void test_parser();
+void test_numbers();
+void test_reader();
+void test_writer();
+void test_binary();
+void test_executor();
+void test_server();
+void test_snapshot();
+void test_journal();
 
 void test_example();
                     
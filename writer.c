@@ -0,0 +1,293 @@
+/**
+ * @file writer.c
+ * @brief Contains functions to buffer the output and write it in blocks.
+*/
+
+#include "writer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include <poll.h>
+
+#define NDEBUG
+
+#ifndef NDEBUG
+#include <stdio.h>
+#endif
+
+const char DIGIT_PAIRS[] = 
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+writer * create_writer(int fd, uint capacity) {
+    #ifndef NDEBUG
+    printf("Starting writer creation\n");
+    #endif
+
+    if(capacity <= UINT_DIGITS) {
+        #ifndef NDEBUG
+        printf("\tThe capacity of the writer must be greater than %d\n", UINT_DIGITS);
+        #endif
+
+        return NULL;
+    }
+
+    writer * new_writer = (writer *) malloc(sizeof(writer));
+    if(new_writer == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough space to allocate writer of %ld bytes\n", sizeof(writer));
+        #endif
+
+        return NULL;
+    }
+
+    new_writer->buffer = (char *) malloc(sizeof(char) * capacity);
+    if(new_writer->buffer == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough space to allocate buffer of %ld bytes\n", sizeof(char) * capacity);
+        #endif
+
+        free(new_writer);
+        return NULL;
+    }
+
+    new_writer->fd = fd;
+    new_writer->capacity = capacity;
+    new_writer->length = 0;
+    new_writer->error = 0;
+    new_writer->queued = 0;
+
+    #ifndef NDEBUG
+    printf("Ending writer creation\n");
+    #endif
+
+    return new_writer;
+}
+
+writer * create_queued_writer(int fd, uint capacity) {
+    writer * new_writer = create_writer(fd, capacity);
+    if(new_writer != NULL) {
+        new_writer->queued = 1;
+    }
+
+    return new_writer;
+}
+
+void delete_writer(writer * writer) {
+    if(writer != NULL) {
+        flush_writer(writer);
+
+        free(writer->buffer);
+        free(writer);
+    }
+}
+
+/**
+ * @brief Write all the iovec entries, repeating writev(2) on partial writes.
+ * 
+ * If fd is non blocking and full, poll(2) waits until it becomes writable again.
+ * 
+ * @returns 1 if everything is written, 0 otherwise.
+*/
+uint write_all(int fd, struct iovec * iov, int iovcnt) {
+    while(iovcnt > 0) {
+        ssize_t n = writev(fd, iov, iovcnt);
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                struct pollfd writable = {fd, POLLOUT, 0};
+                if(poll(&writable, 1, -1) >= 0 || errno == EINTR) {
+                    continue;
+                }
+            }
+
+            return 0;
+        }
+
+        while(iovcnt > 0 && n >= (ssize_t) iov->iov_len) {
+            n -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+
+        if(iovcnt > 0) {
+            iov->iov_base = (char *) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Write the start of the buffer of a queued writer which the file descriptor accepts without waiting, and move
+ * the rest to the start of the buffer.
+ * 
+ * @returns 1 if no error occurred, 0 otherwise (the buffer is discarded).
+*/
+uint flush_queue(writer * writer) {
+    uint written = 0;
+
+    while(written < writer->length) {
+        ssize_t n = write(writer->fd, writer->buffer + written, writer->length - written);
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+
+            writer->error = 1;
+            writer->length = 0;
+            return 0;
+        }
+
+        written += n;
+    }
+
+    #ifndef NDEBUG
+    printf("\tFlushed %d bytes, %d queued\n", written, writer->length - written);
+    #endif
+
+    memmove(writer->buffer, writer->buffer + written, writer->length - written);
+    writer->length -= written;
+
+    return 1;
+}
+
+/**
+ * @brief Make room for length characters in the buffer: a queued writer doubles it, any other writer flushes it.
+ * 
+ * @pre length <= writer->capacity, unless the writer is queued.
+ * 
+ * @returns 1 if the characters fit in the buffer; 0 if there is not enough memory to grow it (the error is set).
+*/
+uint make_room(writer * writer, uint length) {
+    if(!writer->queued) {
+        flush_writer(writer);
+        return 1;
+    }
+
+    uint capacity = writer->capacity;
+    while(capacity - writer->length < length) {
+        capacity *= 2;
+    }
+
+    char * buffer = (char *) realloc(writer->buffer, sizeof(char) * capacity);
+    if(buffer == NULL) {
+        #ifndef NDEBUG
+        printf("\tNot enough space to grow the queue to %ld bytes\n", sizeof(char) * capacity);
+        #endif
+
+        writer->error = 1;
+        return 0;
+    }
+
+    writer->buffer = buffer;
+    writer->capacity = capacity;
+
+    return 1;
+}
+
+uint flush_writer(writer * writer) {
+    if(writer->length == 0) {
+        return 1;
+    }
+
+    if(writer->queued) {
+        return flush_queue(writer);
+    }
+
+    #ifndef NDEBUG
+    printf("\tFlushing %d bytes\n", writer->length);
+    #endif
+
+    struct iovec iov = {writer->buffer, writer->length};
+    uint result = write_all(writer->fd, &iov, 1);
+    if(result == 0) {
+        writer->error = 1;
+    }
+
+    writer->length = 0;
+    return result;
+}
+
+void write_text(writer * writer, const char * text, uint length) {
+    if(writer->length + length <= writer->capacity) {
+        memcpy(writer->buffer + writer->length, text, length);
+        writer->length += length;
+
+        return;
+    }
+
+    if(writer->queued) {
+        if(make_room(writer, length)) {
+            memcpy(writer->buffer + writer->length, text, length);
+            writer->length += length;
+        }
+
+        return;
+    }
+
+    struct iovec iov[2] = {
+        {writer->buffer, writer->length}, 
+        {(char *) text, length}
+    };
+
+    if(write_all(writer->fd, iov, 2) == 0) {
+        writer->error = 1;
+    }
+
+    writer->length = 0;
+}
+
+void write_char(writer * writer, char c) {
+    if(writer->length == writer->capacity && !make_room(writer, 1)) {
+        return;
+    }
+
+    writer->buffer[writer->length++] = c;
+}
+
+void write_uint(writer * writer, uint value) {
+    if(writer->length + UINT_DIGITS > writer->capacity && !make_room(writer, UINT_DIGITS)) {
+        return;
+    }
+
+    uint digits = 1;
+    for(uint power = 10; digits < UINT_DIGITS && value >= power; power *= 10) {
+        ++digits;
+    }
+
+    char * end = writer->buffer + writer->length + digits;
+    writer->length += digits;
+
+    while(value >= 100) {
+        uint pair = (value % 100) * 2;
+        value /= 100;
+
+        *--end = DIGIT_PAIRS[pair + 1];
+        *--end = DIGIT_PAIRS[pair];
+    }
+
+    if(value >= 10) {
+        *--end = DIGIT_PAIRS[value * 2 + 1];
+        *--end = DIGIT_PAIRS[value * 2];
+    }
+    else {
+        *--end = '0' + value;
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef _WRITER_
+#define _WRITER_
+
+/**
+ * @headerfile writer.h
+ * @brief Interface of writer.c.
+*/
+
+typedef unsigned int uint;
+
+/**
+ * @struct writer
+ * @brief Buffered writer on a file descriptor.
+ *
+ * @param fd File descriptor to write to.
+ * @param buffer Buffer which accumulates the output.
+ * @param capacity Capacity of the buffer.
+ * @param length Number of characters stored in the buffer.
+ * @param error 1 if a write(2) failed (or a queued writer could not grow), 0 otherwise.
+ * @param queued 1 if the buffer grows instead of being written when it is full (see create_queued_writer), 0 otherwise.
+*/
+typedef struct writer {
+    int fd;
+    char * buffer;
+    uint capacity;
+    uint length;
+    uint error;
+    uint queued;
+} writer;
+
+/**
+ * Maximum number of characters of an unsigned integer.
+*/
+#define UINT_DIGITS 10
+
+/**
+ * Write a string literal, computing its length at compile time.
+*/
+#define write_literal(writer, text) write_text(writer, text, sizeof(text) - 1)
+
+/**
+ * @brief Create a writer on a file descriptor.
+ *
+ * @param fd File descriptor to write to.
+ * @param capacity Capacity of the buffer of the writer.
+ *
+ * @returns A pointer to the writer allocated on heap, NULL if capacity <= UINT_DIGITS or there is not enough memory.
+*/
+writer * create_writer(int fd, uint capacity);
+
+/**
+ * @brief Create a writer which never waits for a non blocking file descriptor.
+ *
+ * The buffer is a queue of the output not written yet: it doubles when the output does not fit in it, and it is 
+ * written only by flush_writer, as far as the file descriptor accepts it without waiting.
+ *
+ * @param fd Non blocking file descriptor to write to.
+ * @param capacity Initial capacity of the buffer of the writer.
+ *
+ * @returns A pointer to the writer allocated on heap, NULL if capacity <= UINT_DIGITS or there is not enough memory.
+*/
+writer * create_queued_writer(int fd, uint capacity);
+
+/**
+ * @brief Flush and delete a writer.
+ *
+ * @param writer Pointer to the writer to delete.
+ *
+ * @post The buffer is flushed and the writer deallocated; the file descriptor is not closed.
+*/
+void delete_writer(writer * writer);
+
+/**
+ * @brief Write the content of the buffer with a single write(2) (repeated only if the write is partial).
+ *
+ * @param writer Pointer to the writer to flush.
+ *
+ * @pre writer != NULL
+ *
+ * @returns 1 if the buffer is written successfully, 0 otherwise.
+ *
+ * @note On a non blocking file descriptor the write waits (with poll(2)) until the descriptor accepts the data, unless 
+ *       the writer is queued: then only the data the descriptor accepts is written, the rest stays in the buffer 
+ *       (writer->length > 0) and 1 is returned.
+*/
+uint flush_writer(writer * writer);
+
+/**
+ * @brief Append a text to the buffer.
+ *
+ * @param writer Pointer to the writer to use.
+ * @param text Pointer to the text to write.
+ * @param length Number of characters of the text.
+ *
+ * @pre writer != NULL
+ *
+ * @note If the text does not fit in the buffer, buffer and text are written together with a single writev(2).
+*/
+void write_text(writer * writer, const char * text, uint length);
+
+/**
+ * @brief Append a character to the buffer.
+ *
+ * @param writer Pointer to the writer to use.
+ * @param c The character to write.
+ *
+ * @pre writer != NULL
+*/
+void write_char(writer * writer, char c);
+
+/**
+ * @brief Append the decimal rapresentation of an unsigned integer to the buffer.
+ *
+ * @param writer Pointer to the writer to use.
+ * @param value The value to write.
+ *
+ * @pre writer != NULL
+ *
+ * @note Digits are produced two at a time through a lookup table.
+*/
+void write_uint(writer * writer, uint value);
+
+#endif